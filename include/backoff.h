@@ -0,0 +1,20 @@
+#pragma once
+#include <stdint.h>
+
+// Attente exponentielle avec gigue entre tentatives de connexion ; sans dépendance Arduino
+// (firmware : MqttLink, banc hôte : tools/mqtt_sim.cpp).
+// Délai n = min(max, base x 2^n) tiré uniformément dans [d/2, d] : des appareils coupés
+// par la même panne ne reviennent pas tous en même temps sur le broker.
+struct Backoff {
+  uint32_t base_ms, max_ms;
+  uint8_t  fails;            // échecs consécutifs depuis reset()
+
+  Backoff(uint32_t base, uint32_t max) : base_ms(base), max_ms(max), fails(0) {}
+  uint32_t next(uint32_t rnd){
+    uint32_t d = fails < 20 ? base_ms << fails : max_ms;
+    if (d > max_ms || d < base_ms) d = max_ms;
+    if (fails < 255) fails++;
+    return d / 2 + rnd % (d / 2 + 1);
+  }
+  void reset(){ fails = 0; }
+};
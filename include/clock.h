@@ -0,0 +1,30 @@
+#pragma once
+#include <Arduino.h>
+#include <time.h>
+
+// Horodatage des passages : horloge monotone 64 bits (esp_timer, µs depuis le boot)
+// + décalage vers l'heure murale, fixé quand NTP a calé l'horloge système.
+//  - Avant synchro, un passage porte ses secondes depuis le boot et Passage::MS_PENDING ;
+//    le journal y ajoute le numéro de boot (compteur NVS).
+//  - À la synchro : une entrée { boot, epoch du boot } est ajoutée à la table de correction
+//    (NVS, BOOTS derniers boots). Les lecteurs du journal l'appliquent à la volée (aucun
+//    enregistrement réécrit en flash) ; l'historique RAM et le tampon du journal sont corrigés
+//    en une passe par l'appelant (poll() == true).
+//  - Ensuite, stamp() = monotone + décalage : pas de saut quand NTP corrige l'heure système,
+//    écarts entre passages exacts à la ms. Dérive > STEP_US : décalage recalé (compté).
+namespace Clock {
+  static const time_t   MIN_VALID_EPOCH = 1577836800;   // 2020-01-01 : avant, horloge non calée
+  static const uint8_t  BOOTS   = 16;
+  static const uint32_t STEP_US = 500000;
+
+  void     begin();                 // compteur de boot, table de correction
+  bool     poll();                  // true une fois : horloge murale devenue valide
+  bool     synced();
+  uint16_t boot();
+  int64_t  monoUs();
+  // Instant monotone -> (ts, ms) : epoch si calé, sinon secondes depuis le boot + MS_PENDING
+  void     stamp(int64_t monoUs, time_t& ts, uint16_t& ms);
+  // Secondes/ms depuis le boot b -> epoch ; false si ce boot n'a jamais été calé
+  bool     resolve(uint16_t b, uint32_t& sec, uint16_t& ms);
+  uint32_t steps();                 // recalages du décalage depuis la synchro
+}
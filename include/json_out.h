@@ -0,0 +1,52 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Écriture JSON en flux, sans allocation (ni String, ni tas) ; sans dépendance Arduino.
+// Le texte est écrit dans un tampon fourni par l'appelant (pile, statique) :
+//  - sans sink : tampon unique (payload MQTT, réponse courte) ; dépassement ->
+//    sortie tronquée et ok() == false, jamais d'écriture hors tampon ;
+//  - avec sink : le tampon est vidé dans le sink dès qu'il est plein (réponse HTTP
+//    chunkée) : taille de réponse non bornée pour un tampon fixe.
+// Virgules et imbrication gérées par l'écrivain (16 niveaux) ; nombres formatés à la
+// main (pas de printf flottant, dont le dtoa de newlib alloue).
+class JsonOut {
+public:
+  typedef void (*Sink)(void* ctx, const char* p, size_t n);
+
+  JsonOut(char* buf, size_t cap, Sink sink = nullptr, void* ctx = nullptr);
+
+  JsonOut& obj();                        // '{'
+  JsonOut& arr();                        // '['
+  JsonOut& end();                        // ferme le niveau courant ('}' ou ']')
+  JsonOut& key(const char* k);           // clé littérale (non échappée)
+  JsonOut& str(const char* s);           // chaîne échappée
+  JsonOut& u(uint32_t v);
+  JsonOut& i(int32_t v);
+  JsonOut& fix(int32_t v, uint8_t dec);  // v / 10^dec : fix(125, 1) -> 12.5
+  JsonOut& f(float v, uint8_t dec);      // arrondi à dec décimales ; NaN/inf -> null
+  JsonOut& b(bool v);                    // true / false
+  JsonOut& null();
+  JsonOut& raw(const char* s, size_t n); // fragment JSON déjà formaté (valeur)
+
+  const char* c_str();                   // sans sink : texte terminé par '\0'
+  size_t size() const { return m_len; }  // octets dans le tampon
+  bool   ok() const { return !m_over; }
+  void   flush();                        // avec sink : vide le tampon
+  void   reset();
+
+private:
+  void sep();
+  void put(const char* s, size_t n);
+  void put1(char c){ if (m_len + 1 < m_cap) m_buf[m_len++] = c; else put(&c, 1); }
+  void digits(uint32_t v);
+
+  char*    m_buf;
+  size_t   m_cap, m_len = 0;
+  Sink     m_sink;
+  void*    m_ctx;
+  uint16_t m_first = 0;                  // bit n : niveau n sans élément
+  uint16_t m_isArr = 0;                  // bit n : niveau n est un tableau
+  uint8_t  m_depth = 0;
+  bool     m_afterKey = false, m_over = false;
+};
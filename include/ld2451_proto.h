@@ -0,0 +1,27 @@
+#pragma once
+#include <stdint.h>
+
+// =================== Protocole HLK-LD2451 ======================
+// Constantes de trame partagées par le firmware et les outils PC (tools/).
+static const uint8_t CMD_HDR[4]  = {0xFD,0xFC,0xFB,0xFA};
+static const uint8_t CMD_TAIL[4] = {0x04,0x03,0x02,0x01};
+static const uint8_t DAT_HDR[4]  = {0xF4,0xF3,0xF2,0xF1};
+static const uint8_t DAT_TAIL[4] = {0xF8,0xF7,0xF6,0xF5};
+
+enum : uint16_t {
+  CMD_ENABLE_CFG   = 0x00FF,
+  CMD_END_CFG      = 0x00FE, // payload 0x0001
+  CMD_SET_DET      = 0x0002, // 4B
+  CMD_GET_DET      = 0x0012, // +4B
+  CMD_SET_SENS     = 0x0003, // 4B
+  CMD_GET_SENS     = 0x0013, // +4B
+  CMD_READ_VERSION = 0x00A1,
+  CMD_SET_BAUD     = 0x00A0, // 2B index + reboot
+  CMD_REBOOT       = 0x00A2,
+  CMD_FACTORY_RST  = 0x00A3
+};
+
+// Bornes de LEN acceptées : au-delà, l'en-tête est considéré comme parasite
+// (évite d'attendre 64 Ko sur un faux F4F3F2F1 / FDFCFBFA).
+static const uint16_t DAT_MAX_LEN = 512;  // 2 + 5 octets par cible
+static const uint16_t CMD_MAX_LEN = 64;
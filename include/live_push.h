@@ -0,0 +1,23 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Canal push Server-Sent Events pour l'UI (remplace le poll 1,5 s).
+// Serveur TCP dédié (port LIVE_PORT, 81 par défaut) à côté du WebServer synchrone :
+// une connexion SSE ouverte ne bloque donc jamais les requêtes HTTP normales.
+//  - publish() formate l'événement une seule fois dans une file (aucune écriture réseau :
+//    appelable depuis le chemin d'ingestion) ; service() l'écrit à tous les abonnés.
+//  - Écritures non bloquantes (MSG_DONTWAIT) : WiFiClient::write() attendrait jusqu'à 10 x 1 s
+//    une fenêtre TCP pleine. Un événement qui ne tient pas en entier -> client retiré ;
+//    file pleine -> tous retirés. L'UI se reconnecte et recharge tout.
+//  - Commentaire keep-alive toutes les 15 s.
+namespace LivePush {
+  static const uint8_t MAX_CLIENTS = 4;
+  static const size_t  QUEUE_BYTES = 2048;         // événements en attente de service()
+
+  void begin(uint16_t port);
+  void end();
+  void service();                                  // à appeler dans loop() : accepte, lit les requêtes, écrit la file, keep-alive
+  void publish(const char* event, const char* data, size_t len);   // mise en file seulement
+  uint8_t clients();                               // abonnés SSE actifs
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Métriques d'exécution, coût constant et sans allocation ; sans dépendance Arduino.
+//  - Histogrammes de durée (µs) à seuils fixes : itération de loop(), écriture flash
+//    (journal, NVS), publication MQTT, light-sleep, et un par route HTTP (route()).
+//  - Latences du chemin radar : arrivée d'une trame -> loop(), fin de piste -> passage
+//    enregistré ; avec la trace (main.cpp, option trace) passage -> flash et -> MQTT.
+//    observe() = une dizaine de comparaisons et trois additions.
+//  - Valeurs ponctuelles fournies par l'appelant à l'export (tas, radar, file MQTT...).
+//  - Export au format texte Prometheus 0.0.4 (secondes), ligne par ligne dans un tampon
+//    vidé dans un sink : /api/metrics (chunké) et topic MQTT base/metrics (en flux,
+//    longueur calculée par une première passe sans sink).
+namespace Metrics {
+  enum Hist : uint8_t { LOOP, FLASH, MQTT_PUB, SLEEP, FRAME_LAT, PASS_CLOSE, PASS_FLASH, PASS_MQTT, HIST_COUNT };
+  static const uint8_t MAX_ROUTES = 40;
+  static const uint8_t BUCKETS    = 11;   // 10 seuils + Inf
+
+  struct Value {
+    const char* name;    // sans préfixe (radar_ ajouté)
+    const char* help;
+    bool        counter; // sinon gauge
+    uint32_t    v;
+    uint8_t     dec;     // v / 10^dec (0 : entier)
+  };
+  typedef void (*Sink)(void* ctx, const char* p, size_t n);
+
+  void    observe(Hist h, uint32_t us);
+  uint8_t route(const char* uri);            // enregistre une route ; 0xFF si plus de place
+  void    observeRoute(uint8_t id, uint32_t us);
+  uint32_t maxUs(Hist h);                    // depuis le boot
+  // Écrit tout (histogrammes + vals) ; renvoie la taille du texte. Sans sink : mesure seule.
+  size_t  write(char* buf, size_t cap, Sink sink, void* ctx, const Value* vals, uint8_t n);
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <Arduino.h>
+#include <PubSubClient.h>
+
+// Connexion MQTT hors de loop() : une tâche FreeRTOS fait les connexions (DNS, TCP,
+// CONNECT/CONNACK, jusqu'à plusieurs secondes si le broker est injoignable) avec
+// attente exponentielle + gigue (Backoff). Le client change de propriétaire selon l'état :
+//  - WAIT / CONNECTING : la tâche seule touche au client ;
+//  - UP : loop() seul (service(), publish), la tâche dort.
+// loop() ne bloque donc plus sur un broker absent ; publier se fait hors tâche, sans copie.
+namespace MqttLink {
+  enum State : uint8_t { OFF, WAIT, CONNECTING, UP };
+  static const uint32_t RETRY_MIN_MS = 1000, RETRY_MAX_MS = 60000;
+
+  struct Cfg {
+    char host[64]; uint16_t port;
+    char user[32], pass[64];
+    char client[20], will[80];        // identifiant, topic LWT ("offline", retain)
+  };
+  struct Stats {
+    uint32_t attempts, fails, connects, drops;
+    uint32_t last_ms, max_ms;          // durée de la dernière / plus longue tentative
+    uint32_t retry_ms;                 // prochaine tentative dans (WAIT)
+    int      rc;                       // PubSubClient::state() du dernier échec
+    uint8_t  state;
+  };
+
+  bool  begin(PubSubClient& c, const Cfg& cfg, bool enabled);
+  // loop() : maintient la session (PubSubClient::loop) et détecte sa perte ;
+  // true une fois par nouvelle connexion (publier status, découverte HA...)
+  bool  service();
+  bool  up();                          // le client appartient à loop() et est connecté
+  void  kick();                        // retenter tout de suite (WAIT)
+  State state();
+  Stats stats();
+}
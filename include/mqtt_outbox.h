@@ -0,0 +1,50 @@
+#pragma once
+#include <stdint.h>
+
+// File d'envoi MQTT des passages ; sans dépendance Arduino (simulation hôte : tools/mqtt_sim.cpp).
+// Les passages sont déjà persistés et numérotés (RingStore + PassLog, relus au boot) :
+// la file n'est donc qu'un curseur « dernière séquence publiée », sauvegardé en NVS
+// par l'appelant (saveDue()), et rien n'est dupliqué en flash.
+//  - Vidage dans l'ordre des séquences, débit limité (seau à jetons, rafale = 1 s) ;
+//    un jeton = un message (un passage, ou un lot en mode groupé).
+//  - Mode groupé (setBatch) : les passages sont retenus jusqu'à window s après le premier
+//    en attente, ou jusqu'à maxN, puis publiés en un seul message (moins de réveils radio).
+//  - Curseur en deçà de l'historique RAM (reboot, historique plein) : l'appelant rejoue ces
+//    séquences depuis PassLog avec next()/ack() ; seules celles absentes du journal (budget
+//    flash, tampon perdu à une coupure) sont comptées dans dropped.
+//  - Au-moins-une-fois : après un reboot, au plus SAVE_MS de passages déjà publiés
+//    repartent ; le champ "seq" du payload permet de les écarter.
+namespace MqttOutbox {
+  static const uint16_t DEFAULT_RATE = 10;     // messages/s
+  static const uint32_t SAVE_MS      = 60000;  // curseur en NVS au plus 1x/min
+  static const uint32_t RATE_WIN_MS  = 10000;  // fenêtre de mesure du débit de vidage
+  static const uint8_t  MAX_BATCH    = 32;     // passages par lot
+
+  struct Stats {
+    uint32_t acked;       // dernière séquence publiée
+    uint32_t depth;       // passages en attente
+    uint32_t sent;        // passages publiés depuis le boot
+    uint32_t msgs;        // messages (= sent hors mode groupé)
+    uint32_t dropped;     // évincés de l'historique avant publication
+    uint32_t max_depth;
+    uint16_t rate_x10;    // débit de vidage mesuré (passages/s x10, sur RATE_WIN_MS)
+    uint16_t limit;       // débit max configuré (messages/s)
+    uint16_t window;      // mode groupé : fenêtre (s), 0 = un message par passage
+  };
+
+  // acked : curseur sauvegardé (0 = aucun : on part de lastSeq, pas de rejeu de l'historique)
+  void     begin(uint32_t acked, uint32_t lastSeq);
+  void     setRate(uint16_t perSec);
+  uint16_t rate();
+  void     setBatch(uint16_t windowS, uint8_t maxN);   // windowS = 0 : un message par passage
+  uint16_t batchWindow();
+  // Message à publier maintenant : n passages consécutifs à partir de from ; 0 si rien en
+  // attente, fenêtre en cours ou débit atteint. firstSeq/lastSeq : bornes de l'historique.
+  uint8_t  next(uint32_t firstSeq, uint32_t lastSeq, uint32_t nowMs, uint32_t& from);
+  void     ack(uint32_t last, uint32_t nowMs);  // message publié jusqu'à la séquence last incluse
+  uint32_t acked();                            // dernière séquence publiée
+  void     skipTo(uint32_t lastSeq);            // MQTT désactivé / historique effacé : rien en attente
+  bool     saveDue(uint32_t nowMs);             // curseur modifié depuis le dernier markSaved()
+  void     markSaved(uint32_t nowMs);
+  Stats    stats(uint32_t lastSeq, uint32_t nowMs);
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <Arduino.h>
+#include <FS.h>
+#include "passage.h"
+
+// Journal binaire des passages en LittleFS, découpé en segments temporels.
+//  - Enregistrements de taille fixe (24 o) avec CRC-16 : un enregistrement abîmé
+//    (coupure pendant l'écriture) est ignoré à la relecture, pas le reste du fichier.
+//  - Segments /plog/NNNNNNNN.bin : un par jour local (ou SEG_MAX_BYTES au plus),
+//    en-tête d'un enregistrement ; l'index RAM (premier/dernier epoch, nombre) est reconstruit
+//    au boot en lisant l'en-tête et le dernier enregistrement de chaque segment.
+//  - Requêtes from/to : segments hors bornes sautés d'après l'index, recherche dichotomique
+//    dans le premier segment retenu (enregistrements de taille fixe -> seek direct).
+//  - Budget flash : les segments les plus anciens sont supprimés au-delà de budget().
+//  - Écriture différée : les passages s'accumulent en RAM (BUF_RECS) et sont écrits
+//    en un seul open/write/close quand le tampon est plein, après FLUSH_MS, ou via
+//    flush() avant un redémarrage volontaire. Perte max sur coupure : BUF_RECS / FLUSH_MS.
+//  - Horodatage en attente (passage antérieur à la synchro de l'horloge) : l'enregistrement
+//    garde ses secondes depuis le boot et n'est jamais réécrit en flash ; la table de correction
+//    de Clock est appliquée à chaque relecture (index, Reader, readTail). Un boot jamais calé
+//    laisse des enregistrements non résolus, ignorés des requêtes from/to.
+//  - Format v1 (16 o, sans sortie de piste ni durée) : segments et /passes.bin sont
+//    convertis au boot, une seule fois.
+namespace PassLog {
+  static const uint8_t  BUF_RECS      = 32;
+  static const uint32_t FLUSH_MS      = 10000;
+  static const uint32_t SEG_MAX_BYTES = 64 * 1024;
+  static const uint8_t  MAX_SEGS      = 128;
+
+  struct __attribute__((packed)) Record {
+    uint32_t epoch;
+    uint32_t seq;
+    uint8_t  speed_kmh, dist_m;
+    int8_t   angle;
+    uint8_t  dir, snr, dist_out;
+    uint16_t dwell_ds;
+    uint8_t  speed_raw;    // vitesse radiale (0 : enregistrement antérieur, = speed_kmh)
+    uint8_t  zone;         // 0 : aucune
+    uint16_t ms;           // Passage::ms (0 : enregistrement antérieur)
+    uint16_t boot;         // Clock::boot() à l'écriture ; ms & MS_PENDING : epoch = secondes depuis ce boot
+    uint16_t crc;          // CRC-16/CCITT des 22 octets précédents
+  };
+  static_assert(sizeof(Record) == 24, "PassLog::Record must stay 24 bytes");
+
+  struct SegInfo { uint32_t id, first, last, count, bytes; int32_t day; uint32_t lastSeq; };   // lastSeq 0 : inconnue
+
+  bool begin(uint32_t budgetBytes);              // index des segments, migration v1 et /passes.bin
+  void append(uint32_t seq, const Passage& p);   // O(1), RAM uniquement
+  void poll();                                   // flush sur délai (à appeler dans loop())
+  bool flush();
+  void clear();                                  // efface tous les segments (et le tampon)
+  void setBudget(uint32_t bytes);                // applique l'éviction immédiatement
+  uint32_t budget();
+  uint32_t pending();                            // enregistrements pas encore écrits
+  uint32_t count();                              // écrits + en attente
+  uint32_t bytes();                              // octets occupés par les segments
+  uint8_t  segments(const SegInfo** out);        // index, du plus ancien au plus récent
+  // Les n enregistrements valides les plus récents, dans l'ordre chronologique, dans out[0..ret[.
+  // Lecture à rebours par blocs : si deadlineMs (millis()) est atteint, les plus anciens manquent.
+  uint32_t readTail(Record* out, uint32_t n, uint32_t deadlineMs);
+  // Au plus n enregistrements valides de séquence >= seq, dans l'ordre du journal (rattrapage
+  // MQTT) : segments sautés d'après lastSeq, dichotomie dans le premier retenu.
+  uint32_t readFrom(uint32_t seq, Record* out, uint32_t n);
+  Passage toPassage(const Record& r);
+  // Horloge calée (Clock::poll()) : résout le tampon RAM et l'index des segments
+  void fixPending();
+
+  // Parcours chronologique, restreint à [from, to] (0 = pas de borne)
+  class Reader {
+  public:
+    bool open(uint32_t from = 0, uint32_t to = 0);
+    bool next(Record& r);                        // false en fin de journal / au-delà de to
+    void close();
+    uint32_t bad() const { return bad_; }        // enregistrements rejetés (CRC)
+  private:
+    bool openSeg();
+    File f_;
+    Record blk_[16];
+    uint8_t n_ = 0, i_ = 0, seg_ = 0;
+    uint32_t from_ = 0, to_ = 0, mem_ = 0, memEnd_ = 0, bad_ = 0;
+    bool file_ = false, first_ = true;
+  };
+}
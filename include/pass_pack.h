@@ -0,0 +1,23 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "passage.h"
+
+// Lot de passages en binaire compact (topic MQTT base/batch, format "bin") ; sans dépendance Arduino.
+// Petit-boutiste, sans alignement :
+//   en-tête 12 o : 'P', version (2), n, flags, seq0 (u32), t0 (u32, epoch du premier passage)
+//   n x 13 o     : dt (u16, s depuis t0, saturé), dwell_ds (u16), speed_kmh, speed_raw,
+//                  dist_m, dist_out, angle (i8), snr, flags (bit 0 : dir, bits 1-3 : zone), ms (u16, 0..999)
+// flags d'en-tête, bit 0 (F_BOOT) : horloge pas encore calée, t0 en secondes depuis le boot.
+// Les passages d'un lot ont des séquences consécutives : seq = seq0 + i.
+namespace PassPack {
+  static const uint8_t MAGIC = 'P', VERSION = 2, F_BOOT = 1;
+  static const size_t  HDR_SIZE = 12, REC_SIZE = 13;
+
+  struct Header { uint32_t seq0, t0; uint8_t n, flags; };
+
+  size_t header(uint8_t* out, uint32_t seq0, uint32_t t0, uint8_t n, uint8_t flags = 0);
+  size_t record(uint8_t* out, const Passage& p, uint32_t t0);
+  // Contrôle la taille ; remplit out[0..min(n, max)[ ; false si lot invalide
+  bool   decode(const uint8_t* in, size_t len, Header& h, Passage* out, uint8_t max);
+}
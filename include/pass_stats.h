@@ -0,0 +1,40 @@
+#pragma once
+#include <stdint.h>
+#include "passage.h"
+#include "zones.h"
+
+// Statistiques des passages tenues à jour à l'insertion / l'éviction de
+// l'historique (plus de re-parcours de g_passes à chaque /api/stats).
+// Histogramme au km/h près (256 cases) : les classes de largeur quelconque,
+// le min et le max se déduisent en O(256), indépendamment du nombre de passages.
+// Deux histogrammes : vitesse retenue (corrigée) et vitesse radiale brute du radar,
+// plus un histogramme par zone de comptage (Passage::zone).
+namespace PassStats {
+  static const uint8_t MAX_BINS = 251;   // binw=1, binmax=250 : bornes acceptées par /api/options
+
+  struct Summary {
+    uint32_t count = 0, approach = 0, away = 0;
+    uint8_t  vmin = 0, vmax = 0;
+    float    vmean = 0;
+    uint8_t  rmin = 0, rmax = 0;   // vitesse radiale brute
+    float    rmean = 0;
+  };
+
+  struct ZoneSummary {
+    uint32_t count = 0, approach = 0, away = 0;
+    uint8_t  vmin = 0, vmax = 0, v85 = 0;
+    float    vmean = 0;
+  };
+
+  void add(const Passage& p);
+  void remove(const Passage& p);
+  void reset();
+
+  Summary  summary();
+  ZoneSummary zone(uint8_t z);   // z = 1..Zones::MAX_ZONES
+  // Regroupe l'histogramme en classes [i*w, i*w+w-1] ; la dernière classe (>= maxKmh) est ouverte.
+  // Renvoie le nombre de classes écrites dans out (<= cap).
+  uint8_t  bins(uint8_t w, uint8_t maxKmh, uint32_t* out, uint8_t cap);
+  const uint32_t* hours();      // [24] par heure locale
+  const uint32_t* weekdays();   // [7]  0 = dimanche
+}
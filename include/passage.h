@@ -0,0 +1,15 @@
+#pragma once
+#include <stdint.h>
+#include <time.h>
+
+// Un passage détecté (une ligne de l'historique / du CSV) = une piste close du Tracker.
+// dist_m / dist_out : distances d'entrée et de sortie de piste ; dwell_ds : durée de présence (1/10 s)
+// speed_kmh : vitesse retenue (corrigée par SpeedCorr si activé) ; speed_raw : vitesse radiale du radar
+// zone : 1..Zones::MAX_ZONES (zone de comptage de la piste), 0 : aucune
+// ts + ms : instant de la vitesse de pointe (Clock::stamp) ; ms & MS_PENDING : horloge pas encore calée,
+// ts = secondes depuis le boot (corrigé en bloc à la synchro, voir clock.h)
+// ms & MS_HOLE : séquence sans passage (perdu à une coupure, enregistrement illisible) ; n'existe
+// qu'en RAM pour garder les numéros de l'historique, ni publiée, ni comptée, ni journalisée
+struct Passage { time_t ts; int8_t angle; uint8_t dist_m; uint8_t speed_kmh; uint8_t dir; uint8_t snr; uint8_t dist_out; uint16_t dwell_ds; uint8_t speed_raw; uint8_t zone; uint16_t ms;
+  static const uint16_t MS_PENDING = 0x8000, MS_HOLE = 0x4000, MS_MASK = 0x3FF;
+  bool hole() const { return ms & MS_HOLE; } };
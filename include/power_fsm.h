@@ -0,0 +1,39 @@
+#pragma once
+#include <stdint.h>
+
+// Politique d'énergie : une machine à états pilotée par événements ; sans dépendance Arduino
+// (banc hôte à horloge virtuelle : tools/power_sim.cpp).
+//  - Entrées : config (PowerCfg : veille autorisée, mode), radar opérationnel, override GPIO
+//    (fronts par interruption), activité (USER : HTTP, page ouverte, passage ; RADAR : cibles).
+//  - Délais (inactivité) : échéance unique recalculée à chaque évaluation ; poll() ne coûte
+//    qu'une comparaison tant qu'aucun événement ni échéance n'est survenu.
+//  - Sorties : poll() signale chaque transition ; l'appelant n'applique le matériel (Wi-Fi PS,
+//    Wi-Fi coupé) que sur transition, et découpe le light-sleep tant que l'état le demande.
+// Veille permise = sleep && radar OK && pas d'override, puis selon le mode :
+//   1 : MODEM_SLEEP ; 2 : LIGHT_SLEEP après LIGHT_IDLE_MS sans activité (USER ou RADAR) ;
+//   3 : RADIO_OFF après RADIO_KEEP_MS sans activité USER (les cibles ne rallument pas le Wi-Fi).
+namespace PowerFsm {
+  enum State : uint8_t { ACTIVE, MODEM_SLEEP, LIGHT_SLEEP, RADIO_OFF, STATES };
+  enum Src   : uint8_t { USER, RADAR };
+  static const uint32_t LIGHT_IDLE_MS = 3000;
+  static const uint32_t RADIO_KEEP_MS = 20000;
+
+  struct Cfg { bool sleep; uint8_t mode; };     // PowerCfg::Settings : wifi_sleep, sleep_mode
+  struct Stats {
+    uint32_t transitions;
+    uint32_t evals;                 // réévaluations (événement ou échéance)
+    uint32_t ms_in[STATES];         // temps passé dans chaque état
+  };
+
+  void  begin(const Cfg& c, uint32_t nowMs);
+  void  setCfg(const Cfg& c);
+  void  setRadarOk(bool ok);
+  void  setOverride(bool on);
+  void  activity(Src s, uint32_t nowMs);
+  // Transition due maintenant : true, from/to renseignés (une par appel) ; sinon false
+  bool  poll(uint32_t nowMs, State& from, State& to);
+  State state();
+  bool  overridden();
+  Stats stats(uint32_t nowMs);
+  const char* name(State s);
+}
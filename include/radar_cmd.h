@@ -0,0 +1,54 @@
+#pragma once
+#include <Arduino.h>
+#include <functional>
+#include <initializer_list>
+#include "ld2451_proto.h"
+
+// Moteur de transactions de commandes LD2451, non bloquant.
+// Une transaction (job) = ENABLE_CFG -> N commandes -> END_CFG, déroulée par une
+// machine à états alimentée par les ACK remontés par la tâche radar (onAck) et
+// par poll() pour l'envoi/les timeouts. Fin signalée par callback (dans loop())
+// et consultable par id (/api/cfg/job?id=).
+namespace RadarCmd {
+  static const uint8_t MAX_STEPS = 6;          // commandes par job, hors ENABLE/END
+  static const uint8_t RET_MAX   = 16;         // octets de retour conservés par ACK
+  static const uint8_t HISTORY   = 8;          // jobs en file + terminés consultables
+
+  struct Step { uint16_t cmd; uint8_t v[4]; uint8_t n; uint16_t timeout_ms; };
+  struct StepResult { bool acked; uint16_t status; uint8_t n; uint8_t data[RET_MAX]; };
+  enum State : uint8_t { QUEUED, RUNNING, DONE, FAILED };
+
+  struct Job;
+  typedef std::function<void(const Job&)> Callback;
+  // Appelé après chaque ACK enregistré ; peut ajouter des étapes avant END_CFG
+  // (ex. lire puis n'écrire que ce qui diffère, dans la même session).
+  typedef std::function<void(Job&, uint8_t stepIdx)> StepHook;
+
+  struct Job {
+    uint32_t   id = 0;
+    const char* name = "";
+    State      state = DONE;
+    uint8_t    n = 0, cur = 0;
+    bool       wrap = true, sent = false;
+    Step       steps[MAX_STEPS + 2];
+    StepResult res[MAX_STEPS + 2];
+    uint32_t   t_submit = 0, t_start = 0, t_end = 0, t_sent = 0;
+    Callback   cb;
+    StepHook   hook;
+    bool ok() const { return state == DONE; }
+    const StepResult* result(uint16_t cmd) const;   // 1er résultat pour cette commande
+  };
+
+  Step step(uint16_t cmd, const uint8_t* v = nullptr, uint8_t n = 0, uint16_t timeout_ms = 1500);
+  // Renvoie l'id du job, 0 si la file est pleine. wrapCfg : encadre par ENABLE/END.
+  uint32_t submit(const char* name, std::initializer_list<Step> steps, Callback cb = nullptr, bool wrapCfg = true);
+  uint32_t submit(const char* name, const Step* steps, uint8_t n, Callback cb = nullptr, bool wrapCfg = true);
+  bool setHook(uint32_t id, StepHook hook);   // job encore en file uniquement
+  bool insertBeforeEnd(Job& j, const Step& s);
+  void send(uint16_t cmd, const uint8_t* payload, uint16_t plen);   // trame brute, sans attente d'ACK
+  void onAck(uint16_t ackCmd, uint16_t status, const uint8_t* data, uint8_t n);
+  void poll();
+  const Job* find(uint32_t id);
+  bool idle();
+  const char* stateStr(State s);
+}
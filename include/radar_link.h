@@ -0,0 +1,49 @@
+#pragma once
+#include <Arduino.h>
+#include <functional>
+
+// Débit de la liaison UART avec le LD2451, non bloquant (au-dessus de RadarCmd / RadarTask).
+//  - Autobaud : essai des débits du radar (dernier connu d'abord) ; un débit est retenu sur
+//    poignée de main ENABLE_CFG + READ_VERSION acquittée (des octets reçus ne suffisent pas).
+//  - Bascule (switchTo, ou want au boot) : SET_BAUD + REBOOT au débit courant, attente du
+//    redémarrage, puis VERIFY_N poignées de main au nouveau débit avant de l'adopter.
+//    Liaison partielle (au moins une réussie) : retour à l'ancien débit par le même chemin ;
+//    aucune réponse : nouvel autobaud complet. Le débit n'est signalé (onReady, à persister)
+//    qu'une fois vérifié.
+//  - Perte : octets reçus sans trame valide pendant LOST_MS (radar redémarré à un autre débit,
+//    retour usine...) -> autobaud ; échec -> nouvel essai après attente exponentielle.
+// Trame à 16 cibles (92 o) : 8 ms sur le fil à 115200, 2 ms à 460800.
+namespace RadarLink {
+  enum State : uint8_t { IDLE, PROBE, SWITCH, REBOOT_WAIT, VERIFY, LOST };
+  static const uint32_t HIGH_BAUD = 460800;
+  static const uint32_t REBOOT_MS = 1500;     // SET_BAUD + REBOOT -> radar à l'écoute
+  static const uint8_t  VERIFY_N  = 3;
+  static const uint32_t LOST_MS   = 10000;
+  static const uint32_t RETRY_MIN_MS = 10000, RETRY_MAX_MS = 300000;
+
+  struct Stats {
+    uint8_t  state;
+    uint32_t baud;            // débit courant côté ESP32
+    uint32_t scans;           // autobauds lancés (boot compris)
+    uint32_t probes;          // poignées de main tentées
+    uint32_t switches;        // bascules de débit réussies
+    uint32_t reverts;         // bascules annulées (liaison partielle au nouveau débit)
+    uint32_t lost;            // pertes de liaison détectées
+    uint32_t scan_ms;         // durée du dernier autobaud réussi
+  };
+  typedef std::function<void(uint32_t baud)> ReadyFn;
+
+  uint32_t idxToBaud(int idx);                 // index CMD_SET_BAUD (1..8) -> bauds, 115200 par défaut
+  int      baudToIdx(uint32_t baud);
+  // Lance l'autobaud (last en premier) ; want : débit visé ensuite (0 : garder celui trouvé).
+  // onReady : appelé dans loop() à chaque débit vérifié
+  void     begin(uint32_t last, uint32_t want, ReadyFn onReady);
+  uint32_t switchTo(uint32_t baud);            // id du job SET_BAUD ; 0 si occupé ou débit inconnu
+  void     setWant(uint32_t baud);
+  void     rescan(uint32_t delayMs = 0);       // ex. après un retour usine
+  void     poll();                             // loop()
+  bool     ready();                            // débit vérifié, liaison exploitable
+  uint32_t baud();
+  Stats    stats();
+  const char* stateStr(uint8_t s);
+}
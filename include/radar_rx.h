@@ -0,0 +1,114 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "ld2451_proto.h"
+
+// Ingestion UART du LD2451 : anneau de taille fixe + découpage des trames.
+//  - push() copie les octets reçus en bloc ; ce qui ne rentre pas est compté
+//    dans overflow_drops (plus de purge silencieuse de 2048/4096 octets).
+//  - next() recherche DAT_HDR/CMD_HDR à partir de la position de lecture et
+//    renvoie la trame complète sous forme de Span (2 segments si wrap-around),
+//    sans copie. La trame reste en place jusqu'à release().
+//  - Chaque octet est dépassé au plus une fois par le scan (rd_ ne recule
+//    jamais) et un en-tête candidat coûte O(1) (LEN + tail) : coût linéaire
+//    au pire cas, même sur une ligne bruitée.
+// Sans dépendance Arduino : réutilisable sur PC (tools/).
+namespace RadarRx {
+
+  struct Span {
+    const uint8_t* a = nullptr; size_t na = 0;   // segment jusqu'à la fin du buffer
+    const uint8_t* b = nullptr; size_t nb = 0;   // suite depuis le début (wrap)
+    size_t size() const { return na + nb; }
+    uint8_t operator[](size_t i) const { return i < na ? a[i] : b[i - na]; }
+    // Vue contiguë : directe sans wrap, sinon recopiée dans scratch (>= size()).
+    const uint8_t* linear(uint8_t* scratch) const {
+      if (!nb) return a;
+      memcpy(scratch, a, na); memcpy(scratch + na, b, nb); return scratch;
+    }
+    bool equals(const uint8_t* p, size_t n) const {
+      if (n != size()) return false;
+      return memcmp(a, p, na) == 0 && (!nb || memcmp(b, p + na, nb) == 0);
+    }
+  };
+
+  enum Kind : uint8_t { NONE = 0, DATA, ACK };
+
+  struct Frame {
+    Kind     kind = NONE;
+    uint16_t len  = 0;     // champ LEN (hors en-tête/LEN/tail)
+    Span     raw;          // trame complète HDR..TAIL
+  };
+
+  struct Stats {
+    uint32_t bytes_in = 0, overflow_drops = 0;
+    uint32_t resync_bytes = 0, bad_tail = 0, bad_len = 0;
+  };
+
+  template<size_t N>
+  class Ring {
+    static_assert(N >= 2 * (10 + DAT_MAX_LEN) && (N & (N - 1)) == 0, "N: power of two, >= 2 frames");
+  public:
+    size_t push(const uint8_t* p, size_t n){
+      size_t room = N - used();
+      if (n > room) { st_.overflow_drops += n - room; n = room; }
+      size_t i = wr_ & (N - 1), first = (n < N - i) ? n : N - i;
+      memcpy(buf_ + i, p, first);
+      memcpy(buf_, p + first, n - first);
+      wr_ += n; st_.bytes_in += n;
+      return n;
+    }
+
+    bool next(Frame& f){
+      for (;;) {
+        Kind k = scanHeader();
+        if (k == NONE || used() < 6) return false;
+        uint16_t L = uint16_t(at(rd_ + 4)) | (uint16_t(at(rd_ + 5)) << 8);
+        if (L > (k == DATA ? DAT_MAX_LEN : CMD_MAX_LEN) || (k == ACK && L < 2)) {
+          st_.bad_len++; skip(1); continue;
+        }
+        size_t FL = 4 + 2 + size_t(L) + 4;
+        if (used() < FL) return false;             // trame incomplète : on attend
+        const uint8_t* T = (k == DATA) ? DAT_TAIL : CMD_TAIL;
+        uint32_t t = rd_ + uint32_t(FL) - 4;
+        if (at(t) != T[0] || at(t+1) != T[1] || at(t+2) != T[2] || at(t+3) != T[3]) {
+          st_.bad_tail++; skip(1); continue;       // faux en-tête : on glisse d'1 octet
+        }
+        f.kind = k; f.len = L; f.raw = span(rd_, FL);
+        return true;
+      }
+    }
+    void release(const Frame& f){ rd_ += uint32_t(f.raw.size()); }
+
+    size_t used() const { return size_t(wr_ - rd_); }
+    void clear(){ rd_ = wr_; }
+    const Stats& stats() const { return st_; }
+
+  private:
+    uint8_t at(uint32_t i) const { return buf_[i & (N - 1)]; }
+    void skip(size_t n){ rd_ += uint32_t(n); st_.resync_bytes += uint32_t(n); }
+    Span span(uint32_t from, size_t n) const {
+      Span s; size_t i = from & (N - 1);
+      s.a = buf_ + i; s.na = (n < N - i) ? n : N - i;
+      s.b = buf_;     s.nb = n - s.na;
+      return s;
+    }
+    // Avance rd_ jusqu'au prochain en-tête ; garde les 3 derniers octets
+    // (en-tête possiblement coupé) quand rien n'est trouvé.
+    Kind scanHeader(){
+      uint32_t p = rd_; Kind k = NONE;
+      while (wr_ - p >= 4) {
+        uint8_t c = at(p);
+        if (c == DAT_HDR[0] && at(p+1) == DAT_HDR[1] && at(p+2) == DAT_HDR[2] && at(p+3) == DAT_HDR[3]) { k = DATA; break; }
+        if (c == CMD_HDR[0] && at(p+1) == CMD_HDR[1] && at(p+2) == CMD_HDR[2] && at(p+3) == CMD_HDR[3]) { k = ACK;  break; }
+        ++p;
+      }
+      skip(p - rd_);
+      return k;
+    }
+
+    uint8_t  buf_[N];
+    uint32_t rd_ = 0, wr_ = 0;   // compteurs libres (modulo 2^32), index = & (N-1)
+    Stats    st_;
+  };
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <Arduino.h>
+#include "radar_rx.h"
+
+// Tâche d'ingestion radar (FreeRTOS) : UART2 piloté par le driver ESP-IDF et
+// sa file d'événements, découpage des trames dans la tâche (RadarRx::Ring).
+// Les cibles décodées et les ACK sont remis à loop() par des files bornées :
+// un loop() bloqué (HTTP, connexion MQTT, light-sleep) ne fait plus déborder
+// le FIFO UART.
+namespace RadarTask {
+  static const uint8_t MAX_TARGETS = 16;   // cibles conservées par trame (le reste est compté)
+  static const uint8_t TGT_BINS    = 9;    // histogramme cibles/trame : 0..7, 8 et plus
+  static const uint32_t FPS_WIN_US = 5000000;
+
+  struct Target { int8_t angle; uint8_t dist_m, dir, speed_kmh, snr; };
+  struct TargetFrame {
+    uint32_t t_us;         // arrivée estimée du 1er octet (esp_timer, µs)
+    uint8_t  count;        // cibles dans t[]
+    uint8_t  truncated;    // cibles au-delà de MAX_TARGETS
+    Target   t[MAX_TARGETS];
+  };
+  struct Ack { uint16_t cmd; uint16_t status; uint8_t n; uint8_t data[CMD_MAX_LEN]; uint32_t t_ms; };
+
+  struct Stats {
+    uint32_t bytes_rx = 0, frames_data = 0, frames_ack = 0, echo_drops = 0;
+    uint32_t queue_drops = 0;      // trames perdues : file vers loop() pleine
+    uint32_t hw_overflows = 0;     // UART_FIFO_OVF / UART_BUFFER_FULL côté driver
+    uint32_t lat_last_us = 0, lat_max_us = 0;   // octet -> trame consommée par loop()
+    uint32_t frames_empty = 0;     // trames de données sans cible
+    uint32_t targets = 0;          // cibles annoncées (y compris tronquées)
+    uint32_t truncated = 0;        // cibles au-delà de MAX_TARGETS
+    uint32_t tgt_hist[TGT_BINS] = {};
+    uint16_t fps_x10 = 0;          // trames de données/s x10 sur FPS_WIN_US (0 si radar muet)
+    uint32_t last_frame_ms = 0;    // millis() de la dernière trame valide (données ou ACK), 0 : aucune
+  };
+
+  bool begin(uint32_t baud, int rxPin, int txPin);
+  // Change le débit côté ESP32 (autobaud, bascule RadarLink) ; l'octet en cours est perdu,
+  // le parseur se recale sur le prochain en-tête
+  void setBaud(uint32_t baud);
+  uint32_t baud();
+  void write(const uint8_t* p, size_t n);      // envoi + mémorisation pour le filtre d'écho
+  bool popFrame(TargetFrame& f);               // non bloquant
+  bool popAck(Ack& a, uint32_t timeout_ms);
+  uint32_t noteConsumed(const TargetFrame& f); // met à jour et renvoie la latence octet -> trame (µs)
+  Stats stats();
+  RadarRx::Stats rxStats();
+}
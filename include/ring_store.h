@@ -0,0 +1,60 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Historique circulaire de capacité fixe N (paramètre de compilation).
+//  - push() : O(1), évince le plus ancien quand c'est plein (pas de memmove).
+//  - Numéros de séquence stables : 1er élément = 1 (ou resume()), jamais réutilisés
+//    (même après clear()) ; l'élément de séquence s vit en buf_[s % N].
+//  - Parcours du plus ancien au plus récent (range-for) ou par newest(i)/bySeq(s).
+// La mémoire (bytes()) est fournie une seule fois via attach() : RAM interne ou
+// PSRAM selon la carte, jamais réallouée ensuite.
+template<typename T, size_t N>
+class RingStore {
+  static_assert(N > 0, "capacity must be > 0");
+public:
+  static constexpr size_t capacity(){ return N; }
+  static constexpr size_t bytes(){ return N * sizeof(T); }
+
+  bool attach(void* mem){ buf_ = static_cast<T*>(mem); return buf_ != nullptr; }
+  bool ready() const { return buf_ != nullptr; }
+
+  // Ajoute v ; renvoie son numéro de séquence (0 si pas de mémoire).
+  uint32_t push(const T& v){
+    if (!buf_) return 0;
+    buf_[next_ % N] = v;
+    if (next_ - first_ >= N) first_++;
+    return next_++;
+  }
+  void clear(){ first_ = next_; }
+  // Reprise après reboot : la prochaine séquence sera seq (store vide, seq >= 1)
+  void resume(uint32_t seq){ first_ = next_ = seq ? seq : 1; }
+
+  size_t   size()     const { return size_t(next_ - first_); }
+  bool     empty()    const { return next_ == first_; }
+  uint32_t firstSeq() const { return first_; }          // plus ancien présent
+  uint32_t lastSeq()  const { return next_ - 1; }       // plus récent (0 si jamais rien)
+
+  const T* bySeq(uint32_t s) const { return (s >= first_ && s < next_) ? &buf_[s % N] : nullptr; }
+  T*       bySeq(uint32_t s)       { return (s >= first_ && s < next_) ? &buf_[s % N] : nullptr; }   // correction en place
+  const T& newest(size_t i = 0) const { return buf_[(next_ - 1 - i) % N]; }   // i < size()
+  const T& oldest(size_t i = 0) const { return buf_[(first_ + i) % N]; }      // i < size()
+
+  class const_iterator {
+  public:
+    const_iterator(const RingStore* r, uint32_t s) : r_(r), s_(s) {}
+    const T& operator*() const { return r_->buf_[s_ % N]; }
+    const T* operator->() const { return &r_->buf_[s_ % N]; }
+    uint32_t seq() const { return s_; }
+    const_iterator& operator++(){ ++s_; return *this; }
+    bool operator!=(const const_iterator& o) const { return s_ != o.s_; }
+  private:
+    const RingStore* r_; uint32_t s_;
+  };
+  const_iterator begin() const { return const_iterator(this, first_); }
+  const_iterator end()   const { return const_iterator(this, next_); }
+
+private:
+  T*       buf_ = nullptr;
+  uint32_t first_ = 1, next_ = 1;
+};
@@ -0,0 +1,32 @@
+#pragma once
+#include <stdint.h>
+
+// Correction géométrique de la vitesse : le LD2451 mesure une vitesse radiale
+// (v · cos de l'angle entre la visée et l'axe de la route), sous-estimée hors axe.
+// Sans dépendance Arduino (bench hôte : tools/tracker_bench.cpp).
+//  - M_ANGLE : 1/cos(angle cible + lacet de montage) x terme d'élévation (hauteur).
+//  - M_GEOM  : à partir de la distance seule, d / sqrt(d² - h² - o²) (hauteur h,
+//    déport latéral o de la voie) ; insensible au bruit d'angle.
+// Facteurs en virgule fixe Q12 lus dans des tables constexpr (calculées à la
+// compilation, en flash) : une indexation et une multiplication par cible.
+// Facteur plafonné à 2 (60°) : au-delà la mesure radiale n'est plus exploitable.
+namespace SpeedCorr {
+  enum Mode : uint8_t { M_OFF, M_ANGLE, M_GEOM, M_COUNT };
+
+  static const uint16_t ONE = 4096;          // 1.0 en Q12
+  static const uint16_t MAX_FACTOR = 8192;   // 2.0 en Q12
+  static const uint8_t  MAX_ANGLE = 60;      // °
+
+  struct Geometry {
+    uint8_t  mode = M_OFF;
+    uint8_t  height_dm = 0;     // hauteur du radar au-dessus de la chaussée (dm)
+    uint16_t offset_dm = 0;     // déport latéral radar -> axe de la voie (dm)
+    int8_t   yaw_deg = 0;       // lacet de montage : axe radar vs axe route (°)
+  };
+
+  void     set(const Geometry& g);
+  Geometry get();
+  uint16_t factor(int8_t angle, uint8_t dist_m);                    // Q12, ONE si M_OFF
+  uint8_t  correct(uint8_t speed_kmh, int8_t angle, uint8_t dist_m);  // saturé à 255
+  const char* modeName(uint8_t m);
+}
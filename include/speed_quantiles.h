@@ -0,0 +1,26 @@
+#pragma once
+#include <stdint.h>
+#include <time.h>
+
+// Vitesses P50 / P85 (V85) en flux, mémoire constante quel que soit le trafic.
+// Estimateur P² (Jain & Chlamtac) : 5 marqueurs par quantile, mis à jour en O(1)
+// par passage, sans conserver les échantillons.
+// Découpage : 3 fenêtres (total depuis remise à zéro, jour local, heure locale)
+// x 3 sens (éloignement, approche, tous). Le total et la fenêtre courante sont
+// sauvés en NVS à chaque changement d'heure : un reboot perd au plus une heure.
+namespace SpeedQ {
+  enum Window : uint8_t { W_TOTAL = 0, W_DAY, W_HOUR, W_COUNT };
+  enum Dir    : uint8_t { D_AWAY = 0, D_APPROACH, D_ALL, D_COUNT };
+
+  struct Result { uint32_t n = 0; float p50 = 0, p85 = 0; };
+
+  void begin();                        // recharge l'état NVS
+  void add(time_t ts, uint8_t dir, uint8_t speed_kmh);   // ts = 0 : heure inconnue (total seul)
+  bool tick(time_t now);               // bascule jour/heure vers l'avant ; true si une fenêtre a été fermée
+  void reset();                        // remet tout à zéro (NVS compris)
+
+  Result get(Window w, Dir d);
+  const char* windowName(Window w);    // "total" / "day" / "hour"
+  const char* dirName(Dir d);          // "away" / "approach" / "all"
+  uint32_t changes();                  // incrémenté à chaque add/reset (détection de nouveauté)
+}
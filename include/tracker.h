@@ -0,0 +1,58 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Pistage multi-cibles : une piste par véhicule, un passage par piste terminée.
+// Sans dépendance Arduino (bench hôte : tools/tracker_bench.cpp).
+//  - Association trame à trame par porte (gating) sur sens, angle, distance
+//    prédite (vitesse radiale x dt) et vitesse ; affectation gloutonne au coût
+//    normalisé le plus faible. Au plus MAX_TRACKS pistes simultanées.
+//  - Une piste sans détection depuis Params::gap_us est close ; elle produit un
+//    Result si elle a au moins min_hits détections. Une piste encore sous min_hits
+//    après confirm_us est abandonnée : sa prédiction balaierait sinon toute la
+//    portée et capterait des cibles parasites.
+//  - Coût par trame : O(cibles x pistes) <= 16 x 8 comparaisons entières.
+namespace Tracker {
+  static const uint8_t MAX_TRACKS = 8;
+  static const uint8_t MAX_DETS   = 16;    // cibles prises en compte par trame
+
+  // speed_kmh : radiale (association, prédiction de distance) ; speed_true : corrigée (SpeedCorr)
+  // zones : masque des zones contenant la cible (Zones), la piste retient la plus fréquente
+  struct Det { int8_t angle; uint8_t dist_m, dir, speed_kmh, snr, speed_true, zones; };
+
+  struct Params {
+    uint32_t gap_us    = 1500000;   // silence qui clôt une piste
+    uint32_t confirm_us = 500000;   // une piste doit atteindre min_hits dans ce délai (sinon fausse cible)
+    uint8_t  gate_ang  = 12;        // |Δangle| max (°)
+    uint8_t  gate_dist = 4;         // |distance - prédiction| max (m)
+    uint8_t  gate_spd  = 15;        // |Δvitesse| max (km/h)
+    uint8_t  min_hits  = 3;         // détections mini pour valider un passage
+  };
+
+  // Passage issu d'une piste close
+  struct Result {
+    uint32_t t_first_us, t_last_us, t_peak_us;
+    uint16_t hits;
+    uint8_t  dir, peak_kmh, dist_in, dist_out, snr;   // snr / angle / peak_true : à la vitesse de pointe
+    uint8_t  peak_true;
+    uint8_t  zone;         // 1 + bit de zone le plus vu sur la piste, 0 : hors zone
+    int8_t   angle;
+  };
+
+  struct Stats {
+    uint32_t frames = 0, dets = 0, opened = 0, passes = 0;
+    uint32_t short_drops = 0;      // pistes closes sous min_hits
+    uint32_t full_drops  = 0;      // détections sans piste libre
+  };
+
+  void    setParams(const Params& p);
+  Params  params();
+  // Intègre une trame (t_us : horodatage de la trame) ; les pistes closes au passage
+  // sont écrites dans out (au plus cap) et leur nombre renvoyé.
+  uint8_t update(uint32_t t_us, const Det* d, uint8_t n, Result* out, uint8_t cap);
+  // Clôt les pistes silencieuses sans nouvelle trame (radar muet entre deux véhicules)
+  uint8_t expire(uint32_t now_us, Result* out, uint8_t cap);
+  uint8_t active();
+  void    reset();
+  Stats   stats();
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Zones de détection (voies, trottoir...) : polygones dans le plan angle / distance.
+// Sans dépendance Arduino.
+//  - Zone « comptage » : si au moins une existe, une cible hors de toutes est ignorée.
+//  - Zone « ignorer » : toute cible dedans est ignorée (prioritaire).
+// Les polygones sont rastérisés (balayage par ligne) à chaque modification dans une
+// grille de COLS x ROWS cellules de 4 bits (un bit par zone, 4 Ko) : classer une
+// cible = un accès mémoire, quel que soit le nombre de zones ou de sommets.
+namespace Zones {
+  static const uint8_t MAX_ZONES = 4;          // un bit par zone dans la grille
+  static const uint8_t MAX_PTS   = 8;
+  static const uint8_t NAME_LEN  = 16;
+  static const int8_t  ANG_MIN   = -64;        // grille : [-64°, +64°[ par pas de 2°
+  static const uint8_t ANG_STEP  = 2;
+  static const uint8_t COLS      = 64;
+  static const uint8_t ROWS      = 128;        // [0, 128 m[ par pas de 1 m (au-delà : dernière ligne)
+
+  enum Kind : uint8_t { K_COUNT, K_IGNORE, K_COUNT_KINDS };
+
+  struct Pt { int8_t angle; uint8_t dist_m; };
+  struct Zone {
+    uint8_t n = 0;                 // sommets ; 0 = zone libre
+    uint8_t kind = K_COUNT;
+    char    name[NAME_LEN] = {0};
+    Pt      pts[MAX_PTS];
+  };
+
+  bool        set(uint8_t i, const Zone& z);   // n = 0 efface ; 3..MAX_PTS sinon ; re-rastérise
+  const Zone& get(uint8_t i);
+  uint8_t     lookup(int8_t angle, uint8_t dist_m);   // masque des zones contenant la cible
+  bool        keep(uint8_t mask);                     // false : cible à ignorer
+  uint8_t     countMask();                            // zones de comptage définies
+  uint8_t     active();                               // zones définies
+
+  // Texte "kind|nom|a,d;a,d;..." (config.txt) ; sommets seuls "a,d;a,d;..." pour parsePts
+  bool        parse(const char* s, Zone& z);
+  bool        parsePts(const char* s, Zone& z);
+  size_t      format(const Zone& z, char* out, size_t cap);
+  size_t      formatPts(const Zone& z, char* out, size_t cap);
+  const char* kindName(uint8_t k);
+  uint8_t     kindFromName(const char* s);
+}
@@ -0,0 +1,82 @@
+#include "clock.h"
+#include "passage.h"
+#include <Preferences.h>
+#include <esp_timer.h>
+#include <sys/time.h>
+#include <string.h>
+
+namespace Clock {
+  static const char* NS    = "clock";
+  static const char* K_BOOT = "boot";
+  static const char* K_FIX  = "fix";
+
+  // Correction d'un boot : heure murale de l'instant monotone 0 (esp_timer) de ce boot
+  struct Fix { uint16_t boot, frac_ms; uint32_t epoch; };
+  static Fix      s_fix[BOOTS];
+  static uint16_t s_boot = 0;
+  static bool     s_synced = false;
+  static int64_t  s_offUs = 0;     // heure murale (µs) - monotone (µs)
+  static uint32_t s_steps = 0;
+
+  void begin(){
+    Preferences p; memset(s_fix, 0, sizeof(s_fix));
+    if (p.begin(NS, false)) {
+      s_boot = uint16_t(p.getUShort(K_BOOT, 0) + 1); if (!s_boot) s_boot = 1;   // 0 : enregistrement antérieur
+      p.putUShort(K_BOOT, s_boot);
+      if (p.getBytesLength(K_FIX) == sizeof(s_fix)) p.getBytes(K_FIX, s_fix, sizeof(s_fix));
+      p.end();
+    }
+    Serial.printf("[CLOCK] boot #%u\n", (unsigned)s_boot);
+  }
+
+  // Ajoute la correction du boot courant (remplace la plus ancienne) ; une écriture NVS par boot
+  static void saveFix(){
+    uint8_t k = 0;
+    for (uint8_t i = 0; i < BOOTS; i++) {
+      if (s_fix[i].boot == s_boot || !s_fix[i].boot) { k = i; break; }
+      if (s_fix[i].epoch < s_fix[k].epoch) k = i;
+    }
+    const int64_t ms = s_offUs / 1000;
+    s_fix[k].boot = s_boot; s_fix[k].epoch = uint32_t(ms / 1000); s_fix[k].frac_ms = uint16_t(ms % 1000);
+    Preferences p; if (p.begin(NS, false)) { p.putBytes(K_FIX, s_fix, sizeof(s_fix)); p.end(); }
+  }
+
+  bool poll(){
+    struct timeval tv; gettimeofday(&tv, nullptr);
+    if (tv.tv_sec < MIN_VALID_EPOCH) return false;
+    const int64_t off = int64_t(tv.tv_sec) * 1000000 + tv.tv_usec - esp_timer_get_time();
+    if (!s_synced) {
+      s_offUs = off; s_synced = true; saveFix();
+      Serial.printf("[CLOCK] synced, boot #%u at %lu.%03u\n", (unsigned)s_boot, (unsigned long)(s_offUs / 1000000), (unsigned)(s_offUs / 1000 % 1000));
+      return true;
+    }
+    const int64_t d = off - s_offUs;
+    if (d > int64_t(STEP_US) || d < -int64_t(STEP_US)) {   // NTP a recalé l'heure système : on suit, par palier
+      s_offUs = off; s_steps++;
+      Serial.printf("[CLOCK] step %ld ms\n", (long)(d / 1000));
+    }
+    return false;
+  }
+
+  bool     synced(){ return s_synced; }
+  uint16_t boot(){ return s_boot; }
+  int64_t  monoUs(){ return esp_timer_get_time(); }
+  uint32_t steps(){ return s_steps; }
+
+  void stamp(int64_t mono, time_t& ts, uint16_t& ms){
+    if (s_synced) { const int64_t w = (mono + s_offUs) / 1000; ts = time_t(w / 1000); ms = uint16_t(w % 1000); return; }
+    const int64_t b = mono / 1000;
+    ts = time_t(b / 1000); ms = uint16_t(b % 1000) | Passage::MS_PENDING;
+  }
+
+  bool resolve(uint16_t b, uint32_t& sec, uint16_t& ms){
+    if (!b) return false;
+    for (uint8_t i = 0; i < BOOTS; i++) {
+      if (s_fix[i].boot != b) continue;
+      const uint32_t m = uint32_t(s_fix[i].frac_ms) + (ms & Passage::MS_MASK);
+      sec = s_fix[i].epoch + sec + m / 1000; ms = uint16_t(m % 1000);
+      return true;
+    }
+    return false;
+  }
+}
@@ -0,0 +1,118 @@
+#include "json_out.h"
+#include <string.h>
+
+static const uint8_t MAX_DEPTH = 15;
+
+JsonOut::JsonOut(char* buf, size_t cap, Sink sink, void* ctx) : m_buf(buf), m_cap(cap), m_sink(sink), m_ctx(ctx) {}
+
+void JsonOut::reset(){ m_len = 0; m_first = m_isArr = 0; m_depth = 0; m_afterKey = m_over = false; }
+
+// Un octet toujours réservé au '\0' de c_str()
+void JsonOut::put(const char* s, size_t n){
+  while (n) {
+    const size_t room = m_cap - 1 - m_len, k = n < room ? n : room;
+    memcpy(m_buf + m_len, s, k); m_len += k; s += k; n -= k;
+    if (!n) return;
+    if (!m_sink) { m_over = true; return; }
+    flush();
+  }
+}
+
+void JsonOut::flush(){ if (m_sink && m_len) { m_sink(m_ctx, m_buf, m_len); m_len = 0; } }
+
+const char* JsonOut::c_str(){ m_buf[m_len] = 0; return m_buf; }
+
+void JsonOut::sep(){
+  if (m_afterKey) { m_afterKey = false; return; }
+  const uint16_t bit = uint16_t(1u << m_depth);
+  if (m_first & bit) m_first &= uint16_t(~bit);
+  else if (m_depth) put1(',');
+}
+
+JsonOut& JsonOut::obj(){
+  sep(); put1('{');
+  if (m_depth == MAX_DEPTH) { m_over = true; return *this; }
+  m_depth++; m_first |= uint16_t(1u << m_depth); m_isArr &= uint16_t(~(1u << m_depth));
+  return *this;
+}
+
+JsonOut& JsonOut::arr(){
+  sep(); put1('[');
+  if (m_depth == MAX_DEPTH) { m_over = true; return *this; }
+  m_depth++; m_first |= uint16_t(1u << m_depth); m_isArr |= uint16_t(1u << m_depth);
+  return *this;
+}
+
+JsonOut& JsonOut::end(){
+  if (!m_depth) { m_over = true; return *this; }
+  put1((m_isArr >> m_depth) & 1 ? ']' : '}'); m_depth--; m_afterKey = false;
+  return *this;
+}
+
+JsonOut& JsonOut::key(const char* k){
+  sep(); put1('"'); put(k, strlen(k)); put1('"'); put1(':'); m_afterKey = true;
+  return *this;
+}
+
+// Caractères de contrôle, '"' et '\\' échappés ; UTF-8 recopié tel quel
+JsonOut& JsonOut::str(const char* s){
+  sep(); put1('"');
+  if (s) {
+    const char* run = s;
+    for (; *s; s++) {
+      const unsigned char c = (unsigned char)*s;
+      if (c >= 0x20 && c != '"' && c != '\\') continue;
+      put(run, size_t(s - run)); run = s + 1;
+      char e[6] = { '\\', char(c), 0, 0, 0, 0 }; size_t n = 2;
+      switch (c) {
+        case '\n': e[1] = 'n'; break;
+        case '\r': e[1] = 'r'; break;
+        case '\t': e[1] = 't'; break;
+        case '"': case '\\': break;
+        default: e[1] = 'u'; e[2] = '0'; e[3] = '0'; e[4] = "0123456789abcdef"[c >> 4]; e[5] = "0123456789abcdef"[c & 15]; n = 6;
+      }
+      put(e, n);
+    }
+    put(run, size_t(s - run));
+  }
+  put1('"');
+  return *this;
+}
+
+void JsonOut::digits(uint32_t v){
+  char t[10]; uint8_t n = 0;
+  do { t[9 - n++] = char('0' + v % 10); v /= 10; } while (v);
+  put(t + 10 - n, n);
+}
+
+JsonOut& JsonOut::u(uint32_t v){ sep(); digits(v); return *this; }
+
+JsonOut& JsonOut::i(int32_t v){
+  sep(); if (v < 0) put1('-');
+  digits(v < 0 ? 0u - uint32_t(v) : uint32_t(v));
+  return *this;
+}
+
+JsonOut& JsonOut::fix(int32_t v, uint8_t dec){
+  if (!dec) return i(v);
+  if (dec > 9) dec = 9;
+  sep(); if (v < 0) put1('-');
+  const uint32_t m = v < 0 ? 0u - uint32_t(v) : uint32_t(v);
+  uint32_t p = 1; for (uint8_t k = 0; k < dec; k++) p *= 10;
+  digits(m / p); put1('.');
+  char t[9]; uint32_t r = m % p;
+  for (uint8_t k = dec; k; k--) { t[k - 1] = char('0' + r % 10); r /= 10; }
+  put(t, dec);
+  return *this;
+}
+
+JsonOut& JsonOut::f(float v, uint8_t dec){
+  if (dec > 6) dec = 6;
+  float s = v; for (uint8_t k = 0; k < dec; k++) s *= 10;
+  if (!(s > -2.1e9f && s < 2.1e9f)) return null();   // NaN, inf, hors int32
+  return fix(int32_t(s < 0 ? s - 0.5f : s + 0.5f), dec);
+}
+
+JsonOut& JsonOut::b(bool v){ sep(); if (v) put("true", 4); else put("false", 5); return *this; }
+JsonOut& JsonOut::null(){ sep(); put("null", 4); return *this; }
+JsonOut& JsonOut::raw(const char* s, size_t n){ sep(); put(s, n); return *this; }
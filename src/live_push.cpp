@@ -0,0 +1,91 @@
+#include "live_push.h"
+#include <WiFi.h>
+#include <lwip/sockets.h>
+
+namespace LivePush {
+  static const uint32_t REQ_TIMEOUT_MS = 3000;
+  static const uint32_t KEEPALIVE_MS   = 15000;
+
+  struct Slot {
+    WiFiClient c;
+    bool     used = false, ready = false;   // ready = en-têtes SSE envoyés
+    uint32_t t0 = 0;
+    uint32_t tail = 0;                      // 4 derniers octets reçus : fin d'en-tête = "\r\n\r\n"
+  };
+  static WiFiServer* s_srv = nullptr;
+  static Slot        s_slot[MAX_CLIENTS];
+  static uint32_t    s_lastKa = 0;
+  static char        s_q[QUEUE_BYTES];      // événements formatés, écrits par service()
+  static size_t      s_qn = 0;
+  static bool        s_qFull = false;
+
+  static void drop(Slot& s){ s.c.stop(); s.used = s.ready = false; }
+
+  // Tout ou rien, sans attendre : envoi partiel ou fenêtre pleine -> client retiré
+  static bool writeAll(Slot& s, const char* p, size_t n){
+    const int fd = s.c.fd();
+    if (fd < 0 || ::send(fd, p, n, MSG_DONTWAIT) != (ssize_t)n) { drop(s); return false; }
+    return true;
+  }
+
+  void begin(uint16_t port){
+    if (s_srv) return;
+    s_srv = new WiFiServer(port, MAX_CLIENTS);
+    s_srv->begin(); s_srv->setNoDelay(true);
+    Serial.printf("[LIVE] SSE on :%u/events\n", (unsigned)port);
+  }
+
+  void end(){
+    for (auto& s: s_slot) if (s.used) drop(s);
+    s_qn = 0; s_qFull = false;
+    if (s_srv) { s_srv->stop(); delete s_srv; s_srv = nullptr; }
+  }
+
+  static void accept(){
+    if (!s_srv || !s_srv->hasClient()) return;
+    WiFiClient c = s_srv->available();
+    for (auto& s: s_slot) if (!s.used) { s.c = c; s.used = true; s.ready = false; s.tail = 0; s.t0 = millis(); return; }
+    c.print("HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n"); c.stop();
+  }
+
+  // Requête ignorée au-delà de la ligne vide : un seul flux est servi (/events), quel que soit le chemin
+  static void readRequest(Slot& s){
+    while (s.c.available() && s.tail != 0x0D0A0D0A) s.tail = (s.tail << 8) | uint8_t(s.c.read());
+    if (s.tail == 0x0D0A0D0A) {
+      static const char HDR[] =
+        "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n"
+        "Connection: keep-alive\r\nAccess-Control-Allow-Origin: *\r\n\r\nretry: 3000\n\n";
+      if (writeAll(s, HDR, sizeof(HDR) - 1)) s.ready = true;
+    } else if (millis() - s.t0 > REQ_TIMEOUT_MS) drop(s);
+  }
+
+  void service(){
+    if (!s_srv) return;
+    accept();
+    for (auto& s: s_slot) {
+      if (!s.used) continue;
+      if (!s.c.connected()) { drop(s); continue; }
+      if (!s.ready) { readRequest(s); continue; }
+      while (s.c.available()) s.c.read();   // rien d'attendu du navigateur
+    }
+    if (s_qFull || s_qn) {   // file pleine : événements perdus, reconnexion + rechargement
+      for (auto& s: s_slot) if (s.ready) { if (s_qFull) drop(s); else writeAll(s, s_q, s_qn); }
+    }
+    s_qn = 0; s_qFull = false;
+    if (millis() - s_lastKa > KEEPALIVE_MS) {
+      s_lastKa = millis();
+      for (auto& s: s_slot) if (s.ready) writeAll(s, ":ka\n\n", 5);
+    }
+  }
+
+  void publish(const char* event, const char* data, size_t len){
+    if (!clients() || s_qFull) return;
+    char head[32]; const int hn = snprintf(head, sizeof(head), "event: %s\ndata: ", event);
+    if (hn <= 0 || size_t(hn) >= sizeof(head) || s_qn + size_t(hn) + len + 2 > QUEUE_BYTES) { s_qFull = true; return; }
+    memcpy(s_q + s_qn, head, size_t(hn)); s_qn += size_t(hn);
+    memcpy(s_q + s_qn, data, len); s_qn += len;
+    memcpy(s_q + s_qn, "\n\n", 2); s_qn += 2;
+  }
+
+  uint8_t clients(){ uint8_t n = 0; for (auto& s: s_slot) if (s.ready) n++; return n; }
+}
@@ -8,93 +8,103 @@
 #include <algorithm>
 #include <ctime>
 #include "esp_system.h"
+#include <esp_timer.h>
 #include <esp_sleep.h>
 #include <esp_wifi.h>
 #include <PubSubClient.h>
 #include "power_cfg.h"
+#include "power_fsm.h"
 #include "mqtt_cfg.h"
 #include "wifi_cfg.h"
+#include "ld2451_proto.h"
+#include "radar_task.h"
+#include "radar_cmd.h"
+#include "radar_link.h"
+#include "ring_store.h"
+#include "passage.h"
+#include "pass_stats.h"
+#include "speed_quantiles.h"
+#include "live_push.h"
+#include "pass_log.h"
+#include "tracker.h"
+#include "speed_corr.h"
+#include "zones.h"
+#include "json_out.h"
+#include "mqtt_outbox.h"
+#include "mqtt_link.h"
+#include "metrics.h"
+#include "pass_pack.h"
+#include "clock.h"
+#include <Preferences.h>
+#include <esp_heap_caps.h>
 
 // ========================= CONFIG WIFI =========================
 #include "config.h"
-struct Passage;
 extern PowerCfg::Settings g_pw;
-static uint32_t lastActiveMs = 0;
-static void mqttPublishPass(const Passage& p);
+static void mqttDrain();
+static void livePublishPass(uint32_t seq, const Passage& p, const Passage* evicted);
 void handlePowerDiag();
-static void maybeDoLightSleep();
+static void lightSleepSlice();
 bool g_ld2451_ok = false;   // définition unique, PAS "static"
 
 static const char* TZ_EUROPE_PARIS = "CET-1CEST,M3.5.0/2,M10.5.0/3";
-static inline void bumpActivity(){ lastActiveMs = millis(); }
+static inline void bumpActivity(){ PowerFsm::activity(PowerFsm::USER, millis()); }
 
 // ========================= UART RADAR ==========================
 #define RADAR_RX 16  // ESP32 RX2  <= Radar TX
 #define RADAR_TX 17  // ESP32 TX2  => Radar RX
 static uint32_t g_uart_baud = 115200;
 
-// =================== Protocole HLK-LD2451 ======================
-static const uint8_t CMD_HDR[4]  = {0xFD,0xFC,0xFB,0xFA};
-static const uint8_t CMD_TAIL[4] = {0x04,0x03,0x02,0x01};
-static const uint8_t DAT_HDR[4]  = {0xF4,0xF3,0xF2,0xF1};
-static const uint8_t DAT_TAIL[4] = {0xF8,0xF7,0xF6,0xF5};
-
-enum : uint16_t {
-  CMD_ENABLE_CFG   = 0x00FF,
-  CMD_END_CFG      = 0x00FE, // payload 0x0001
-  CMD_SET_DET      = 0x0002, // 4B
-  CMD_GET_DET      = 0x0012, // +4B
-  CMD_SET_SENS     = 0x0003, // 4B
-  CMD_GET_SENS     = 0x0013, // +4B
-  CMD_READ_VERSION = 0x00A1,
-  CMD_SET_BAUD     = 0x00A0, // 2B index + reboot
-  CMD_REBOOT       = 0x00A2,
-  CMD_FACTORY_RST  = 0x00A3
-};
-
 // ====================== OPTIONS & ETAT =========================
 static bool PRINT_EMPTY   = false;
 static bool PRINT_RAW     = false;
 
 static bool     ONLY_APPROACH     = false;
 static uint8_t  MIN_SPEED         = 0;       // km/h mini
-static uint32_t PASS_DEBOUNCE_MS  = 1500;
+static uint32_t PASS_DEBOUNCE_MS  = 1500;    // silence qui clôt une piste (Tracker gap_us)
 
-static bool g_applyAtBoot = true;
-static int  g_baudIdxSaved = 5; // 115200
+static uint8_t  STATS_BIN_W   = 5;    // classes de vitesse /api/stats (km/h)
+static uint8_t  STATS_BIN_MAX = 60;   // dernière classe ouverte au-delà
+static uint16_t LOG_BUDGET_KB = 512;  // budget flash du journal PassLog (segments les plus anciens évincés)
 
-static struct { uint32_t bytes_rx=0, frames_data=0, frames_ack=0; } ST;
+static bool g_applyAtBoot = true;
+static const uint16_t LIVE_PORT = 81;   // SSE (LivePush), à côté du WebServer :80
+static int  g_baudIdxSaved = 5; // 115200 ; dernier débit vérifié par RadarLink (premier essayé au boot)
+static bool g_uartHi = false;     // bascule radar + ESP32 à RadarLink::HIGH_BAUD une fois la liaison établie
+enum MqFmt : uint8_t { MQ_JSON, MQ_BIN };   // payload du topic base/batch (mode groupé)
+static uint8_t g_mqFmt = MQ_BIN;
+static uint16_t g_metricsS = 0;   // publication de /api/metrics sur base/metrics (s, 0 = jamais)
+static bool     g_trace    = false;   // trace des latences par passage (Metrics PASS_FLASH / PASS_MQTT, log [TRC])
 
 // ====================== LOGIQUE PASSAGES =======================
-struct Passage { time_t ts; int8_t angle; uint8_t dist_m; uint8_t speed_kmh; uint8_t dir; uint8_t snr; };
-static std::vector<Passage> g_passes;
-static const size_t MAX_PASSES = 2000;
-static uint32_t g_lastPassMs = 0;
+#ifndef PASS_CAPACITY
+#define PASS_CAPACITY 2000   // build_flags -DPASS_CAPACITY=... sur les cartes avec plus de RAM/PSRAM
+#endif
+static RingStore<Passage, PASS_CAPACITY> g_passes;
 
 // ======================= CONFIG COURANTE =======================
 struct DetParams { uint8_t maxDist_m=20, dirMode=2, minSpeed_kmh=0, noTargetDelay_s=2; bool valid=false; };
 struct SensParams{ uint8_t trigCount=1, snrLevel=4, ext1=0, ext2=0; bool valid=false; };
 static DetParams  g_det;
 static SensParams g_sens;
+// Miroir de ce que contient réellement le radar (dernier GET/SET acquitté)
+static DetParams  g_rdet;
+static SensParams g_rsens;
 
 // ========================== UTILS ==============================
-static String hex2(uint8_t b){ static const char* d="0123456789ABCDEF"; String s; s+=d[b>>4]; s+=d[b&0xF]; return s; }
-static String toHex(const uint8_t* p, size_t n, const char* sep=" "){ String s; s.reserve(n*3); for(size_t i=0;i<n;i++){ s+=hex2(p[i]); if(i+1<n) s+=sep; } return s; }
-static String fmtDate(time_t t){ if(!t) return F("-"); struct tm tm; localtime_r(&t,&tm); char buf[32]; strftime(buf,sizeof(buf),"%Y-%m-%d %H:%M:%S",&tm); return String(buf); }
+static void fmtDateBuf(char* buf, size_t n, time_t t){ if(!t){ strncpy(buf,"-",n); return; } struct tm tm; localtime_r(&t,&tm); strftime(buf,n,"%Y-%m-%d %H:%M:%S",&tm); }
 static time_t nowLocal(){ return time(nullptr); }
+// Epoch d'un passage, 0 (affiché "-") tant que l'horloge de son boot n'est pas calée
+static time_t passEpoch(const Passage& p){ return (p.ms & Passage::MS_PENDING) ? 0 : p.ts; }
 const char* resetToStr(esp_reset_reason_t r){
   switch(r){ case ESP_RST_POWERON:return "POWERON"; case ESP_RST_EXT:return "EXT"; case ESP_RST_SW:return "SW";
     case ESP_RST_PANIC:return "PANIC/WDT"; case ESP_RST_INT_WDT:return "INT_WDT"; case ESP_RST_TASK_WDT:return "TASK_WDT";
     case ESP_RST_BROWNOUT:return "BROWNOUT"; default:return "OTHER"; }
 }
-static uint32_t idxToBaud(int idx){
-  switch(idx){ case 1:return 9600; case 2:return 19200; case 3:return 38400; case 4:return 57600; case 5:return 115200; case 6:return 230400; case 7:return 256000; case 8:return 460800; default:return 115200; }
-}
-static int baudToIdx(uint32_t b){
-  switch(b){ case 9600:return 1; case 19200:return 2; case 38400:return 3; case 57600:return 4; case 115200:return 5; case 230400:return 6; case 256000:return 7; case 460800:return 8; default:return 5; }
-}
 
 // ======================== STOCKAGE CSV/CFG =====================
+// Passages : journal binaire PassLog (/passes.bin). passes.csv n'est plus écrit :
+// un fichier hérité d'une version précédente est encore exporté en tête de /csv.
 static const char* CSV_PATH = "/passes.csv";
 static const char* CFG_PATH = "/config.txt";
 
@@ -107,17 +117,6 @@ bool mountFS() {
   return false;
 }
 
-void appendCSV(const Passage& p){
-  if (!LittleFS.exists(CSV_PATH)) {
-    File f0 = LittleFS.open(CSV_PATH, FILE_WRITE);
-    if (!f0) { Serial.println("[FS] cannot create passes.csv"); return; }
-    f0.println("epoch,datetime,direction,speed_kmh,dist_m,angle_deg,snr"); f0.close();
-  }
-  File f = LittleFS.open(CSV_PATH, FILE_APPEND);
-  if (!f) { Serial.println("[FS] cannot append passes.csv"); return; }
-  f.printf("%ld,%s,%s,%u,%u,%d,%u\n",(long)p.ts, fmtDate(p.ts).c_str(), p.dir?"approach":"away", p.speed_kmh, p.dist_m, (int)p.angle, p.snr);
-  f.close();
-}
 
 void saveConfig(){
   File f = LittleFS.open(CFG_PATH, FILE_WRITE);
@@ -125,6 +124,23 @@ void saveConfig(){
   f.printf("options_approach=%d\n", ONLY_APPROACH?1:0);
   f.printf("options_minspd=%u\n", MIN_SPEED);
   f.printf("options_debounce=%lu\n", (unsigned long)PASS_DEBOUNCE_MS);
+  f.printf("stats_binw=%u\n", STATS_BIN_W);
+  f.printf("stats_binmax=%u\n", STATS_BIN_MAX);
+  f.printf("log_budget_kb=%u\n", LOG_BUDGET_KB);
+  f.printf("mqtt_rate=%u\n", MqttOutbox::rate());
+  f.printf("mqtt_batch_s=%u\n", MqttOutbox::batchWindow());
+  f.printf("mqtt_fmt=%u\n", g_mqFmt);
+  f.printf("metrics_s=%u\n", g_metricsS);
+  f.printf("trace=%u\n", g_trace?1:0);
+  const SpeedCorr::Geometry geo = SpeedCorr::get();
+  f.printf("speed_mode=%u\n", geo.mode);
+  f.printf("speed_h_dm=%u\n", geo.height_dm);
+  f.printf("speed_off_dm=%u\n", geo.offset_dm);
+  f.printf("speed_yaw=%d\n", (int)geo.yaw_deg);
+  for (uint8_t i = 0; i < Zones::MAX_ZONES; i++) {
+    const Zones::Zone& z = Zones::get(i); if (!z.n) continue;
+    char zl[160]; Zones::format(z, zl, sizeof(zl)); f.printf("zone%u=%s\n", (unsigned)(i + 1), zl);
+  }
   f.printf("apply_at_boot=%d\n", g_applyAtBoot?1:0);
   f.printf("det_max=%u\n", g_det.maxDist_m);
   f.printf("det_dir=%u\n", g_det.dirMode);
@@ -133,12 +149,14 @@ void saveConfig(){
   f.printf("sens_trig=%u\n", g_sens.trigCount);
   f.printf("sens_snr=%u\n", g_sens.snrLevel);
   f.printf("baud_idx=%d\n", g_baudIdxSaved);
+  f.printf("uart_hi=%u\n", g_uartHi?1:0);
   f.close();
   Serial.println("[CFG] saved");
 }
 bool loadConfig(){
   if (!LittleFS.exists(CFG_PATH)) { Serial.println("[CFG] not found (defaults)"); return false; }
   File f = LittleFS.open(CFG_PATH, FILE_READ); if (!f) { Serial.println("[CFG] open fail"); return false; }
+  SpeedCorr::Geometry geo;
   while (f.available()){
     String line = f.readStringUntil('\n'); line.trim();
     int eq = line.indexOf('='); if (eq<0) continue;
@@ -147,6 +165,20 @@ bool loadConfig(){
     if      (k=="options_approach") ONLY_APPROACH = (n!=0);
     else if (k=="options_minspd")   MIN_SPEED = (uint8_t)constrain(n,0,120);
     else if (k=="options_debounce") PASS_DEBOUNCE_MS = (uint32_t)constrain(n,200,10000);
+    else if (k=="stats_binw")       STATS_BIN_W = (uint8_t)constrain(n,1,50);
+    else if (k=="stats_binmax")     STATS_BIN_MAX = (uint8_t)constrain(n,5,250);
+    else if (k=="log_budget_kb")    LOG_BUDGET_KB = (uint16_t)constrain(n,32,8192);
+    else if (k=="mqtt_rate")        MqttOutbox::setRate((uint16_t)constrain(n,1,50));
+    else if (k=="mqtt_batch_s")     MqttOutbox::setBatch((uint16_t)constrain(n,0,900), MqttOutbox::MAX_BATCH);
+    else if (k=="mqtt_fmt")         g_mqFmt = n ? MQ_BIN : MQ_JSON;
+    else if (k=="metrics_s")        g_metricsS = n ? (uint16_t)constrain(n,10,3600) : 0;
+    else if (k=="trace")            g_trace = n != 0;
+    else if (k=="speed_mode")       geo.mode = (uint8_t)constrain(n,0,SpeedCorr::M_COUNT-1);
+    else if (k=="speed_h_dm")       geo.height_dm = (uint8_t)constrain(n,0,250);
+    else if (k=="speed_off_dm")     geo.offset_dm = (uint16_t)constrain(n,0,1000);
+    else if (k=="speed_yaw")        geo.yaw_deg = (int8_t)constrain(n,-60,60);
+    else if (k.startsWith("zone"))  { Zones::Zone z; uint8_t zi = (uint8_t)k.substring(4).toInt();
+                                      if (zi >= 1 && zi <= Zones::MAX_ZONES && Zones::parse(v.c_str(), z)) Zones::set(zi - 1, z); }
     else if (k=="apply_at_boot")    g_applyAtBoot = (n!=0);
     else if (k=="det_max")          { g_det.maxDist_m = (uint8_t)constrain(n,1,120); g_det.valid=true; }
     else if (k=="det_dir")          { g_det.dirMode = (uint8_t)constrain(n,0,2); g_det.valid=true; }
@@ -155,205 +187,146 @@ bool loadConfig(){
     else if (k=="sens_trig")        { g_sens.trigCount = (uint8_t)constrain(n,1,10); g_sens.valid=true; }
     else if (k=="sens_snr")         { g_sens.snrLevel = (uint8_t)constrain(n,0,8); g_sens.valid=true; }
     else if (k=="baud_idx")         g_baudIdxSaved = (int)constrain(n,1,8);
+    else if (k=="uart_hi")          g_uartHi = n != 0;
   }
   f.close();
+  SpeedCorr::set(geo);
   Serial.println("[CFG] loaded");
   return true;
 }
+// Historique RAM : alloué une fois au boot (PSRAM si présente), taille fixe ensuite
+static void passStoreBegin(){
+  void* mem = nullptr; const char* where = "PSRAM";
+  if (psramFound()) mem = heap_caps_malloc(g_passes.bytes(), MALLOC_CAP_SPIRAM);
+  if (!mem) { mem = heap_caps_malloc(g_passes.bytes(), MALLOC_CAP_8BIT); where = "internal"; }
+  g_passes.attach(mem);
+  Serial.printf("[PASS] store %u x %uB = %u B (%s)%s\n", (unsigned)g_passes.capacity(), (unsigned)sizeof(Passage),
+                (unsigned)g_passes.bytes(), where, mem ? "" : " ALLOC FAILED");
+}
+// Budget du journal borné aux 3/4 de la partition (config.txt et NVS gardent de la place)
+static uint32_t logBudgetBytes(){ uint32_t cap = (uint32_t)LittleFS.totalBytes() / 4 * 3; uint32_t b = (uint32_t)LOG_BUDGET_KB * 1024; return (cap && b > cap) ? cap : b; }
+// Reprise à chaud : les derniers passages du journal binaire (pas de CSV à relire) repeuplent
+// g_passes et PassStats avec leurs numéros d'origine ; les séquences absentes du journal
+// (enregistrement illisible, tampon perdu à une coupure) deviennent des trous (Passage::MS_HOLE).
+// Lecture à rebours bornée par RESTORE_BUDGET_MS : au pire il manque les plus anciens.
+// Numéros jamais réutilisés : la séquence reprend au-delà du dernier journalisé, du curseur MQTT
+// et du plafond réservé en NVS (SEQ_BLOCK numéros d'avance, une écriture par bloc) ; des
+// passages publiés puis perdus avant le journal gardent ainsi leur numéro.
+static const uint32_t RESTORE_BUDGET_MS = 150;
+static const uint32_t SEQ_BLOCK = 64;
+static uint32_t g_bootSeq = 0;   // dernière séquence d'un boot précédent (clockFixup() ne touche qu'à la suite)
+static uint32_t g_seqHwm = 0;    // plus grande séquence réservée (NVS "pass"/"hwm")
+static uint16_t g_holes = 0;     // trous présents dans g_passes
+static uint32_t outboxLoad();
+static void seqHwmSave(uint32_t v){
+  const uint32_t t0 = micros();
+  Preferences p; if (p.begin("pass", false)) { p.putUInt("hwm", v); p.end(); }
+  g_seqHwm = v; Metrics::observe(Metrics::FLASH, micros() - t0);
+}
+// Ajout à l'historique (reprise) : éviction et trous tenus à jour comme dans recordPassage()
+static void restorePush(const Passage& p){
+  if (g_passes.size() == g_passes.capacity()) { const Passage& ev = g_passes.oldest(); if (ev.hole()) g_holes--; else PassStats::remove(ev); }
+  g_passes.push(p); if (p.hole()) g_holes++; else PassStats::add(p);
+}
+// Trous jusqu'à la séquence next exclue ; au-delà d'un historique entier, on repart à vide
+static void restoreGap(uint32_t next){
+  if (next - (g_passes.lastSeq() + 1) >= g_passes.capacity()) { PassStats::reset(); g_holes = 0; g_passes.resume(next); return; }
+  Passage h = {}; h.ms = Passage::MS_HOLE;
+  while (g_passes.lastSeq() + 1 < next) restorePush(h);
+}
+static void restorePasses(){
+  if (!g_passes.ready()) return;
+  uint32_t t0 = micros();
+  { Preferences p; if (p.begin("pass", true)) { g_seqHwm = p.getUInt("hwm", 0); p.end(); } }
+  PassLog::Record* tmp = (PassLog::Record*)malloc(sizeof(PassLog::Record) * g_passes.capacity());
+  if (!tmp) { Serial.println("[RESTORE] no memory"); return; }
+  uint32_t n = PassLog::readTail(tmp, g_passes.capacity(), millis() + RESTORE_BUDGET_MS);
+  const uint32_t last = n ? tmp[n-1].seq : 0;
+  const uint32_t next = std::max(std::max(last, g_seqHwm), outboxLoad()) + 1;
+  g_passes.resume(n && tmp[0].seq ? tmp[0].seq : next);
+  uint32_t kept = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    if (tmp[i].seq <= g_passes.lastSeq()) continue;   // désordre : ignoré
+    restoreGap(tmp[i].seq); restorePush(PassLog::toPassage(tmp[i])); kept++;
+  }
+  restoreGap(next); g_bootSeq = g_passes.lastSeq();
+  free(tmp);
+  Serial.printf("[RESTORE] %lu passage(s), %u hole(s), next seq=%lu (log %lu, reserved %lu) in %lu ms (budget %lu ms)\n", (unsigned long)kept, (unsigned)g_holes,
+                (unsigned long)next, (unsigned long)last, (unsigned long)g_seqHwm, (unsigned long)((micros() - t0) / 1000), (unsigned long)RESTORE_BUDGET_MS);
+}
 void ensureFiles() {
   if (!LittleFS.exists(CFG_PATH)) { saveConfig(); Serial.println("[FS] created default config.txt"); }
-  if (!LittleFS.exists(CSV_PATH)) {
-    File f = LittleFS.open(CSV_PATH, FILE_WRITE);
-    if (f) { f.println("epoch,datetime,direction,speed_kmh,dist_m,angle_deg,snr"); f.close(); }
-    else { Serial.println("[FS] cannot create passes.csv"); }
-  }
+  PassLog::begin(logBudgetBytes());
 }
 
 // ====================== UART / PARSING =========================
-static std::vector<uint8_t> rx;
-static std::vector<uint8_t> lastTx;
-struct AckStore { uint16_t cmd=0xFFFF; uint16_t status=0xFFFF; std::vector<uint8_t> data; uint32_t ts=0; } g_ack;
-
-void sendCmd(uint16_t cmd, const uint8_t* payload, uint16_t plen){
-  // Spéc LD2451 : HDR + LEN(2+N) + CMD(2 LE) + VALUE(N) + TAIL ; LEN n'inclut pas le tail
-  std::vector<uint8_t> f;
-  uint16_t dataLen = uint16_t(2 + plen); // 2 pour "CMD" + N pour le payload
-
-  // Header
-  f.insert(f.end(), CMD_HDR, CMD_HDR+4);
-
-  // Length
-  f.push_back(uint8_t(dataLen & 0xFF));
-  f.push_back(uint8_t(dataLen >> 8));
-
-  // Commande (little-endian)
-  f.push_back(uint8_t(cmd & 0xFF));
-  f.push_back(uint8_t(cmd >> 8));
-
-  // Valeur
-  if (payload && plen) f.insert(f.end(), payload, payload + plen);
-
-  // Tail
-  f.insert(f.end(), CMD_TAIL, CMD_TAIL+4);
-
-  lastTx = f;
-  Serial.printf("[TX CMD] 0x%04X payload=%u raw:%s\n", cmd, plen, toHex(f.data(), f.size()).c_str());
-  Serial2.write(f.data(), f.size());
-  Serial2.flush();
-}
-
-void cmd_enableCfg(){ sendCmd(CMD_ENABLE_CFG, nullptr, 0); }
-void cmd_endCfg(){ uint8_t v[2]={0x01,0x00}; sendCmd(CMD_END_CFG, v, 2); }
-void cmd_readVersion(){ sendCmd(CMD_READ_VERSION, nullptr, 0); }
-static inline uint16_t u16le(const uint8_t* p){ return uint16_t(p[0]) | (uint16_t(p[1])<<8); }
-
-// ACK : HDR + LEN(2 = 2 octets (CMD|0x0100) + N) + (CMD|0x0100) + RETURN(N) + TAIL
-bool waitAck(uint16_t cmd, uint32_t timeout_ms){
-  uint32_t t0 = millis();
-  g_ack.cmd = 0xFFFF; 
-  g_ack.status = 0xFFFF; 
-  g_ack.data.clear();
-
-  while (millis() - t0 < timeout_ms) {
-    // Alimente le buffer RX
-    while (Serial2.available()){
-      uint8_t b = (uint8_t)Serial2.read();
-      rx.push_back(b);
-      ST.bytes_rx++;
-      if (rx.size() > 8192) rx.erase(rx.begin(), rx.begin() + 4096);
-    }
-
-    auto hdrEq = [&](const uint8_t* H){
-      return rx.size() >= 4 && rx[0]==H[0] && rx[1]==H[1] && rx[2]==H[2] && rx[3]==H[3];
-    };
-
-    // --- Consomme les frames DATA pour ne pas bloquer ---
-    if (hdrEq(DAT_HDR)){
-      if (rx.size() < 10) { delay(1); continue; }
-      uint16_t L  = u16le(rx.data() + 4);
-      size_t  FL  = 4 + 2 + L + 4;            // L n'inclut pas le tail
-      if (rx.size() < FL) { delay(1); continue; }
-      if (std::equal(DAT_TAIL, DAT_TAIL + 4, rx.data() + FL - 4)) {
-        ST.frames_data++;
-        rx.erase(rx.begin(), rx.begin() + FL);
-      } else {
-        rx.erase(rx.begin());                 // désynchronisation : slide d'1 octet
-      }
-      continue;
-    }
-
-    // --- Frame de type ACK/Commande ---
-    if (hdrEq(CMD_HDR)){
-      // Filtre l’écho de nos propres trames (certains montages renvoient l'echo du TX)
-      if (!lastTx.empty() && rx.size() >= lastTx.size() &&
-          std::equal(rx.begin(), rx.begin() + lastTx.size(), lastTx.begin())){
-        Serial.println("[UART] Echo of our TX ignored");
-        rx.erase(rx.begin(), rx.begin() + lastTx.size());
-        continue;
-      }
-
-      if (rx.size() < 12) { delay(1); continue; }
-      uint16_t L  = u16le(rx.data() + 4);
-      size_t  FL  = 4 + 2 + L + 4;
-      if (rx.size() < FL) { delay(1); continue; }
-      if (!std::equal(CMD_TAIL, CMD_TAIL + 4, rx.data() + FL - 4)) {
-        rx.erase(rx.begin());                 // mauvais tail => désync, on jette 1 octet
-        continue;
-      }
-
-      uint16_t ackCmd = u16le(rx.data() + 6);         // (cmd | 0x0100) selon la doc
-      const uint8_t* ret = rx.data() + 8;
-      size_t retLen = (L >= 2) ? (L - 2) : 0;         // 2 octets déjà pris par ackCmd
-
-      g_ack.cmd = ackCmd;
-      g_ack.status = (retLen >= 2) ? u16le(ret) : 0xFFFF;
-
-      // Copie des octets de retour (hors status) en évitant assign(const*, non-const*)
-      const uint8_t* first = ret + (retLen >= 2 ? 2 : 0);
-      const uint8_t* last  = rx.data() + FL - 4;      // début du tail
-      g_ack.data.clear();
-      g_ack.data.insert(g_ack.data.end(), first, last);
-
-      g_ack.ts = millis();
-      ST.frames_ack++;
-
-      rx.erase(rx.begin(), rx.begin() + FL);
-
-      // On accepte l'ACK si cmd == ackCmd ou (cmd|0x0100) == ackCmd
-      if (g_ack.cmd == cmd || g_ack.cmd == (cmd | 0x0100)) return true;
-
-      continue;
-    }
-
-    // Pas d'en-tête reconnu : on décale d'1 octet
-    if (!rx.empty()) rx.erase(rx.begin());
-    delay(1);
-  }
-  return false; // timeout
+// Trace : instant d'enregistrement des derniers passages (par seq), pour mesurer
+// passage -> flash et passage -> MQTT quand ils partent
+static const uint8_t TRACE_N = 64;
+struct TraceRec { uint32_t seq, t_us; };
+static TraceRec g_trc[TRACE_N];
+static void traceDone(Metrics::Hist h, uint32_t from, uint32_t last){
+  if (!g_trace) return;
+  const uint32_t now = (uint32_t)esp_timer_get_time();
+  for (uint32_t s = from; s <= last; s++) { const TraceRec& r = g_trc[s % TRACE_N]; if (r.seq == s) Metrics::observe(h, now - r.t_us); }
 }
-
 // === Passages
-static void maybeRecordPassageFromTargets(const std::vector<Passage>& candidates){
-  if (candidates.empty()) return;
-  uint32_t nowMs=millis(); if (nowMs - g_lastPassMs < PASS_DEBOUNCE_MS) return;
-  const Passage* best=&candidates[0]; for (const auto& c: candidates) if (c.speed_kmh>best->speed_kmh) best=&c;
-  Passage p=*best; p.ts=nowLocal(); g_passes.push_back(p); g_ld2451_ok=true; mqttPublishPass(g_passes.back()); if (g_passes.size()>MAX_PASSES) g_passes.erase(g_passes.begin()); appendCSV(p); bumpActivity(); g_lastPassMs=nowMs;
-  Serial.printf("[PASS] %s v=%u d=%u θ=%d @ %s\n", p.dir?"approach":"away", p.speed_kmh, p.dist_m, (int)p.angle, fmtDate(p.ts).c_str());
-}
-void parseDataFrame(const uint8_t* p, size_t n){
-  if (n<10) return;
-  uint16_t L = p[4] | (uint16_t(p[5])<<8);
-  const uint8_t* payload = p+6; const uint8_t* tail=payload+L;
-  if (!std::equal(DAT_TAIL,DAT_TAIL+4,tail)) return;
-  if (L<2) { if(PRINT_EMPTY) Serial.println("[DATA] short"); ST.frames_data++; return; }
-  uint8_t count = payload[0];
-  const size_t PER=5; const uint8_t* tp=payload+2; const uint8_t* end=tail;
-  std::vector<Passage> cand;
-  for(uint8_t i=0;i<count;i++){ if (tp+PER>end) break;
-    int8_t angle = int(tp[0]) - 0x80; uint8_t dist=tp[1]; uint8_t dir=tp[2]; uint8_t spd=tp[3]; uint8_t snr=tp[4];
-    if ((!ONLY_APPROACH || dir==1) && spd>=MIN_SPEED && spd>0){ Passage c; c.ts=0; c.angle=angle; c.dist_m=dist; c.speed_kmh=spd; c.dir=dir; c.snr=snr; cand.push_back(c); }
-    tp+=PER;
+// Horloge calée (Clock::poll()) : les passages de ce boot encore en attente (historique RAM, donc
+// file MQTT, et tampon du journal) reçoivent en bloc le décalage du boot ; stats heures/jours refaites
+static void clockFixup(){
+  uint32_t n = 0;
+  for (uint32_t s = std::max(g_bootSeq + 1, g_passes.firstSeq()); s <= g_passes.lastSeq(); s++) {
+    Passage* p = g_passes.bySeq(s); if (!(p->ms & Passage::MS_PENDING)) continue;
+    uint32_t sec = (uint32_t)p->ts; uint16_t ms = p->ms;
+    if (Clock::resolve(Clock::boot(), sec, ms)) { p->ts = (time_t)sec; p->ms = ms; n++; }
   }
-  maybeRecordPassageFromTargets(cand); ST.frames_data++;
-}
-void parseAckFrame(const uint8_t* p, size_t n){ (void)p; (void)n; /* handled in waitAck() */ }
-
-size_t tryParseOne(){
-  if (rx.size()<4) return 0;
-  auto hdrEq = [&](const uint8_t* H){ return rx.size()>=4 && rx[0]==H[0]&&rx[1]==H[1]&&rx[2]==H[2]&&rx[3]==H[3]; };
-
-  if (hdrEq(DAT_HDR)){
-    if (rx.size()<10) return 0;
-    uint16_t L = (uint16_t)rx[4] | ((uint16_t)rx[5]<<8);
-    size_t frameLen = 4 + 2 + L + 4;
-    if (rx.size()<frameLen) return 0;
-    if (!std::equal(DAT_TAIL, DAT_TAIL+4, rx.data()+frameLen-4)){ rx.erase(rx.begin()); return 1; }
-    parseDataFrame(rx.data(), frameLen);
-    rx.erase(rx.begin(), rx.begin()+frameLen);
-    return frameLen;
-  }
-
-  if (hdrEq(CMD_HDR)){
-    if (!lastTx.empty() && rx.size()>=lastTx.size() &&
-        std::equal(rx.begin(), rx.begin()+lastTx.size(), lastTx.begin())){
-      Serial.println("[UART] Echo of our TX ignored");
-      rx.erase(rx.begin(), rx.begin()+lastTx.size());
-      return 1;
-    }
-    if (rx.size()<12) return 0;
-    uint16_t L = (uint16_t)rx[4] | ((uint16_t)rx[5]<<8);
-    size_t frameLen = 4 + 2 + L + 4;
-    if (rx.size()<frameLen) return 0;
-    if (!std::equal(CMD_TAIL, CMD_TAIL+4, rx.data()+frameLen-4)){ rx.erase(rx.begin()); return 1; }
-    ST.frames_ack++;
-    rx.erase(rx.begin(), rx.begin()+frameLen);
-    return frameLen;
+  if (n) { PassStats::reset(); for (const Passage& p : g_passes) if (!p.hole()) PassStats::add(p); }
+  PassLog::fixPending();
+  Serial.printf("[CLOCK] %lu pending passage(s) fixed\n", (unsigned long)n);
+}
+static void applyTrackerParams(){ Tracker::Params tp = Tracker::params(); tp.gap_us = PASS_DEBOUNCE_MS * 1000UL; Tracker::setParams(tp); }
+// Piste close -> passage ; filtres d'options sur la piste entière (sens, vitesse de pointe corrigée)
+static void recordPassage(const Tracker::Result& r){
+  if ((ONLY_APPROACH && r.dir!=1) || r.peak_true<MIN_SPEED) return;
+  Passage p; p.angle=r.angle; p.dist_m=r.dist_in; p.dist_out=r.dist_out; p.speed_kmh=r.peak_true; p.speed_raw=r.peak_kmh; p.dir=r.dir; p.snr=r.snr; p.zone=r.zone;
+  const uint32_t dw=(r.t_last_us-r.t_first_us)/100000; p.dwell_ds=(uint16_t)(dw>65535?65535:dw);
+  const int64_t mono=Clock::monoUs(); const uint32_t now=(uint32_t)mono; Metrics::observe(Metrics::PASS_CLOSE, now-r.t_last_us);
+  Clock::stamp(mono-(uint32_t)(now-r.t_peak_us), p.ts, p.ms);   // arrivée de la trame de vitesse de pointe
+  Passage ev; bool full = g_passes.size()==g_passes.capacity(); if (full) { ev=g_passes.oldest(); if (ev.hole()) { g_holes--; full=false; } else PassStats::remove(ev); }
+  uint32_t seq=g_passes.push(p); PassStats::add(p); SpeedQ::add(p.ms & Passage::MS_PENDING ? 0 : p.ts, p.dir, p.speed_kmh);
+  if (seq > g_seqHwm) seqHwmSave(seq + SEQ_BLOCK - 1);
+  if (g_trace) { g_trc[seq % TRACE_N] = { seq, now }; Serial.printf("[TRC] seq=%lu close=%lums\n", (unsigned long)seq, (unsigned long)((now-r.t_last_us)/1000)); }
+  livePublishPass(seq, p, full ? &ev : nullptr); PassLog::append(seq, p); bumpActivity(); mqttDrain();
+  char dt[24]; fmtDateBuf(dt, sizeof(dt), passEpoch(p));
+  Serial.printf("[PASS] %s v=%u (raw %u) d=%u->%u θ=%d %u.%us hits=%u zone=%u @ %s.%03u\n", p.dir?"approach":"away", p.speed_kmh, p.speed_raw, p.dist_m, p.dist_out, (int)p.angle,
+                p.dwell_ds/10, p.dwell_ds%10, (unsigned)r.hits, p.zone, dt, (unsigned)(p.ms & Passage::MS_MASK));
+}
+static void recordPassages(const Tracker::Result* r, uint8_t n){ for (uint8_t i=0;i<n;i++) recordPassage(r[i]); }
+// Trame de cibles décodée par la tâche radar -> zones (grille) -> correction de vitesse (table) -> pistage (une piste par véhicule)
+static void handleTargetFrame(const RadarTask::TargetFrame& tf){
+  if (!tf.count && PRINT_EMPTY) Serial.println("[DATA] empty");
+  Tracker::Det d[Tracker::MAX_DETS]; uint8_t n=0;
+  for(uint8_t i=0;i<tf.count && n<Tracker::MAX_DETS;i++){ const auto& t=tf.t[i];
+    const uint8_t zm=Zones::lookup(t.angle, t.dist_m);
+    if (t.speed_kmh>0 && Zones::keep(zm)){ Tracker::Det& x=d[n++]; x.zones=zm; x.angle=t.angle; x.dist_m=t.dist_m; x.dir=t.dir; x.speed_kmh=t.speed_kmh; x.snr=t.snr;
+      x.speed_true=SpeedCorr::correct(t.speed_kmh, t.angle, t.dist_m); }
   }
-
-  rx.erase(rx.begin());
-  return 1;
+  if (n) PowerFsm::activity(PowerFsm::RADAR, millis());   // cibles en cours : pas de light-sleep
+  Tracker::Result out[Tracker::MAX_TRACKS];
+  recordPassages(out, Tracker::update(tf.t_us, d, n, out, Tracker::MAX_TRACKS));
+}
+// Première trame valide : le radar répond, la veille devient permise
+static inline void radarSeen(){ if (!g_ld2451_ok) { g_ld2451_ok = true; PowerFsm::setRadarOk(true); } }
+// Cibles -> passages ; ACK -> moteur de commandes (RadarCmd). Jamais bloquant.
+static void serviceRadar(){
+  RadarTask::TargetFrame tf;
+  while (RadarTask::popFrame(tf)) { Metrics::observe(Metrics::FRAME_LAT, RadarTask::noteConsumed(tf)); radarSeen(); handleTargetFrame(tf); }
+  // Radar muet (plus de cible) : clôture des pistes silencieuses sans attendre une trame
+  if (Tracker::active()) { Tracker::Result out[Tracker::MAX_TRACKS]; recordPassages(out, Tracker::expire((uint32_t)esp_timer_get_time(), out, Tracker::MAX_TRACKS)); }
+  RadarTask::Ack a;
+  while (RadarTask::popAck(a, 0)) { radarSeen(); RadarCmd::onAck(a.cmd, a.status, a.data, a.n); }
+  RadarCmd::poll(); RadarLink::poll();
 }
-
 
 // ========================= SERVEUR WEB =========================
 WebServer server(80);
@@ -363,10 +336,7 @@ WiFiClient g_net;
 PubSubClient g_mqtt(g_net);
     // ---- Idle Wi‑Fi OFF (Mode 3) ----
     static bool wifiOff = false;
-    //static uint32_t lastActiveMs = 0;
-    const uint32_t WIFI_IDLE_OFF_MS = 60000;  // cut Wi‑Fi after 60 s idle (hysteresis pairing with KEEP_ON)
-    const uint32_t WIFI_KEEP_ON_MS  = 20000;  // keep Wi‑Fi ON 20 s after activity
-    //static inline void bumpActivity(){ lastActiveMs = millis(); }
+    // Coupure après PowerFsm::RADIO_KEEP_MS sans activité : transitions de PowerFsm (powerApply())
     static void wifiEnsureOn(){
       if (!wifiOff) return;
       WiFi.mode(WIFI_STA);
@@ -374,7 +344,7 @@ PubSubClient g_mqtt(g_net);
       String _ssid = _c.ssid.length()? _c.ssid : String(WIFI_SSID);
       String _pass = _c.ssid.length()? _c.pass : String(WIFI_PASS);
       WiFi.begin(_ssid.c_str(), _pass.c_str());
-      server.begin();
+      server.begin(); LivePush::begin(LIVE_PORT);
       if (g_pw.mdns) { MDNS.begin("ld2451"); }
       wifiOff = false;
       Serial.println("[PWR] WiFi ON");
@@ -382,7 +352,7 @@ PubSubClient g_mqtt(g_net);
     static void wifiEnsureOff(){
       if (wifiOff) return;
       if (g_pw.mdns) MDNS.end();
-      server.stop();
+      server.stop(); LivePush::end();
       WiFi.disconnect(true, true);
       WiFi.mode(WIFI_OFF);
       wifiOff = true;
@@ -405,170 +375,577 @@ extern PowerCfg::Settings g_pw;
 
 
 // ---------------- MQTT helpers ------------------------------
-static String devId(){
-  String id = String((uint32_t)ESP.getEfuseMac(), HEX);
-  id.toUpperCase();
-  return id;
+// Topics précalculés à chaque chargement de g_mq : aucune concaténation par publication
+struct MqttTopics { char id[12], client[20], status[80], last[80], count[80], speeds[80], batch[80], metrics[80]; };
+static MqttTopics g_mt;
+static void mqttTopicsBuild(){
+  snprintf(g_mt.id, sizeof(g_mt.id), "%lX", (unsigned long)(uint32_t)ESP.getEfuseMac());
+  snprintf(g_mt.client, sizeof(g_mt.client), "RADAR-%s", g_mt.id);
+  char base[64];
+  if (g_mq.base.length()) snprintf(base, sizeof(base), "%s", g_mq.base.c_str());
+  else snprintf(base, sizeof(base), "radar/%s", g_mt.id);
+  const size_t n = strlen(base); if (n && base[n-1] == '/') base[n-1] = 0;
+  snprintf(g_mt.status, sizeof(g_mt.status), "%s/status", base);
+  snprintf(g_mt.last,   sizeof(g_mt.last),   "%s/last",   base);
+  snprintf(g_mt.count,  sizeof(g_mt.count),  "%s/count",  base);
+  snprintf(g_mt.speeds, sizeof(g_mt.speeds), "%s/speeds", base);
+  snprintf(g_mt.batch,  sizeof(g_mt.batch),  "%s/batch",  base);
+  snprintf(g_mt.metrics, sizeof(g_mt.metrics), "%s/metrics", base);
 }
-static String topic(const String& leaf){
-  String base = g_mq.base.length()? g_mq.base : String("radar/") + devId();
-  if (base.endsWith("/")) return base + leaf;
-  return base + "/" + leaf;
+static bool publishRaw(const char* t, const char* p, size_t n, bool retain=false){
+  if (!MqttLink::up()) return false;
+  const uint32_t t0 = micros();
+  const bool ok = g_mqtt.publish(t, (const uint8_t*)p, (unsigned)n, retain);
+  Metrics::observe(Metrics::MQTT_PUB, micros() - t0);
+  if (ok) return true;
+  Serial.printf("[MQTT] publish fail topic=%s len=%u\n", t, (unsigned)n); return false;
 }
-static void publishJSON(const String& t, const String& json, bool retain=false){
-  if (g_mqtt.connected()) { if(!g_mqtt.publish(t.c_str(), json.c_str(), retain)) Serial.printf("[MQTT] publish fail topic=%s len=%u\n", t.c_str(), (unsigned)json.length()); }
+static bool publishJSON(const char* t, JsonOut& j, bool retain=false){
+  if (!j.ok()) { Serial.printf("[MQTT] payload truncated topic=%s\n", t); return false; }
+  return publishRaw(t, j.c_str(), j.size(), retain);
 }
-static void publishStr(const String& t, const String& s, bool retain=false){
-  if (g_mqtt.connected()) { if(!g_mqtt.publish(t.c_str(), s.c_str(), retain)) Serial.printf("[MQTT] publish fail topic=%s len=%u\n", t.c_str(), (unsigned)s.length()); }
+static void publishStr(const char* t, const char* s, bool retain=false){ publishRaw(t, s, strlen(s), retain); }
+static void publishCount(){ char b[12]; snprintf(b, sizeof(b), "%u", (unsigned)(g_passes.size() - g_holes)); publishStr(g_mt.count, b, true); }
+// Découverte Home Assistant : un capteur = un payload écrit dans un tampon de pile
+static void haSensor(const char* leaf, const char* uid, const char* name, const char* stat, const char* unit, const char* tpl, bool attr){
+  char t[80], uq[48], dn[40], buf[640];
+  snprintf(t, sizeof(t), "homeassistant/sensor/%s/%s/config", g_mt.id, leaf);
+  snprintf(uq, sizeof(uq), "radar_%s_%s", g_mt.id, uid);
+  snprintf(dn, sizeof(dn), "LD2451 Radar %s", g_mt.id);
+  JsonOut j(buf, sizeof(buf));
+  j.obj().key("name").str(name).key("uniq_id").str(uq).key("stat_t").str(stat);
+  if (attr) j.key("json_attr_t").str(stat);
+  if (unit) j.key("unit_of_meas").str(unit);
+  if (tpl)  j.key("val_tpl").str(tpl);
+  j.key("avty_t").str(g_mt.status).key("pl_avail").str("online").key("pl_not_avail").str("offline")
+   .key("device").obj().key("identifiers").arr().str(g_mt.client).end().key("name").str(dn).key("manufacturer").str("DIY").key("model").str("HLK-LD2451").end()
+   .end();
+  publishJSON(t, j, true);
 }
 static void publishHAConfig(){
   if (!g_mq.discovery) return;
-  String id = devId();
-  String device = String("{\"identifiers\":[\"RADAR-")+id+"\"],\"name\":\"LD2451 Radar "+id+"\",\"manufacturer\":\"DIY\",\"model\":\"HLK-LD2451\"}";
-  String cfgSpeed = String("{\"name\":\"Radar Speed\",\"uniq_id\":\"radar_")+id+String("_speed\",\"stat_t\":\"")+topic("last")+String("\",\"json_attr_t\":\"")+topic("last")+String("\",\"unit_of_meas\":\"km/h\",\"val_tpl\":\"{{ value_json.speed_kmh }}\",\"avty_t\":\"")+topic("status")+String("\",\"pl_avail\":\"online\",\"pl_not_avail\":\"offline\",\"device\":")+device+"}";
-  publishStr(String("homeassistant/sensor/")+id+String("/speed/config"), cfgSpeed, true);
-  String cfgDist = String("{\"name\":\"Radar Distance\",\"uniq_id\":\"radar_")+id+String("_dist\",\"stat_t\":\"")+topic("last")+String("\",\"unit_of_meas\":\"m\",\"val_tpl\":\"{{ value_json.dist_m }}\",\"avty_t\":\"")+topic("status")+String("\",\"pl_avail\":\"online\",\"pl_not_avail\":\"offline\",\"device\":")+device+"}";
-  publishStr(String("homeassistant/sensor/")+id+String("/distance/config"), cfgDist, true);
-  String cfgAng = String("{\"name\":\"Radar Angle\",\"uniq_id\":\"radar_")+id+String("_ang\",\"stat_t\":\"")+topic("last")+String("\",\"unit_of_meas\":\"°\",\"val_tpl\":\"{{ value_json.angle }}\",\"avty_t\":\"")+topic("status")+String("\",\"pl_avail\":\"online\",\"pl_not_avail\":\"offline\",\"device\":")+device+"}";
-  publishStr(String("homeassistant/sensor/")+id+String("/angle/config"), cfgAng, true);
-  String cfgCnt = String("{\"name\":\"Radar Passes\",\"uniq_id\":\"radar_")+id+String("_count\",\"stat_t\":\"")+topic("count")+String("\",\"avty_t\":\"")+topic("status")+String("\",\"pl_avail\":\"online\",\"pl_not_avail\":\"offline\",\"device\":")+device+"}";
-  publishStr(String("homeassistant/sensor/")+id+String("/count/config"), cfgCnt, true);
+  haSensor("speed",    "speed", "Radar Speed",    g_mt.last,   "km/h", "{{ value_json.speed_kmh }}", true);
+  haSensor("distance", "dist",  "Radar Distance", g_mt.last,   "m",    "{{ value_json.dist_m }}", false);
+  haSensor("angle",    "ang",   "Radar Angle",    g_mt.last,   "°",    "{{ value_json.angle }}", false);
+  haSensor("v85",      "v85",   "Radar V85",      g_mt.speeds, "km/h", "{{ value_json.total.all.p85 }}", false);
+  haSensor("count",    "count", "Radar Passes",   g_mt.count,  nullptr, nullptr, false);
+}
+static void speedsJSON(JsonOut& j);
+static uint32_t g_speedsPubChg = 0;
+static void publishSpeeds(){
+  char buf[512]; JsonOut j(buf, sizeof(buf)); speedsJSON(j);
+  LivePush::publish("speeds", j.c_str(), j.size());
+  g_speedsPubChg = SpeedQ::changes();
+  if (MqttLink::up()) publishJSON(g_mt.speeds, j, true);
 }
 static void mqttOnConnect(){
-  publishStr(topic("status"), "online", true);
+  publishStr(g_mt.status, "online", true);
   publishHAConfig();
-  publishStr(topic("count"), String((unsigned)g_passes.size()), true);
-}
-static void mqttEnsureConnected(){
-  if (!g_mq.enabled) return;
-  if (WiFi.status() != WL_CONNECTED) return;
-  if (g_mqtt.connected()) { g_mqtt.loop(); return; }
-  static uint32_t g_mqttNextTry = 0;
-  uint32_t now = millis();
-  if (now < g_mqttNextTry) return;
-  g_mqtt.setServer(g_mq.host.c_str(), g_mq.port ? g_mq.port : 1883);
-  String willTopic = topic("status");
-  Serial.printf("[MQTT] connect to %s:%u user=%s\n", g_mq.host.c_str(), (unsigned)(g_mq.port?g_mq.port:1883), g_mq.user.c_str());
-  g_mqtt.connect(("RADAR-"+devId()).c_str(),
-                 g_mq.user.length()? g_mq.user.c_str(): nullptr,
-                 g_mq.user.length()? g_mq.pass.c_str(): nullptr,
-                 willTopic.c_str(), 0, true, "offline");
-  g_mqttNextTry = now + 5000;
-  if (g_mqtt.connected()) { Serial.println("[MQTT] connected"); mqttOnConnect(); } else { Serial.printf("[MQTT] connect failed, state=%d\n", g_mqtt.state()); }
-}
-static void mqttPublishPass(const Passage& p){
-  if (!g_mqtt.connected()) return;
-  String j = String("{\"ts\":\"")+fmtDate(p.ts)+"\",\"dir\":"+(p.dir?String(1):String(0))+
-             ",\"speed_kmh\":"+String(p.speed_kmh)+",\"dist_m\":"+String(p.dist_m)+
-             ",\"angle\":"+String((int)p.angle)+",\"snr\":"+String(p.snr)+"}";
-  publishJSON(topic("last"), j, true);
-  publishStr(topic("count"), String((unsigned)g_passes.size()), true);
-}
-
-// ---------------- Power policy (CPU/mdns/sleep) -------------------------
-static void applyPowerPolicy(){
-  setCpuFrequencyMhz((int)g_pw.cpu_mhz);
-
-  bool wantSleep = g_pw.wifi_sleep;
-  if (!g_ld2451_ok) wantSleep = false;
-  if (g_pw.sleep_gpio >= 0){
-    pinMode(g_pw.sleep_gpio, INPUT_PULLUP);
-    int lvl = digitalRead(g_pw.sleep_gpio);
-    bool active = g_pw.sleep_gpio_active_high ? (lvl==HIGH) : (lvl==LOW);
-    if (active) wantSleep = false;
+  publishCount();
+  publishSpeeds();
+}
+// Connexion gérée par la tâche MqttLink (attente exponentielle + gigue) : loop() ne fait
+// que maintenir la session et publier une fois connecté.
+static void mqttLinkBegin(){
+  MqttLink::Cfg c; memset(&c, 0, sizeof(c));
+  strncpy(c.host, g_mq.host.c_str(), sizeof(c.host) - 1); c.port = g_mq.port;
+  strncpy(c.user, g_mq.user.c_str(), sizeof(c.user) - 1); strncpy(c.pass, g_mq.pass.c_str(), sizeof(c.pass) - 1);
+  strncpy(c.client, g_mt.client, sizeof(c.client) - 1); strncpy(c.will, g_mt.status, sizeof(c.will) - 1);
+  if (!MqttLink::begin(g_mqtt, c, g_mq.enabled)) Serial.println("[MQTT] task start failed");
+}
+static void mqttService(){
+  if (MqttLink::service()) { Serial.println("[MQTT] connected"); mqttOnConnect(); }
+}
+static bool mqttPublishPass(uint32_t seq, const Passage& p){
+  char dt[24], buf[256]; fmtDateBuf(dt, sizeof(dt), passEpoch(p));
+  JsonOut j(buf, sizeof(buf));
+  j.obj().key("seq").u(seq).key("ts").str(dt).key("ms").u(p.ms & Passage::MS_MASK).key("dir").u(p.dir ? 1 : 0).key("speed_kmh").u(p.speed_kmh).key("speed_raw").u(p.speed_raw).key("dist_m").u(p.dist_m).key("dist_out").u(p.dist_out)
+   .key("dwell_s").fix(p.dwell_ds, 1).key("angle").i(p.angle).key("snr").u(p.snr).key("zone").u(p.zone).end();
+  return publishJSON(g_mt.last, j, true);
+}
+// Mode groupé (MqttOutbox::setBatch) : un message base/batch par lot, non retenu.
+//  - bin  : PassPack (12 o + 13 o/passage)
+//  - json : {"seq":seq0,"t0":epoch,"p":[[dt,dir,speed_kmh,speed_raw,dist_m,dist_out,dwell_ds,angle,snr,zone,ms],...]}
+// Horloge pas encore calée : t0 en secondes depuis le boot (bin : PassPack::F_BOOT, json : "boot":1).
+// Un lot ne mélange pas les deux et s'arrête avant un trou (batchRun()).
+static uint8_t batchRun(uint32_t from, uint8_t n){
+  const uint16_t f = g_passes.bySeq(from)->ms & Passage::MS_PENDING; uint8_t k = 1;
+  while (k < n) { const Passage* p = g_passes.bySeq(from + k); if (p->hole() || (p->ms & Passage::MS_PENDING) != f) break; k++; }
+  return k;
+}
+// ps[0..n[ : séquences from.. consécutives (historique RAM ou rattrapage depuis le journal)
+static bool mqttPublishBatch(uint32_t from, const Passage* ps, uint8_t n){
+  const bool rel = ps[0].ms & Passage::MS_PENDING;
+  uint32_t t0 = UINT32_MAX;   // ts = instant de pointe : pas forcément croissant dans l'ordre des séquences
+  for (uint8_t i = 0; i < n; i++) { const uint32_t t = (uint32_t)ps[i].ts; if (t < t0) t0 = t; }
+  if (g_mqFmt == MQ_BIN) {
+    uint8_t buf[PassPack::HDR_SIZE + MqttOutbox::MAX_BATCH * PassPack::REC_SIZE];
+    size_t k = PassPack::header(buf, from, t0, n, rel ? PassPack::F_BOOT : 0);
+    for (uint8_t i = 0; i < n; i++) k += PassPack::record(buf + k, ps[i], t0);
+    return publishRaw(g_mt.batch, (const char*)buf, k);
   }
+  char buf[1500]; JsonOut j(buf, sizeof(buf));   // 32 x 45 o au pire
+  j.obj().key("seq").u(from).key("t0").u(t0); if (rel) j.key("boot").u(1);
+  j.key("p").arr();
+  for (uint8_t i = 0; i < n; i++) {
+    const Passage& p = ps[i];
+    j.arr().u((uint32_t)p.ts - t0).u(p.dir ? 1 : 0).u(p.speed_kmh).u(p.speed_raw).u(p.dist_m).u(p.dist_out).u(p.dwell_ds).i(p.angle).u(p.snr).u(p.zone).u(p.ms & Passage::MS_MASK).end();
+  }
+  j.end().end();
+  return publishJSON(g_mt.batch, j);
+}
+// Rattrapage depuis PassLog : séquences entre le curseur et le début de l'historique RAM (reboot
+// après une longue coupure, reprise tronquée par RESTORE_BUDGET_MS, historique plein). Mêmes
+// messages et même débit que mqttDrain() ; une séquence absente du journal compte dans dropped.
+// true : rattrapage en cours (débit, fenêtre, broker), l'historique RAM attend.
+static uint32_t g_mqReplayed = 0;
+static bool mqttReplay(bool grouped){
+  static PassLog::Record rb[MqttOutbox::MAX_BATCH]; static uint8_t rbN = 0, rbI = 0;
+  uint32_t from; uint8_t n;
+  while (MqttOutbox::acked() + 1 < g_passes.firstSeq()) {
+    const uint32_t first = g_passes.firstSeq();
+    while (rbI < rbN && rb[rbI].seq <= MqttOutbox::acked()) rbI++;
+    if (rbI == rbN) { rbN = uint8_t(PassLog::readFrom(MqttOutbox::acked() + 1, rb, MqttOutbox::MAX_BATCH)); rbI = 0; }
+    if (rbI == rbN || rb[rbI].seq >= first) { rbN = rbI = 0; return false; }   // le reste n'est plus au journal
+    if (!(n = MqttOutbox::next(rb[rbI].seq, first - 1, millis(), from))) return true;
+    Passage ps[MqttOutbox::MAX_BATCH]; uint8_t k = 0;
+    do { ps[k] = PassLog::toPassage(rb[rbI + k]); k++; }
+    while (grouped && k < n && rbI + k < rbN && rb[rbI + k].seq == from + k && rb[rbI + k].seq < first
+           && (rb[rbI + k].ms & Passage::MS_PENDING) == (ps[0].ms & Passage::MS_PENDING));
+    if (!(grouped ? mqttPublishBatch(from, ps, k) : mqttPublishPass(from, ps[0]))) return true;
+    MqttOutbox::ack(from + k - 1, millis()); rbI += k; g_mqReplayed += k;
+  }
+  return false;
+}
+// File d'envoi : passages pas encore publiés, dans l'ordre des séquences, au débit MqttOutbox::rate()
+// (Wi-Fi coupé en mode 3, broker absent...). En mode groupé, last (retenu, pour HA) ne porte
+// que le dernier passage du lot ; count est republié une fois la file vidée.
+static void mqttDrain(){
+  if (!g_mq.enabled) { MqttOutbox::skipTo(g_passes.lastSeq()); return; }
+  if (!MqttLink::up()) return;
+  const bool grouped = MqttOutbox::batchWindow() != 0;
+  if (mqttReplay(grouped)) return;
+  uint32_t from, last = 0; uint8_t n;
+  while ((n = MqttOutbox::next(g_passes.firstSeq(), g_passes.lastSeq(), millis(), from)) != 0) {
+    if (g_passes.bySeq(from)->hole()) {   // trous : sautés sans message
+      uint32_t h = from; while (h < g_passes.lastSeq() && g_passes.bySeq(h + 1)->hole()) h++;
+      MqttOutbox::skipTo(h); continue;
+    }
+    if (grouped) n = batchRun(from, n);
+    Passage ps[MqttOutbox::MAX_BATCH]; for (uint8_t i = 0; i < n; i++) ps[i] = *g_passes.bySeq(from + i);
+    if (!(grouped ? mqttPublishBatch(from, ps, n) : mqttPublishPass(from, ps[0]))) break;
+    last = from + n - 1; MqttOutbox::ack(last, millis()); traceDone(Metrics::PASS_MQTT, from, last);
+  }
+  if (!last) return;
+  if (grouped) mqttPublishPass(last, *g_passes.bySeq(last));
+  if (MqttOutbox::acked() == g_passes.lastSeq()) publishCount();
+}
+// Journal : écriture différée ; les n passages en attente sont les n dernières séquences
+static void logPoll(){
+  const uint32_t n = PassLog::pending(), t0 = micros();
+  PassLog::poll();
+  if (!n || PassLog::pending() >= n) return;
+  Metrics::observe(Metrics::FLASH, micros() - t0);
+  traceDone(Metrics::PASS_FLASH, g_passes.lastSeq() - n + 1, g_passes.lastSeq());
+}
+// Curseur de la file en NVS (SAVE_MS au plus) : la file survit au reboot avec l'historique
+static uint32_t outboxLoad(){ Preferences p; uint32_t v = 0; if (p.begin("mqob", true)) { v = p.getUInt("ack", 0); p.end(); } return v; }
+static void outboxSave(){
+  const uint32_t t0 = micros();
+  Preferences p; if (p.begin("mqob", false)) { p.putUInt("ack", MqttOutbox::acked()); p.end(); }
+  Metrics::observe(Metrics::FLASH, micros() - t0);
+  MqttOutbox::markSaved(millis());
+}
 
-  if (wantSleep && g_pw.sleep_mode == 1){
-    WiFi.setSleep(true);
-    esp_wifi_set_ps(WIFI_PS_MIN_MODEM);
-  } else {
-    WiFi.setSleep(false);
-    esp_wifi_set_ps(WIFI_PS_NONE);
+// ---------------- Power policy (PowerFsm) -------------------------
+// Override GPIO : l'ISR signale le front, le niveau est relu une fois dans loop()
+static volatile bool g_pwrEdge = false;
+static void IRAM_ATTR onPwrGpio(){ g_pwrEdge = true; }
+static bool pwrGpioActive(){ const int lvl = digitalRead(g_pw.sleep_gpio); return g_pw.sleep_gpio_active_high ? (lvl==HIGH) : (lvl==LOW); }
+// CPU et Wi-Fi de base une seule fois (la config Power redémarre l'ESP32)
+static void powerBegin(){
+  setCpuFrequencyMhz((int)g_pw.cpu_mhz);
+  WiFi.setSleep(false); esp_wifi_set_ps(WIFI_PS_NONE);
+  PowerFsm::Cfg c; c.sleep = g_pw.wifi_sleep; c.mode = g_pw.sleep_mode;
+  PowerFsm::begin(c, millis());
+  if (g_pw.sleep_gpio >= 0) {
+    pinMode(g_pw.sleep_gpio, INPUT_PULLUP);
+    attachInterrupt(digitalPinToInterrupt(g_pw.sleep_gpio), onPwrGpio, CHANGE);
+    PowerFsm::setOverride(pwrGpioActive());
   }
 }
+// Matériel touché sur transition uniquement
+static void powerApply(PowerFsm::State from, PowerFsm::State to){
+  Serial.printf("[PWR] %s -> %s\n", PowerFsm::name(from), PowerFsm::name(to));
+  if (from == PowerFsm::RADIO_OFF)   wifiEnsureOn();
+  if (from == PowerFsm::MODEM_SLEEP) { WiFi.setSleep(false); esp_wifi_set_ps(WIFI_PS_NONE); }
+  if (to == PowerFsm::MODEM_SLEEP)   { WiFi.setSleep(true);  esp_wifi_set_ps(WIFI_PS_MIN_MODEM); }
+  if (to == PowerFsm::RADIO_OFF)     wifiEnsureOff();
+}
+static void powerService(){
+  if (g_pwrEdge) { g_pwrEdge = false; PowerFsm::setOverride(pwrGpioActive()); }
+  PowerFsm::State from, to;
+  if (PowerFsm::poll(millis(), from, to)) powerApply(from, to);
+  if (PowerFsm::state() == PowerFsm::LIGHT_SLEEP) lightSleepSlice();
+}
 
 // ----------- PAGE 2 : CONFIGURATION (pas d’au
 // ---------------- API Passages / Options -----------------------
-struct Passage; // fwd decl
-static void mqttPublishPass(const Passage& p);
+static void mqttDrain();
 void handleMqttTest();
-static void applyPowerPolicy();
+void handleMetrics();
+void handleDiagRadar();
+static void publishMetrics();
 void handleMqttGet();
 void handleMqttSet();
 void handlePowerGet();
 void handlePowerSet();
 void handleWifiGet();
 void handleWifiSet();
+// Sortie HTTP chunkée : tampon fixe vidé par sendContent(), jamais de String géante
+struct ChunkOut {
+  char buf[1024]; size_t n = 0;
+  void begin(const char* type){ server.setContentLength(CONTENT_LENGTH_UNKNOWN); server.send(200, type, ""); }
+  void flush(){ if (n) { server.sendContent(buf, n); n = 0; } }
+  void add(const char* s, size_t len){ if (n + len > sizeof(buf)) flush(); if (len > sizeof(buf)) { server.sendContent(s, len); return; } memcpy(buf + n, s, len); n += len; }
+  void add(const char* s){ add(s, strlen(s)); }
+  void end(){ flush(); server.sendContent("", 0); }
+};
+// Réponses JSON sans allocation (JsonOut) : courte -> tampon de pile envoyé d'un bloc ;
+// longue -> HttpJson, tampon vidé en chunks au fil de l'écriture
+static void sendJSON(JsonOut& j, int code = 200){ server.send_P(code, "application/json", j.c_str(), j.size()); }
+static void httpSink(void*, const char* p, size_t n){ server.sendContent(p, n); }
+// Route GET chronométrée (Metrics, histogramme par route)
+static void route(const char* uri, WebServer::THandlerFunction fn){
+  const uint8_t id = Metrics::route(uri);
+  server.on(uri, HTTP_GET, [id, fn](){ const uint32_t t0 = micros(); fn(); Metrics::observeRoute(id, micros() - t0); });
+}
+struct HttpJson {
+  char buf[1024]; JsonOut j;
+  HttpJson() : j(buf, sizeof(buf), httpSink) { server.setContentLength(CONTENT_LENGTH_UNKNOWN); server.send(200, "application/json", ""); }
+  void end(){ j.flush(); server.sendContent("", 0); }
+};
+struct PassFilter {
+  time_t from = 0, to = 0; int dir = -1; uint8_t minspd = 0; int zone = -1;
+  bool match(const Passage& p) const { return !p.hole() && (!(from || to) || !(p.ms & Passage::MS_PENDING)) && (!from || p.ts >= from) && (!to || p.ts <= to) && (dir < 0 || p.dir == dir) && p.speed_kmh >= minspd && (zone < 0 || p.zone == zone); }
+};
+static PassFilter passFilterFromArgs(){
+  PassFilter f;
+  if (server.hasArg("from"))   f.from = (time_t)server.arg("from").toInt();
+  if (server.hasArg("to"))     f.to   = (time_t)server.arg("to").toInt();
+  if (server.hasArg("dir"))    f.dir  = server.arg("dir").toInt() ? 1 : 0;
+  if (server.hasArg("minspd")) f.minspd = (uint8_t)constrain(server.arg("minspd").toInt(),0,255);
+  if (server.hasArg("zone"))   f.zone = (int)constrain(server.arg("zone").toInt(),0,Zones::MAX_ZONES);
+  return f;
+}
+// Champs d'un passage (objet ouvert par l'appelant) ; compat /api/last : "distance_m" et dir +1/-1
+static void passFields(JsonOut& j, const Passage& p, bool compat = false){
+  const time_t ts = passEpoch(p); char dt[24]; fmtDateBuf(dt, sizeof(dt), ts);
+  j.key("epoch").u((uint32_t)ts).key("ms").u(p.ms & Passage::MS_MASK).key("datetime").str(dt).key("dir").i(p.dir ? 1 : (compat ? -1 : 0)).key("speed_kmh").u(p.speed_kmh).key("speed_raw").u(p.speed_raw)
+   .key(compat ? "distance_m" : "dist_m").u(p.dist_m).key("dist_out").u(p.dist_out).key("dwell_s").fix(p.dwell_ds, 1).key("angle_deg").i(p.angle).key("snr").u(p.snr).key("zone").u(p.zone);
+}
+// Push SSE d'un passage : la ligne /api/passes + le delta stats (passage évincé du ring le cas échéant)
+static void livePublishPass(uint32_t seq, const Passage& p, const Passage* evicted){
+  if (!LivePush::clients()) return;
+  char buf[320]; JsonOut j(buf, sizeof(buf));
+  j.obj().key("seq").u(seq); passFields(j, p);
+  if (evicted) j.key("evict").obj().key("speed_kmh").u(evicted->speed_kmh).key("dir").u(evicted->dir ? 1 : 0).end();
+  j.end();
+  LivePush::publish("pass", j.c_str(), j.size());
+}
+// /api/passes?since=S&limit=N&from=&to=&dir=&minspd=
+//  - since présent : passages de séquence > S, du plus ancien au plus récent ; "next" = curseur à renvoyer
+//  - sans since    : les N plus récents (plus récent d'abord) ; "next" = dernière séquence connue
+// Réponse : {"first":..,"last":..,"next":..,"more":0|1,"passes":[{"seq":..,...}]}
 void handlePasses(){
-  bumpActivity(); String j="["; for(size_t i=0;i<g_passes.size();++i){ const auto& p=g_passes[i]; if(i) j+=','; j+="{\"epoch\":"+String((long)p.ts)+",\"datetime\":\""+fmtDate(p.ts)+"\",\"dir\":"+(p.dir?String(1):String(0))+
-    ",\"speed_kmh\":"+String(p.speed_kmh)+",\"dist_m\":"+String(p.dist_m)+",\"angle_deg\":"+String((int)p.angle)+",\"snr\":"+String(p.snr)+"}"; } j+="]";
-  server.send(200,"application/json",j);
+  bumpActivity();
+  const uint32_t first = g_passes.firstSeq(), last = g_passes.lastSeq();   // vide : first == last + 1
+  const bool hasSince = server.hasArg("since");
+  const uint32_t since = hasSince ? (uint32_t)strtoul(server.arg("since").c_str(), nullptr, 10) : 0;
+  if (hasSince && since >= last) {   // rien de nouveau : réponse fixe, sans parcours
+    char buf[128]; JsonOut j(buf, sizeof(buf));
+    j.obj().key("passes").arr().end().key("first").u(first).key("last").u(last).key("next").u(since).key("more").u(0).end();
+    sendJSON(j); return;
+  }
+  const uint16_t limit = server.hasArg("limit") ? (uint16_t)constrain(server.arg("limit").toInt(),1,500) : 100;
+  const PassFilter f = passFilterFromArgs();
+  HttpJson h; JsonOut& j = h.j;
+  j.obj().key("passes").arr();
+  uint16_t cnt = 0; uint32_t next = hasSince ? since : last; bool more = false;
+  if (hasSince) {
+    for (uint32_t s = (since + 1 > first ? since + 1 : first); s <= last; s++) {
+      const Passage* p = g_passes.bySeq(s); next = s;
+      if (!f.match(*p)) continue;
+      if (cnt == limit) { more = true; next = s - 1; break; }
+      cnt++; j.obj().key("seq").u(s); passFields(j, *p); j.end();
+    }
+  } else {
+    for (uint32_t s = last; s >= first; s--) {
+      const Passage* p = g_passes.bySeq(s);
+      if (!f.match(*p)) continue;
+      if (cnt == limit) { more = true; break; }
+      cnt++; j.obj().key("seq").u(s); passFields(j, *p); j.end();
+    }
+  }
+  j.end().key("first").u(first).key("last").u(last).key("next").u(next).key("more").u(more ? 1 : 0).end();
+  h.end();
+}
+// Compat data/index.html : /api/last?n=N -> {"passes":[...]} du plus récent au plus ancien, dir +1/-1
+void handleLast(){
+  bumpActivity();
+  const uint16_t n = server.hasArg("n") ? (uint16_t)constrain(server.arg("n").toInt(),1,500) : 100;
+  HttpJson h; JsonOut& j = h.j;
+  j.obj().key("passes").arr();
+  for (size_t i = 0, k = 0; i < g_passes.size() && k < n; i++) { const Passage& p = g_passes.newest(i); if (p.hole()) continue; k++; j.obj(); passFields(j, p, true); j.end(); }
+  j.end().end(); h.end();
+}
+// Statistiques incrémentales (PassStats) : coût O(classes), pas O(passages)
+void handleStats(){
+  bumpActivity();
+  uint8_t w  = server.hasArg("binw")   ? (uint8_t)constrain(server.arg("binw").toInt(),1,50)    : STATS_BIN_W;
+  uint8_t mx = server.hasArg("binmax") ? (uint8_t)constrain(server.arg("binmax").toInt(),5,250) : STATS_BIN_MAX;
+  uint32_t bins[PassStats::MAX_BINS]; uint8_t NB = PassStats::bins(w, mx, bins, PassStats::MAX_BINS);
+  PassStats::Summary sm = PassStats::summary();
+  HttpJson h; JsonOut& j = h.j;
+  j.obj().key("speed_bins").arr();
+  for(int i=0;i<NB;i++){ int mi=i*w, ma=(i==NB-1)?999:(mi+w-1); j.obj().key("min").i(mi).key("max").i(ma).key("count").u(bins[i]).end(); }
+  j.end().key("dir_counts").obj().key("approach").u(sm.approach).key("away").u(sm.away).end();
+  j.key("count").u(sm.count).key("speed").obj().key("min").u(sm.vmin).key("mean").f(sm.vmean,1).key("max").u(sm.vmax).end();
+  j.key("speed_raw").obj().key("min").u(sm.rmin).key("mean").f(sm.rmean,1).key("max").u(sm.rmax).end().key("speed_mode").str(SpeedCorr::modeName(SpeedCorr::get().mode));
+  j.key("hours").arr(); const uint32_t* hr=PassStats::hours(); for(int i=0;i<24;i++) j.u(hr[i]);
+  j.end().key("weekdays").arr(); const uint32_t* d=PassStats::weekdays(); for(int i=0;i<7;i++) j.u(d[i]);
+  j.end().key("zones").arr();
+  for(uint8_t i=0;i<Zones::MAX_ZONES;i++){ const Zones::Zone& z=Zones::get(i); PassStats::ZoneSummary zs=PassStats::zone(i+1);
+    if((!z.n || z.kind!=Zones::K_COUNT) && !zs.count) continue;
+    j.obj().key("id").u(i+1).key("name").str(z.name).key("count").u(zs.count).key("approach").u(zs.approach).key("away").u(zs.away)
+     .key("speed").obj().key("min").u(zs.vmin).key("mean").f(zs.vmean,1).key("max").u(zs.vmax).key("v85").u(zs.v85).end().end(); }
+  j.end().end(); h.end();
+}
+// Zones de détection : GET -> liste ; ?id=N&kind=count|ignore&name=..&pts=a,d;a,d;.. -> remplace la zone N (pts vide : efface)
+static void sendZones(){
+  HttpJson h; JsonOut& j = h.j;
+  j.obj().key("grid").obj().key("ang_min").i(Zones::ANG_MIN).key("ang_step").u(Zones::ANG_STEP).key("cols").u(Zones::COLS).key("rows").u(Zones::ROWS).end().key("zones").arr();
+  for(uint8_t i=0;i<Zones::MAX_ZONES;i++){ const Zones::Zone& z=Zones::get(i); char pts[96]; Zones::formatPts(z, pts, sizeof(pts));
+    j.obj().key("id").u(i+1).key("name").str(z.name).key("kind").str(Zones::kindName(z.kind)).key("pts").str(pts).end(); }
+  j.end().end(); h.end();
+}
+void handleZones(){
+  bumpActivity();
+  if (!server.hasArg("id")) { sendZones(); return; }
+  const int id = server.arg("id").toInt();
+  Zones::Zone z;
+  // pts obligatoire : pts= (vide) supprime la zone, un id seul n'efface rien
+  if (id < 1 || id > Zones::MAX_ZONES || !server.hasArg("pts") || !Zones::parsePts(server.arg("pts").c_str(), z)) { server.send(400,"application/json","{\"ok\":0,\"err\":\"id 1..4, pts a,d;a,d;a,d (3..8 sommets, vide = suppression)\"}"); return; }
+  z.kind = Zones::kindFromName(server.arg("kind").c_str());
+  strncpy(z.name, server.arg("name").c_str(), Zones::NAME_LEN - 1); z.name[Zones::NAME_LEN - 1] = 0;
+  Zones::set(id - 1, z); saveConfig();
+  Serial.printf("[ZONE] %d %s \"%s\" %u pt(s)\n", id, Zones::kindName(z.kind), Zones::get(id - 1).name, (unsigned)z.n);
+  sendZones();
+}
+// P50/P85 en flux (SpeedQ) : {"total":{"all":{"n":..,"p50":..,"p85":..},"approach":..,"away":..},"day":..,"hour":..}
+static void speedsJSON(JsonOut& j){
+  j.obj();
+  for(uint8_t w=0; w<SpeedQ::W_COUNT; w++){ j.key(SpeedQ::windowName(SpeedQ::Window(w))).obj();
+    for(uint8_t d=0; d<SpeedQ::D_COUNT; d++){ auto r=SpeedQ::get(SpeedQ::Window(w), SpeedQ::Dir(d));
+      j.key(SpeedQ::dirName(SpeedQ::Dir(d))).obj().key("n").u(r.n).key("p50").f(r.p50,1).key("p85").f(r.p85,1).end(); }
+    j.end(); }
+  j.end();
+}
+void handleSpeeds(){
+  bumpActivity(); SpeedQ::tick(nowLocal());
+  if (server.arg("reset")=="1") { SpeedQ::reset(); publishSpeeds(); }
+  char buf[512]; JsonOut j(buf, sizeof(buf)); speedsJSON(j); sendJSON(j);
+}
+void handleClear(){ bumpActivity(); g_passes.clear(); g_holes = 0; MqttOutbox::skipTo(g_passes.lastSeq()); PassStats::reset(); PassLog::clear(); LittleFS.remove(CSV_PATH); LivePush::publish("clear", "{}", 2); server.send(200,"application/json","{\"ok\":1}"); }
+// CSV rendu à la volée depuis le journal binaire (chunké, rien n'est matérialisé)
+// /csv?from=EPOCH&to=EPOCH : seuls les segments concernés sont ouverts
+// Ligne de l'ancien /passes.csv (epoch,datetime,direction,speed_kmh,dist_m,angle_deg,snr) aux
+// colonnes actuelles : speed_raw = vitesse radiale d'alors, zone 0, dist_out/dwell_s/ms inconnus
+static void addLegacyCsvRow(ChunkOut& out, const char* line, size_t n){
+  const char* f = line; uint8_t k = 0;
+  for (size_t i = 0; i < n && k < 3; i++) if (line[i] == ',') { k++; f = line + i + 1; }
+  if (k < 3) return;                                    // ligne tronquée
+  size_t sl = 0; while (f + sl < line + n && f[sl] >= '0' && f[sl] <= '9' && sl < 3) sl++;
+  char tail[16]; int t = snprintf(tail, sizeof(tail), ",,,%.*s,0,\n", (int)sl, f);
+  out.add(line, n); if (t > 0) out.add(tail, size_t(t));
 }
-void handleClear(){ bumpActivity(); g_passes.clear(); LittleFS.remove(CSV_PATH); server.send(200,"application/json","{\"ok\":1}"); }
 void handleCSV(){
-  bumpActivity(); if (!LittleFS.exists(CSV_PATH)) {
-    File tmp=LittleFS.open(CSV_PATH, FILE_WRITE);
-    if(!tmp){ server.send(500,"text/plain","CSV create error"); return; }
-    tmp.println("epoch,datetime,direction,speed_kmh,dist_m,angle_deg,snr");
-    for (const auto& p: g_passes) tmp.printf("%ld,%s,%s,%u,%u,%d,%u\n",(long)p.ts, fmtDate(p.ts).c_str(), p.dir?"approach":"away", p.speed_kmh, p.dist_m, (int)p.angle, p.snr);
-    tmp.close();
+  bumpActivity();
+  const uint32_t from = server.hasArg("from") ? (uint32_t)strtoul(server.arg("from").c_str(), nullptr, 10) : 0;
+  const uint32_t to   = server.hasArg("to")   ? (uint32_t)strtoul(server.arg("to").c_str(), nullptr, 10)   : 0;
+  PassLog::Reader rd; rd.open(from, to);
+  server.sendHeader("Content-Disposition","attachment; filename=passes.csv");
+  ChunkOut out; out.begin("text/csv");
+  out.add("epoch,datetime,direction,speed_kmh,dist_m,angle_deg,snr,dist_out,dwell_s,speed_raw,zone,ms\n");
+  File legacy = (from || to) ? File() : LittleFS.open(CSV_PATH, FILE_READ);
+  if (legacy) {   // en-tête d'origine sauté, lignes converties une à une
+    char line[128]; size_t ln = 0; bool hdr = true, over = false; uint8_t b[256]; size_t n;
+    while ((n = legacy.read(b, sizeof(b))) > 0)
+      for (size_t i = 0; i < n; i++) {
+        const char c = char(b[i]);
+        if (c != '\n') { if (c != '\r') { if (ln < sizeof(line)) line[ln++] = c; else over = true; } continue; }
+        if (!hdr && !over && ln) addLegacyCsvRow(out, line, ln);
+        hdr = over = false; ln = 0;
+      }
+    if (!hdr && !over && ln) addLegacyCsvRow(out, line, ln);
+    legacy.close();
+  }
+  PassLog::Record r; char row[112];
+  while (rd.next(r)) {
+    const uint32_t ep = (r.ms & Passage::MS_PENDING) ? 0 : r.epoch;   // boot jamais calé
+    char dt[24]; fmtDateBuf(dt, sizeof(dt), (time_t)ep);
+    int n = snprintf(row, sizeof(row), "%lu,%s,%s,%u,%u,%d,%u,%u,%u.%u,%u,%u,%u\n", (unsigned long)ep, dt, r.dir?"approach":"away", r.speed_kmh, r.dist_m, (int)r.angle, r.snr,
+                     r.dist_out, r.dwell_ds / 10, r.dwell_ds % 10, r.speed_raw ? r.speed_raw : r.speed_kmh, r.zone, (unsigned)(r.ms & Passage::MS_MASK));
+    if (n > 0) out.add(row, size_t(n) < sizeof(row) ? size_t(n) : sizeof(row) - 1);
   }
-  File f=LittleFS.open(CSV_PATH, FILE_READ);
-  if(!f){ server.send(500,"text/plain","CSV open error"); return; }
-  server.sendHeader("Content-Disposition","attachment; filename=passes.csv"); server.streamFile(f,"text/csv"); f.close();
+  rd.close(); out.end();
+  if (rd.bad()) Serial.printf("[LOG] csv export skipped %lu bad record(s)\n", (unsigned long)rd.bad());
+}
+// Index des segments du journal : {"budget_kb":..,"used_kb":..,"count":..,"pending":..,"segments":[{"id","first","last","count","bytes"}]}
+void handleLogInfo(){
+  bumpActivity();
+  const PassLog::SegInfo* sg; uint8_t n = PassLog::segments(&sg);
+  ChunkOut out; out.begin("application/json"); char row[128];
+  snprintf(row, sizeof(row), "{\"budget_kb\":%lu,\"used_kb\":%lu,\"count\":%lu,\"pending\":%lu,\"segments\":[",
+           (unsigned long)(PassLog::budget()/1024), (unsigned long)(PassLog::bytes()/1024), (unsigned long)PassLog::count(), (unsigned long)PassLog::pending());
+  out.add(row);
+  for (uint8_t i = 0; i < n; i++) {
+    int k = snprintf(row, sizeof(row), "%s{\"id\":%lu,\"first\":%lu,\"last\":%lu,\"count\":%lu,\"bytes\":%lu}", i ? "," : "",
+                     (unsigned long)sg[i].id, (unsigned long)sg[i].first, (unsigned long)sg[i].last, (unsigned long)sg[i].count, (unsigned long)sg[i].bytes);
+    if (k > 0) out.add(row, size_t(k));
+  }
+  out.add("]}"); out.end();
 }
 void handleOptionsGet(){
-  bumpActivity(); String j = "{\"approach\":" + String(ONLY_APPROACH?1:0) + ",\"minspd\":" + String(MIN_SPEED) + ",\"debounce\":" + String(PASS_DEBOUNCE_MS) + "}";
-  server.send(200,"application/json",j);
+  bumpActivity(); const SpeedCorr::Geometry geo = SpeedCorr::get();
+  char buf[256]; JsonOut j(buf, sizeof(buf));
+  j.obj().key("approach").u(ONLY_APPROACH?1:0).key("minspd").u(MIN_SPEED).key("debounce").u(PASS_DEBOUNCE_MS)
+   .key("binw").u(STATS_BIN_W).key("binmax").u(STATS_BIN_MAX).key("logkb").u(LOG_BUDGET_KB).key("mqrate").u(MqttOutbox::rate())
+   .key("mqbatch").u(MqttOutbox::batchWindow()).key("mqfmt").str(g_mqFmt == MQ_BIN ? "bin" : "json").key("mqmetrics").u(g_metricsS).key("trace").b(g_trace).key("uarthi").b(g_uartHi)
+   .key("spdmode").u(geo.mode).key("spdh").u(geo.height_dm).key("spdoff").u(geo.offset_dm).key("spdyaw").i(geo.yaw_deg).end();
+  sendJSON(j);
+}
+// Paramètres reconnus par /api/options : sans aucun d'eux, lecture seule (pas d'écriture flash)
+static const char* const OPTION_KEYS[] = { "approach", "minspd", "debounce", "binw", "binmax", "mqrate", "mqbatch", "mqfmt", "trace",
+  "uarthi", "mqmetrics", "logkb", "spdmode", "spdh", "spdoff", "spdyaw" };
+static bool hasOptionKey(){
+  for (const char* k : OPTION_KEYS) if (server.hasArg(k)) return true;
+  return false;
 }
 void handleOptionsSet(){
+  if (!hasOptionKey()) { handleOptionsGet(); return; }
   bumpActivity(); if (server.hasArg("approach")) ONLY_APPROACH = (server.arg("approach")=="1");
   if (server.hasArg("minspd"))   MIN_SPEED = (uint8_t)constrain(server.arg("minspd").toInt(),0,120);
-  if (server.hasArg("debounce")) PASS_DEBOUNCE_MS = (uint32_t)constrain(server.arg("debounce").toInt(),200,5000);
+  if (server.hasArg("debounce")) { PASS_DEBOUNCE_MS = (uint32_t)constrain(server.arg("debounce").toInt(),200,5000); applyTrackerParams(); }
+  if (server.hasArg("binw"))     STATS_BIN_W = (uint8_t)constrain(server.arg("binw").toInt(),1,50);
+  if (server.hasArg("binmax"))   STATS_BIN_MAX = (uint8_t)constrain(server.arg("binmax").toInt(),5,250);
+  if (server.hasArg("mqrate"))   MqttOutbox::setRate((uint16_t)constrain(server.arg("mqrate").toInt(),1,50));
+  if (server.hasArg("mqbatch"))  MqttOutbox::setBatch((uint16_t)constrain(server.arg("mqbatch").toInt(),0,900), MqttOutbox::MAX_BATCH);
+  if (server.hasArg("mqfmt"))    g_mqFmt = server.arg("mqfmt")=="json" ? MQ_JSON : MQ_BIN;
+  if (server.hasArg("trace"))    g_trace = server.arg("trace").toInt() != 0;
+  if (server.hasArg("uarthi"))   { g_uartHi = server.arg("uarthi").toInt() != 0; RadarLink::setWant(g_uartHi ? RadarLink::HIGH_BAUD : 0); }
+  if (server.hasArg("mqmetrics")) { long v = server.arg("mqmetrics").toInt(); g_metricsS = v ? (uint16_t)constrain(v,10,3600) : 0; }
+  if (server.hasArg("logkb"))    { LOG_BUDGET_KB = (uint16_t)constrain(server.arg("logkb").toInt(),32,8192); PassLog::setBudget(logBudgetBytes()); }
+  SpeedCorr::Geometry geo = SpeedCorr::get();
+  if (server.hasArg("spdmode"))  geo.mode = (uint8_t)constrain(server.arg("spdmode").toInt(),0,SpeedCorr::M_COUNT-1);
+  if (server.hasArg("spdh"))     geo.height_dm = (uint8_t)constrain(server.arg("spdh").toInt(),0,250);
+  if (server.hasArg("spdoff"))   geo.offset_dm = (uint16_t)constrain(server.arg("spdoff").toInt(),0,1000);
+  if (server.hasArg("spdyaw"))   geo.yaw_deg = (int8_t)constrain(server.arg("spdyaw").toInt(),-60,60);
+  SpeedCorr::set(geo);
   saveConfig();
   handleOptionsGet();
 }
 
 // ---------------------- API CONFIG -----------------------------
-bool readDetSync(DetParams& out){
-  cmd_enableCfg(); if(!waitAck(CMD_ENABLE_CFG, 800)) return false;
-  sendCmd(CMD_GET_DET,nullptr,0); if(!waitAck(CMD_GET_DET, 1500)) { cmd_endCfg(); waitAck(CMD_END_CFG, 800); return false; }
-  cmd_endCfg(); waitAck(CMD_END_CFG, 800);
-  if (g_ack.status!=0 || g_ack.data.size()<4) return false;
-  out.maxDist_m=g_ack.data[0]; out.dirMode=g_ack.data[1]; out.minSpeed_kmh=g_ack.data[2]; out.noTargetDelay_s=g_ack.data[3]; out.valid=true; return true;
-}
-bool readSensSync(SensParams& out){
-  cmd_enableCfg(); if(!waitAck(CMD_ENABLE_CFG, 800)) return false;
-  sendCmd(CMD_GET_SENS,nullptr,0); if(!waitAck(CMD_GET_SENS, 1500)) { cmd_endCfg(); waitAck(CMD_END_CFG, 800); return false; }
-  cmd_endCfg(); waitAck(CMD_END_CFG, 800);
-  if (g_ack.status!=0 || g_ack.data.size()<4) return false;
-  out.trigCount=g_ack.data[0]; out.snrLevel=g_ack.data[1]; out.ext1=g_ack.data[2]; out.ext2=g_ack.data[3]; out.valid=true; return true;
-}
-bool setDetSync(const DetParams& in){
-  uint8_t v[4]={ in.maxDist_m, in.dirMode, in.minSpeed_kmh, in.noTargetDelay_s };
-  cmd_enableCfg(); if(!waitAck(CMD_ENABLE_CFG, 800)) return false;
-  sendCmd(CMD_SET_DET, v, 4); if(!waitAck(CMD_SET_DET, 1500)) { cmd_endCfg(); waitAck(CMD_END_CFG, 800); return false; }
-  cmd_endCfg(); waitAck(CMD_END_CFG, 800);
-  return g_ack.status==0;
-}
-bool setSensSync(const SensParams& in){
-  uint8_t v[4]={ in.trigCount, in.snrLevel, in.ext1, in.ext2 };
-  cmd_enableCfg(); if(!waitAck(CMD_ENABLE_CFG, 800)) return false;
-  sendCmd(CMD_SET_SENS, v, 4); if(!waitAck(CMD_SET_SENS, 1500)) { cmd_endCfg(); waitAck(CMD_END_CFG, 800); return false; }
-  cmd_endCfg(); waitAck(CMD_END_CFG, 800);
-  return g_ack.status==0;
+// Les commandes radar passent par RadarCmd : les handlers HTTP renvoient un id de
+// job ({"ok":1,"job":N}) et l'UI suit l'avancement via /api/cfg/job?id=N.
+static bool detFromAck(const RadarCmd::Job& j, DetParams& out){
+  const RadarCmd::StepResult* r = j.result(CMD_GET_DET);
+  if (!r || r->status!=0 || r->n<4) return false;
+  out.maxDist_m=r->data[0]; out.dirMode=r->data[1]; out.minSpeed_kmh=r->data[2]; out.noTargetDelay_s=r->data[3]; out.valid=true; return true;
+}
+static bool sensFromAck(const RadarCmd::Job& j, SensParams& out){
+  const RadarCmd::StepResult* r = j.result(CMD_GET_SENS);
+  if (!r || r->status!=0 || r->n<4) return false;
+  out.trigCount=r->data[0]; out.snrLevel=r->data[1]; out.ext1=r->data[2]; out.ext2=r->data[3]; out.valid=true; return true;
+}
+static RadarCmd::Step stepSetDet(const DetParams& in){ uint8_t v[4]={ in.maxDist_m, in.dirMode, in.minSpeed_kmh, in.noTargetDelay_s }; return RadarCmd::step(CMD_SET_DET, v, 4); }
+static RadarCmd::Step stepSetSens(const SensParams& in){ uint8_t v[4]={ in.trigCount, in.snrLevel, in.ext1, in.ext2 }; return RadarCmd::step(CMD_SET_SENS, v, 4); }
+static bool sameDet(const DetParams& a, const DetParams& b){ return a.maxDist_m==b.maxDist_m && a.dirMode==b.dirMode && a.minSpeed_kmh==b.minSpeed_kmh && a.noTargetDelay_s==b.noTargetDelay_s; }
+static bool sameSens(const SensParams& a, const SensParams& b){ return a.trigCount==b.trigCount && a.snrLevel==b.snrLevel && a.ext1==b.ext1 && a.ext2==b.ext2; }
+static uint8_t countSets(const RadarCmd::Job& j){ uint8_t n=0; for(uint8_t i=0;i<j.n;i++) if (j.steps[i].cmd==CMD_SET_DET||j.steps[i].cmd==CMD_SET_SENS) n++; return n; }
+
+// Miroir radar <- GET lus et SET acquittés du job
+static void mirrorFromJob(const RadarCmd::Job& j){
+  detFromAck(j, g_rdet); sensFromAck(j, g_rsens);
+  for (uint8_t i=0;i<j.n;i++){
+    const RadarCmd::Step& st=j.steps[i]; if (!j.res[i].acked || j.res[i].status!=0) continue;
+    if (st.cmd==CMD_SET_DET) { g_rdet.maxDist_m=st.v[0]; g_rdet.dirMode=st.v[1]; g_rdet.minSpeed_kmh=st.v[2]; g_rdet.noTargetDelay_s=st.v[3]; g_rdet.valid=true; }
+    if (st.cmd==CMD_SET_SENS){ g_rsens.trigCount=st.v[0]; g_rsens.snrLevel=st.v[1]; g_rsens.ext1=st.v[2]; g_rsens.ext2=st.v[3]; g_rsens.valid=true; }
+  }
+}
+// ext1/ext2 ne sont pas persistés : on conserve ceux du radar quand on les connaît
+static SensParams withRadarExt(SensParams s){ if (g_rsens.valid){ s.ext1=g_rsens.ext1; s.ext2=g_rsens.ext2; } return s; }
+
+// Amène le radar à (d,s) en une seule session ENABLE..END, en n'écrivant que les
+// blocs qui diffèrent. Miroir connu : diff immédiat (aucun échange si identique) ;
+// sinon GET_DET + GET_SENS puis SET des seuls écarts, dans la même session.
+static uint32_t submitSync(const char* name, const DetParams& d, const SensParams& s, RadarCmd::Callback done){
+  RadarCmd::Callback cb = [done](const RadarCmd::Job& j){ mirrorFromJob(j); if (done) done(j); };
+  if (g_rdet.valid && g_rsens.valid){
+    SensParams s2=withRadarExt(s); RadarCmd::Step st[2]; uint8_t n=0;
+    if (!sameDet(d, g_rdet))    st[n++]=stepSetDet(d);
+    if (!sameSens(s2, g_rsens)) st[n++]=stepSetSens(s2);
+    return RadarCmd::submit(name, st, n, cb);
+  }
+  uint32_t id = RadarCmd::submit(name, { RadarCmd::step(CMD_GET_DET), RadarCmd::step(CMD_GET_SENS) }, cb);
+  RadarCmd::setHook(id, [d,s](RadarCmd::Job& j, uint8_t i){
+    if (j.steps[i].cmd!=CMD_GET_SENS) return;
+    detFromAck(j, g_rdet); sensFromAck(j, g_rsens);
+    SensParams s2=withRadarExt(s);
+    if (!g_rdet.valid  || !sameDet(d, g_rdet))    RadarCmd::insertBeforeEnd(j, stepSetDet(d));
+    if (!g_rsens.valid || !sameSens(s2, g_rsens)) RadarCmd::insertBeforeEnd(j, stepSetSens(s2));
+  });
+  return id;
+}
+static uint32_t submitApply(const char* name, const DetParams& d, const SensParams& s){
+  return submitSync(name, d, s, [d,s](const RadarCmd::Job& j){ if (j.ok()){ g_det=d; g_sens=withRadarExt(s); saveConfig(); } });
+}
+static void sendJob(uint32_t id, uint32_t baud = 0){
+  if (!id) { server.send(503,"application/json","{\"ok\":0,\"busy\":1}"); return; }
+  char buf[64]; JsonOut j(buf, sizeof(buf));
+  j.obj().key("ok").u(1).key("job").u(id);
+  if (baud) j.key("baud").u(baud);
+  j.end(); sendJSON(j);
+}
+void handleCfgJob(){
+  bumpActivity(); const RadarCmd::Job* jb = RadarCmd::find((uint32_t)server.arg("id").toInt());
+  if (!jb) { server.send(404,"application/json","{\"ok\":0}"); return; }
+  bool fin = jb->state==RadarCmd::DONE || jb->state==RadarCmd::FAILED;
+  char buf[512]; JsonOut j(buf, sizeof(buf));
+  j.obj().key("id").u(jb->id).key("name").str(jb->name).key("state").str(RadarCmd::stateStr(jb->state)).key("ok").u(jb->ok()?1:0)
+   .key("ms").u(fin ? (jb->t_end - jb->t_start) : 0).key("steps").arr();
+  for (uint8_t i=0;i<jb->n;i++) j.obj().key("cmd").u(jb->steps[i].cmd).key("acked").u(jb->res[i].acked?1:0).key("status").u(jb->res[i].status).end();
+  j.end().end(); sendJSON(j);
 }
 void handleCfgGet(){
-  bumpActivity(); String j="{";
-  if (g_det.valid) j += "\"det\":{\"max\":"+String(g_det.maxDist_m)+",\"dir\":"+String(g_det.dirMode)+",\"minspd\":"+String(g_det.minSpeed_kmh)+",\"delay\":"+String(g_det.noTargetDelay_s)+"},";
-  else j+="\"det\":null,";
-  if (g_sens.valid) j += "\"sens\":{\"trig\":"+String(g_sens.trigCount)+",\"snr\":"+String(g_sens.snrLevel)+"},";
-  else j+="\"sens\":null,";
-  j += "\"baudIdx\":"+String(g_baudIdxSaved)+",";
-  j += "\"applyBoot\":" + String(g_applyAtBoot?1:0) + "}";
-  server.send(200,"application/json",j);
-}
-void handleCfgRead(){ bumpActivity(); bool ok1=readDetSync(g_det); bool ok2=readSensSync(g_sens); if (ok1||ok2) saveConfig(); server.send(200,"application/json", String("{\"ok\":") + (ok1&&ok2?"1}":"0}")); }
+  bumpActivity(); char buf[192]; JsonOut j(buf, sizeof(buf));
+  j.obj().key("det");
+  if (g_det.valid) j.obj().key("max").u(g_det.maxDist_m).key("dir").u(g_det.dirMode).key("minspd").u(g_det.minSpeed_kmh).key("delay").u(g_det.noTargetDelay_s).end();
+  else j.null();
+  j.key("sens");
+  if (g_sens.valid) j.obj().key("trig").u(g_sens.trigCount).key("snr").u(g_sens.snrLevel).end();
+  else j.null();
+  j.key("baudIdx").i(g_baudIdxSaved).key("applyBoot").u(g_applyAtBoot?1:0).end();
+  sendJSON(j);
+}
+void handleCfgRead(){
+  bumpActivity();
+  sendJob(RadarCmd::submit("read", { RadarCmd::step(CMD_GET_DET), RadarCmd::step(CMD_GET_SENS) }, [](const RadarCmd::Job& j){
+    mirrorFromJob(j);
+    bool ok1=detFromAck(j, g_det); bool ok2=sensFromAck(j, g_sens); if (ok1||ok2) saveConfig();
+  }));
+}
 void handleCfgSet(){
   bumpActivity(); DetParams d=g_det; SensParams s=g_sens;
   if (server.hasArg("max"))   d.maxDist_m       = (uint8_t)constrain(server.arg("max").toInt(), 1, 120);
@@ -578,21 +955,16 @@ void handleCfgSet(){
   if (server.hasArg("trig"))  s.trigCount       = (uint8_t)constrain(server.arg("trig").toInt(), 1, 10);
   if (server.hasArg("snr"))   s.snrLevel        = (uint8_t)constrain(server.arg("snr").toInt(), 0, 8);
   if (server.hasArg("applyboot")) g_applyAtBoot = (server.arg("applyboot")=="1");
-  bool ok = setDetSync(d) && setSensSync(s); if (ok){ g_det=d; g_sens=s; saveConfig(); }
-  server.send(200,"application/json", String("{\"ok\":") + (ok?"1}":"0}"));
+  sendJob(submitApply("set", d, s));
 }
+// Bascule des deux côtés par RadarLink (SET_BAUD + REBOOT, vérification au nouveau débit) ;
+// baud_idx n'est enregistré qu'une fois le débit vérifié (linkReady())
 void handleCfgBaud(){
-  bumpActivity(); int idx = constrain(server.arg("idx").toInt(), 1, 8);
-  uint8_t v[2] = { (uint8_t)(idx & 0xFF), (uint8_t)(idx>>8) };
-  cmd_enableCfg(); waitAck(CMD_ENABLE_CFG, 800);
-  sendCmd(CMD_SET_BAUD, v, 2); bool ok = waitAck(CMD_SET_BAUD, 2000);
-  cmd_endCfg(); waitAck(CMD_END_CFG, 800);
-  g_baudIdxSaved = idx; saveConfig();
-  String j = String("{\"ok\":") + (ok?"1":"0") + ",\"baud\":"+idxToBaud(idx)+"}";
-  server.send(200,"application/json", j);
-}
-void handleReboot(){ sendCmd(CMD_REBOOT,nullptr,0); server.send(200,"application/json","{\"ok\":1}"); }
-void handleFactory(){ sendCmd(CMD_FACTORY_RST,nullptr,0); server.send(200,"application/json","{\"ok\":1}"); }
+  bumpActivity(); const int idx = constrain(server.arg("idx").toInt(), 1, 8);
+  sendJob(RadarLink::switchTo(RadarLink::idxToBaud(idx)), RadarLink::idxToBaud(idx));
+}
+void handleReboot(){ RadarCmd::send(CMD_REBOOT,nullptr,0); server.send(200,"application/json","{\"ok\":1}"); }
+void handleFactory(){ RadarCmd::send(CMD_FACTORY_RST,nullptr,0); g_rdet.valid=false; g_rsens.valid=false; RadarLink::rescan(RadarLink::REBOOT_MS); server.send(200,"application/json","{\"ok\":1}"); }
 
 void applyPresetValues(const String& name, DetParams& d, SensParams& s){
   if (name=="ped"){ d.maxDist_m=8;  d.dirMode=2;  d.minSpeed_kmh=2;  d.noTargetDelay_s=2; s.trigCount=2; s.snrLevel=5; }
@@ -602,8 +974,7 @@ void handleCfgPreset(){
   bumpActivity(); String name = server.arg("name");
   if (name!="ped" && name!="car"){ server.send(400,"application/json","{\"ok\":0}"); return; }
   DetParams d=g_det; SensParams s=g_sens; applyPresetValues(name,d,s);
-  bool ok = setDetSync(d) && setSensSync(s); if (ok){ g_det=d; g_sens=s; saveConfig(); }
-  server.send(200,"application/json", String("{\"ok\":") + (ok?"1}":"0}"));
+  sendJob(submitApply("preset", d, s));
 }
 
 // BLE placeholder (non documenté via UART)
@@ -611,14 +982,8 @@ void handleCfgBle(){ bumpActivity(); server.send(200,"application/json","{\"supp
 
 // ---------------------- DIAG PING ------------------------------
 void handleDiagPing(){
-  bumpActivity(); cmd_enableCfg(); bool a = waitAck(CMD_ENABLE_CFG, 800);
-  cmd_readVersion(); bool b = waitAck(CMD_READ_VERSION, 1500);
-  cmd_endCfg(); bool c = waitAck(CMD_END_CFG, 800);
-  char buf[160];
-  snprintf(buf, sizeof(buf),
-    "{\"ok\":%d,\"enable\":%d,\"readver\":%d,\"end\":%d,\"ack_cmd\":%u,\"status\":%u}",
-    (a&&b&&c)?1:0, a, b, c, (unsigned)g_ack.cmd, (unsigned)g_ack.status);
-  server.send(200, "application/json", buf);
+  bumpActivity();
+  sendJob(RadarCmd::submit("ping", { RadarCmd::step(CMD_READ_VERSION) }));
 }
 
 // ========================= WIFI & NTP =========================
@@ -638,6 +1003,23 @@ void setupWiFi(){
   }
 }
 
+// Débit radar vérifié (autobaud ou bascule) : persisté ; au premier, config radar appliquée si demandé
+static void linkReady(uint32_t baud){
+  static bool first = true;
+  g_uart_baud = baud;
+  const int idx = RadarLink::baudToIdx(baud); if (idx != g_baudIdxSaved) { g_baudIdxSaved = idx; saveConfig(); }
+  if (!first) return;
+  first = false;
+  if (g_applyAtBoot && g_det.valid && g_sens.valid) {
+    Serial.println("[BOOT] Applying stored radar config...");
+    submitSync("boot", g_det, g_sens, [](const RadarCmd::Job& j){
+      uint8_t n=countSets(j);
+      if (j.ok() && !n) Serial.println("[BOOT] radar already matches, nothing written");
+      else Serial.printf("[BOOT] apply %s (%u block(s) written)\n", j.ok()?"OK":"FAIL", (unsigned)n);
+    });
+  }
+}
+
 // ============================ SETUP/LOOP =======================
 void setup() {
   Serial.begin(115200); delay(200);
@@ -646,100 +1028,95 @@ void setup() {
   Serial.printf("[RESET] reason=%d (%s)\n", (int)rr, resetToStr(rr));
 
   if (!mountFS()) Serial.println("[FS] Mount fail");
-  loadConfig(); ensureFiles();
+  loadConfig(); Clock::begin(); ensureFiles(); applyTrackerParams();
+  passStoreBegin(); restorePasses(); MqttOutbox::begin(outboxLoad(), g_passes.lastSeq());
+  SpeedQ::begin();
 
   setupWiFi();
-  Serial2.begin(g_uart_baud, SERIAL_8N1, RADAR_RX, RADAR_TX);
+  g_uart_baud = RadarLink::idxToBaud(g_baudIdxSaved);
+  RadarTask::begin(g_uart_baud, RADAR_RX, RADAR_TX);
   Serial.printf("[UART] RX2=%d TX2=%d @ %u 8N1\n", RADAR_RX, RADAR_TX, (unsigned)g_uart_baud);
-
-  if (g_applyAtBoot && g_det.valid && g_sens.valid) {
-    Serial.println("[BOOT] Applying stored radar config...");
-    bool ok = setDetSync(g_det) && setSensSync(g_sens);
-    Serial.printf("[BOOT] apply %s\n", ok?"OK":"FAIL");
-  }
+  RadarLink::begin(g_uart_baud, g_uartHi ? RadarLink::HIGH_BAUD : 0, linkReady);
 
   // Web routes
-  server.on("/",        HTTP_GET, [](){ server.send_P(200,"text/html",INDEX_HTML); });
-  server.on("/config",  HTTP_GET, [](){ server.send_P(200,"text/html",CONFIG_HTML); });
-
-  server.on("/api/passes", HTTP_GET, handlePasses);
-  server.on("/api/clear",  HTTP_GET, handleClear);
-  server.on("/csv",        HTTP_GET, handleCSV);
-  server.on("/api/options",HTTP_GET, [](){ if (server.hasArg("approach")||server.hasArg("minspd")||server.hasArg("debounce")) handleOptionsSet(); else handleOptionsGet(); });
-  server.on("/api/stats",  HTTP_GET, [](){
-    const int BIN_W=5, BIN_MAX=60, NB=(BIN_MAX/BIN_W)+1; int bins[NB]; for(int i=0;i<NB;i++) bins[i]=0; int dir_app=0, dir_away=0;
-    for (const auto& p: g_passes){ int b=p.speed_kmh/BIN_W; if (b>=NB) b=NB-1; bins[b]++; if (p.dir) dir_app++; else dir_away++; }
-    String j="{\"speed_bins\":[";
-    for(int i=0;i<NB;i++){ if(i) j+=','; int mi=i*BIN_W, ma=(i==NB-1)?999:(mi+BIN_W-1); j+="{\"min\":"+String(mi)+",\"max\":"+String(ma)+",\"count\":"+String(bins[i])+"}"; }
-    j+="],\"dir_counts\":{\"approach\":"+String(dir_app)+",\"away\":"+String(dir_away)+"}}"; server.send(200,"application/json",j);
-  });
+  route("/",        [](){ server.send_P(200,"text/html",INDEX_HTML); });
+  route("/config",  [](){ server.send_P(200,"text/html",CONFIG_HTML); });
+
+  route("/api/passes", handlePasses);
+  route("/api/last",   handleLast);
+  route("/api/clear",  handleClear);
+  route("/csv",        handleCSV);
+  route("/api/log",    handleLogInfo);
+  route("/api/options",[](){ if (hasOptionKey()) handleOptionsSet(); else handleOptionsGet(); });
+  route("/api/stats",  handleStats);
+  route("/api/speeds", handleSpeeds);
+  route("/api/zones",  handleZones);
 
   // config API
-  server.on("/api/cfg/get",    HTTP_GET, handleCfgGet);
-  server.on("/api/cfg/read",   HTTP_GET, handleCfgRead);
-  server.on("/api/cfg/set",    HTTP_GET, handleCfgSet);
-  server.on("/api/cfg/baud",   HTTP_GET, handleCfgBaud);
-  server.on("/api/cfg/preset", HTTP_GET, handleCfgPreset);
-  server.on("/api/cfg/ble",    HTTP_GET, handleCfgBle);
-  server.on("/api/reboot",     HTTP_GET, handleReboot);
-  server.on("/api/factory",    HTTP_GET, handleFactory);
+  route("/api/cfg/get",    handleCfgGet);
+  route("/api/cfg/read",   handleCfgRead);
+  route("/api/cfg/set",    handleCfgSet);
+  route("/api/cfg/baud",   handleCfgBaud);
+  route("/api/cfg/preset", handleCfgPreset);
+  route("/api/cfg/job",    handleCfgJob);
+  route("/api/cfg/ble",    handleCfgBle);
+  route("/api/reboot",     handleReboot);
+  route("/api/factory",    handleFactory);
 
   // diag
-  server.on("/api/diag/ping", HTTP_GET, handleDiagPing);
-  server.on("/api/mqtt/get", HTTP_GET, handleMqttGet);
-  server.on("/api/mqtt/set", HTTP_GET, handleMqttSet);
-  server.on("/api/power/get", HTTP_GET, handlePowerGet);
-  server.on("/api/power/set", HTTP_GET, handlePowerSet);
-  server.on("/api/power/diag", HTTP_GET, handlePowerDiag);
-  server.on("/api/mqtt/test", HTTP_GET, handleMqttTest);
-
-    server.on("/api/wifi/get", HTTP_GET, handleWifiGet);
-  server.on("/api/wifi/set", HTTP_GET, handleWifiSet);
-  g_mq = MqttCfg::load();
+  route("/api/diag/ping", handleDiagPing);
+  route("/api/mqtt/get", handleMqttGet);
+  route("/api/mqtt/set", handleMqttSet);
+  route("/api/power/get", handlePowerGet);
+  route("/api/power/set", handlePowerSet);
+  route("/api/power/diag", handlePowerDiag);
+  route("/api/metrics", handleMetrics);
+  route("/api/diag/radar", handleDiagRadar);
+  route("/api/mqtt/test", handleMqttTest);
+
+  route("/api/wifi/get", handleWifiGet);
+  route("/api/wifi/set", handleWifiSet);
+  g_mq = MqttCfg::load(); mqttTopicsBuild();
   g_pw = PowerCfg::load();
-  applyPowerPolicy();
-  g_mqtt.setBufferSize(1024);
+  powerBegin();
+  g_mqtt.setBufferSize(1536);   // lot JSON de 32 passages
   g_mqtt.setKeepAlive(30);
+  mqttLinkBegin();
   server.begin(); Serial.println("[WEB] http server started");
-  lastActiveMs = millis();
+  LivePush::begin(LIVE_PORT);
 }
 
 void loop() {
-  while (Serial2.available()){ uint8_t b=(uint8_t)Serial2.read(); rx.push_back(b); ST.bytes_rx++; if (rx.size()>4096) rx.erase(rx.begin(), rx.begin()+2048); }
-  while (tryParseOne()) {}
+  // Durée d'une itération = écart entre deux entrées dans loop()
+  static uint32_t loopT0 = 0; { const uint32_t t = micros(); if (loopT0) Metrics::observe(Metrics::LOOP, t - loopT0); loopT0 = t; }
+  serviceRadar();
   server.handleClient();
-  mqttEnsureConnected();
-  // ---- Mode 3: Wi‑Fi OFF when idle ----
-  bool allowSleep = g_pw.wifi_sleep && g_ld2451_ok;
-  if (g_pw.sleep_gpio >= 0){
-    pinMode(g_pw.sleep_gpio, INPUT_PULLUP);
-    int lvl = digitalRead(g_pw.sleep_gpio);
-    bool active = g_pw.sleep_gpio_active_high ? (lvl==HIGH) : (lvl==LOW);
-    if (active) allowSleep = false;   // permanent override
-  }
-  if (allowSleep && g_pw.sleep_mode == 3){
-    uint32_t nowMs = millis();
-    bool shouldBeOn = (nowMs - lastActiveMs) < WIFI_KEEP_ON_MS;
-    if (shouldBeOn) wifiEnsureOn();
-    else            wifiEnsureOff();
-  } else {
-    if (wifiOff) wifiEnsureOn();
-  }
-
-  
-  maybeDoLightSleep();
-static uint32_t _lastPol=0; uint32_t _now=millis(); if (_now-_lastPol>1000){ applyPowerPolicy(); _lastPol=_now; }
-  if (g_rebootPending && millis() >= g_rebootAt) { ESP.restart(); }
-  static uint32_t hb=0; if (millis()-hb>30000){ hb=millis(); Serial.printf("[HB] bytes=%lu data=%lu ack=%lu pass=%u baud=%u\n",
-    (unsigned long)ST.bytes_rx,(unsigned long)ST.frames_data,(unsigned long)ST.frames_ack,(unsigned)g_passes.size(),(unsigned)g_uart_baud); }
+  LivePush::service(); if (LivePush::clients()) bumpActivity();   // page ouverte = activité
+  mqttService(); mqttDrain();
+  if (g_mq.enabled && MqttOutbox::saveDue(millis())) outboxSave();
+  powerService();
+  if (g_rebootPending && millis() >= g_rebootAt) { PassLog::flush(); outboxSave(); seqHwmSave(g_passes.lastSeq()); ESP.restart(); }
+  logPoll();
+  static uint32_t ck=0; if (millis()-ck>=1000){ ck=millis(); if (Clock::poll()) clockFixup(); }
+  static uint32_t mt=0; if (g_metricsS && millis()-mt >= g_metricsS*1000UL){ mt=millis(); publishMetrics(); }
+  // Quantiles : bascule des fenêtres jour/heure, publication MQTT/SSE au plus 1x/min si nouveaux passages
+  static uint32_t sq=0; if (millis()-sq>60000){ sq=millis(); bool rolled=SpeedQ::tick(nowLocal()); if (rolled || SpeedQ::changes()!=g_speedsPubChg) publishSpeeds(); }
+  static uint32_t hb=0; if (millis()-hb>30000){ hb=millis(); auto st=RadarTask::stats(); auto rs=RadarTask::rxStats();
+    auto ts=Tracker::stats(); const MqttOutbox::Stats ob=MqttOutbox::stats(g_passes.lastSeq(), millis());
+    Serial.printf("[HB] bytes=%lu data=%lu ack=%lu pass=%u baud=%u ovf=%lu/%lu qdrop=%lu resync=%lu lat_max=%luus trk=%u/%lu short=%lu full=%lu mq=%lu@%u.%u/s loop_max=%luus fps=%u.%u\n",
+    (unsigned long)st.bytes_rx,(unsigned long)st.frames_data,(unsigned long)st.frames_ack,(unsigned)(g_passes.size() - g_holes),(unsigned)g_uart_baud,
+    (unsigned long)rs.overflow_drops,(unsigned long)st.hw_overflows,(unsigned long)st.queue_drops,(unsigned long)rs.resync_bytes,(unsigned long)st.lat_max_us,
+    (unsigned)Tracker::active(),(unsigned long)ts.opened,(unsigned long)ts.short_drops,(unsigned long)ts.full_drops,
+    (unsigned long)ob.depth,(unsigned)(ob.rate_x10/10),(unsigned)(ob.rate_x10%10),(unsigned long)Metrics::maxUs(Metrics::LOOP),(unsigned)(st.fps_x10/10),(unsigned)(st.fps_x10%10)); }
 }
 
 
 // ---------------- Wi‑Fi credentials API ------------------------
 void handleWifiGet(){
   bumpActivity(); auto c = WifiCfg::load();
-  String j = String("{\"ssid\":\"") + (c.ssid.length()?c.ssid:String("")) + "\"}";
-  server.send(200, "application/json", j);
+  char buf[96]; JsonOut j(buf, sizeof(buf));
+  j.obj().key("ssid").str(c.ssid.c_str()).end();
+  sendJSON(j);
 }
 void handleWifiSet(){
   bumpActivity(); String ssid = server.hasArg("ssid") ? server.arg("ssid") : "";
@@ -755,73 +1132,138 @@ void handleWifiSet(){
 
 // ---- MQTT test endpoint ----
 void handleMqttTest(){
-  bumpActivity(); mqttEnsureConnected();
-  // ---- Mode 3: Wi‑Fi OFF when idle ----
-  bool allowSleep = g_pw.wifi_sleep && g_ld2451_ok;
-  if (g_pw.sleep_gpio >= 0){
-    pinMode(g_pw.sleep_gpio, INPUT_PULLUP);
-    int lvl = digitalRead(g_pw.sleep_gpio);
-    bool active = g_pw.sleep_gpio_active_high ? (lvl==HIGH) : (lvl==LOW);
-    if (active) allowSleep = false;   // permanent override
+  bumpActivity();
+  if (!MqttLink::up()) {   // pas de connexion dans le handler HTTP : la tâche retente tout de suite
+    MqttLink::kick();
+    char m[64]; snprintf(m, sizeof(m), "MQTT not connected (state=%d), retry requested", MqttLink::stats().rc);
+    server.send(503, "text/plain", m); return;
   }
-  if (allowSleep && g_pw.sleep_mode == 3){
-    uint32_t nowMs = millis();
-    bool shouldBeOn = (nowMs - lastActiveMs) < WIFI_KEEP_ON_MS;
-    if (shouldBeOn) wifiEnsureOn();
-    else            wifiEnsureOff();
-  } else {
-    if (wifiOff) wifiEnsureOn();
-  }
-
-  publishStr(topic("status"), "online", true);
-  publishStr(topic("count"), String((unsigned)g_passes.size()), true);
-  String j = String("{\"ts\":\"")+fmtDate(nowLocal())+"\",\"dir\":1,\"speed_kmh\":42,\"dist_m\":12,\"angle\":5,\"snr\":9}";
-  publishJSON(topic("last"), j, true);
+  publishStr(g_mt.status, "online", true);
+  publishCount();
+  char dt[24], buf[128]; fmtDateBuf(dt, sizeof(dt), nowLocal());
+  JsonOut j(buf, sizeof(buf));
+  j.obj().key("ts").str(dt).key("dir").u(1).key("speed_kmh").u(42).key("dist_m").u(12).key("angle").i(5).key("snr").u(9).end();
+  publishJSON(g_mt.last, j, true);
   server.send(200, "text/plain", "MQTT test published");
 }
 
 
 
+// ---------------- Métriques (Prometheus) ---------------------
+// Valeurs ponctuelles relevées une fois par export (les deux passes MQTT voient les mêmes)
+// Au plus cap valeurs : au-delà, écartées (log au premier export) plutôt que hors du tableau
+static uint8_t metricValues(Metrics::Value* v, uint8_t cap){
+  const auto st = RadarTask::stats(); const MqttOutbox::Stats ob = MqttOutbox::stats(g_passes.lastSeq(), millis());
+  const MqttLink::Stats ls = MqttLink::stats();
+  uint8_t n = 0, lost = 0;
+  auto put = [&](const Metrics::Value& x){ if (n < cap) v[n++] = x; else lost++; };
+  put({ "uptime_seconds", "Temps depuis le boot", false, (uint32_t)(millis() / 1000) });
+  put({ "heap_free_bytes", "Tas libre", false, ESP.getFreeHeap() });
+  put({ "heap_min_free_bytes", "Tas libre minimal depuis le boot", false, ESP.getMinFreeHeap() });
+  put({ "heap_largest_free_block_bytes", "Plus grand bloc libre du tas", false, (uint32_t)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT) });
+  put({ "uart_rx_bytes_total", "Octets reçus du radar", true, st.bytes_rx });
+  put({ "frames_data_total", "Trames de données radar", true, st.frames_data });
+  put({ "frames_ack_total", "Trames ACK radar", true, st.frames_ack });
+  put({ "frame_queue_drops_total", "Trames perdues, file vers loop() pleine", true, st.queue_drops });
+  put({ "uart_hw_overflows_total", "Débordements du driver UART", true, st.hw_overflows });
+  const RadarRx::Stats rs = RadarTask::rxStats();
+  put({ "parser_resync_bytes_total", "Octets sautés pour retrouver un en-tête", true, rs.resync_bytes });
+  put({ "parser_bad_tail_total", "En-têtes rejetés : fin de trame invalide", true, rs.bad_tail });
+  put({ "parser_bad_len_total", "En-têtes rejetés : longueur hors limites", true, rs.bad_len });
+  put({ "parser_overflow_bytes_total", "Octets perdus, anneau d'ingestion plein", true, rs.overflow_drops });
+  put({ "parser_echo_frames_total", "Échos de nos commandes écartés", true, st.echo_drops });
+  put({ "frames_empty_total", "Trames de données sans cible", true, st.frames_empty });
+  put({ "targets_total", "Cibles reçues", true, st.targets });
+  put({ "targets_truncated_total", "Cibles au-delà de 16 par trame", true, st.truncated });
+  put({ "frame_rate", "Trames de données par seconde (fenêtre 5 s)", false, st.fps_x10, 1 });
+  put({ "passages_total", "Passages enregistrés (dernière séquence)", true, g_passes.lastSeq() });
+  put({ "tracks_active", "Pistes ouvertes", false, Tracker::active() });
+  put({ "log_pending_records", "Passages pas encore écrits en flash", false, PassLog::pending() });
+  put({ "mqtt_connected", "Session MQTT établie", false, MqttLink::up() ? 1u : 0u });
+  put({ "mqtt_connect_failures_total", "Échecs de connexion MQTT", true, ls.fails });
+  put({ "mqtt_outbox_depth", "Passages en attente de publication", false, ob.depth });
+  put({ "mqtt_sent_passages_total", "Passages publiés depuis le boot", true, ob.sent });
+  put({ "uart_baud", "Débit de la liaison radar", false, RadarLink::baud() });
+  put({ "radar_link_lost_total", "Pertes de liaison radar (octets sans trame valide)", true, RadarLink::stats().lost });
+  put({ "power_state", "État d'énergie (0 actif, 1 modem-sleep, 2 light-sleep, 3 radio coupée)", false, (uint32_t)PowerFsm::state() });
+  put({ "power_transitions_total", "Transitions d'état d'énergie", true, PowerFsm::stats(millis()).transitions });
+  put({ "clock_synced", "Horloge murale calée (NTP)", false, Clock::synced() ? 1u : 0u });
+  put({ "clock_steps_total", "Recalages du décalage horloge murale / monotone", true, Clock::steps() });
+  static bool warned = false;
+  if (lost && !warned) { warned = true; Serial.printf("[METRICS] %u value(s) over METRIC_VALUES=%u, dropped\n", (unsigned)lost, (unsigned)cap); }
+  return n;
+}
+static const uint8_t METRIC_VALUES = 31;   // capacité de v[] (metricValues() s'y arrête)
+void handleMetrics(){
+  Metrics::Value v[METRIC_VALUES]; const uint8_t n = metricValues(v, METRIC_VALUES);
+  char buf[1024];
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN); server.send(200, "text/plain; version=0.0.4", "");
+  Metrics::write(buf, sizeof(buf), httpSink, nullptr, v, n);
+  server.sendContent("", 0);
+}
+// Compteurs du parseur et de la tâche radar, latences du chemin trame -> passage
+void handleDiagRadar(){
+  const auto st = RadarTask::stats(); const RadarRx::Stats rs = RadarTask::rxStats();
+  char buf[1024]; JsonOut j(buf, sizeof(buf));
+  j.obj().key("ok").b(g_ld2451_ok).key("baud").u(g_uart_baud)
+   .key("last_frame_ms").u(st.last_frame_ms ? millis() - st.last_frame_ms : 0).key("fps").fix(st.fps_x10, 1)
+   .key("bytes").u(st.bytes_rx).key("frames").u(st.frames_data).key("acks").u(st.frames_ack).key("empty").u(st.frames_empty)
+   .key("targets").u(st.targets).key("truncated").u(st.truncated);
+  j.key("targets_per_frame").arr(); for (uint8_t i = 0; i < RadarTask::TGT_BINS; i++) j.u(st.tgt_hist[i]); j.end();
+  j.key("parser").obj().key("resync_bytes").u(rs.resync_bytes).key("bad_tail").u(rs.bad_tail).key("bad_len").u(rs.bad_len)
+   .key("overflow_bytes").u(rs.overflow_drops).key("echo").u(st.echo_drops).key("hw_overflows").u(st.hw_overflows).key("queue_drops").u(st.queue_drops).end();
+  j.key("latency_us").obj().key("frame_last").u(st.lat_last_us).key("frame_max").u(st.lat_max_us)
+   .key("close_max").u(Metrics::maxUs(Metrics::PASS_CLOSE)).key("flash_max").u(Metrics::maxUs(Metrics::PASS_FLASH)).key("mqtt_max").u(Metrics::maxUs(Metrics::PASS_MQTT)).end();
+  const RadarLink::Stats ls = RadarLink::stats();
+  j.key("link").obj().key("state").str(RadarLink::stateStr(ls.state)).key("baud").u(ls.baud).key("scans").u(ls.scans).key("probes").u(ls.probes)
+   .key("switches").u(ls.switches).key("reverts").u(ls.reverts).key("lost").u(ls.lost).key("scan_ms").u(ls.scan_ms).end();
+  j.key("trace").b(g_trace).key("debounce_ms").u(PASS_DEBOUNCE_MS).end();
+  sendJSON(j);
+}
+// Texte Prometheus sur base/metrics, en flux (beginPublish) : pas de tampon à sa taille
+static void mqttSink(void*, const char* p, size_t n){ g_mqtt.write((const uint8_t*)p, n); }
+static void publishMetrics(){
+  if (!MqttLink::up()) return;
+  Metrics::Value v[METRIC_VALUES]; const uint8_t n = metricValues(v, METRIC_VALUES);
+  const size_t len = Metrics::write(nullptr, 0, nullptr, nullptr, v, n);
+  const uint32_t t0 = micros();
+  if (!g_mqtt.beginPublish(g_mt.metrics, (unsigned)len, false)) return;
+  char buf[512]; Metrics::write(buf, sizeof(buf), mqttSink, nullptr, v, n);
+  if (!g_mqtt.endPublish()) Serial.printf("[MQTT] publish fail topic=%s len=%u\n", g_mt.metrics, (unsigned)len);
+  Metrics::observe(Metrics::MQTT_PUB, micros() - t0);
+}
+
 // ------------- Power diagnostics endpoint ------------------
 void handlePowerDiag(){
   bumpActivity(); wifi_ps_type_t ps = WIFI_PS_NONE;
   esp_wifi_get_ps(&ps);
 
-  int gpio_lvl = -1;
-  bool gpio_active = false;
-  if (g_pw.sleep_gpio >= 0) {
-    pinMode(g_pw.sleep_gpio, INPUT_PULLUP);
-    gpio_lvl = digitalRead(g_pw.sleep_gpio);
-    gpio_active = g_pw.sleep_gpio_active_high ? (gpio_lvl==HIGH) : (gpio_lvl==LOW);
-  }
-
-  String j = String("{\"cpu_cfg\":") + String((unsigned)g_pw.cpu_mhz) +
-             ",\"cpu_cur\":" + String((unsigned)getCpuFrequencyMhz()) +
-             ",\"mdns_cfg\":" + String(g_pw.mdns ? "true":"false") +
-             ",\"wifi_sleep_cfg\":" + String(g_pw.wifi_sleep ? "true":"false") +
-             ",\"wifi_sleep_rt\":" + String(WiFi.getSleep() ? "true":"false") +
-             ",\"wifi_ps\":" + String((int)ps) +
-             ",\"ld2451_ok\":" + String(g_ld2451_ok ? "true":"false") +
-             ",\"gpio\":" + String((int)g_pw.sleep_gpio) +
-             ",\"gpio_lvl\":" + String(gpio_lvl) +
-             ",\"gpio_active\":" + String(gpio_active ? "true":"false") +
-             "}";
-  server.send(200, "application/json", j);
+  const int gpio_lvl = g_pw.sleep_gpio >= 0 ? digitalRead(g_pw.sleep_gpio) : -1;
+  const PowerFsm::Stats pst = PowerFsm::stats(millis());
+  char buf[384]; JsonOut j(buf, sizeof(buf));
+  j.obj().key("cpu_cfg").u(g_pw.cpu_mhz).key("cpu_cur").u(getCpuFrequencyMhz()).key("mdns_cfg").b(g_pw.mdns).key("wifi_sleep_cfg").b(g_pw.wifi_sleep)
+   .key("wifi_sleep_rt").b(WiFi.getSleep()).key("wifi_ps").i((int)ps).key("ld2451_ok").b(g_ld2451_ok).key("gpio").i(g_pw.sleep_gpio)
+   .key("gpio_lvl").i(gpio_lvl).key("gpio_active").b(PowerFsm::overridden()).key("state").str(PowerFsm::name(PowerFsm::state()))
+   .key("transitions").u(pst.transitions).key("state_s").obj();
+  for (uint8_t i = 0; i < PowerFsm::STATES; i++) j.key(PowerFsm::name(PowerFsm::State(i))).u(pst.ms_in[i] / 1000);
+  j.end().end();
+  sendJSON(j);
 }
-
-
 // ---------------- MQTT API ----------------------------------
 void handleMqttGet(){
   bumpActivity(); // nécessite: #include "mqtt_cfg.h" et une variable globale MqttCfg::Settings g_mq
-  g_mq = MqttCfg::load();
-  String j = String("{\"enabled\":") + (g_mq.enabled ? "true" : "false") +
-             ",\"host\":\"" + g_mq.host + "\"" +
-             ",\"port\":" + String((unsigned)g_mq.port) +
-             ",\"user\":\"" + g_mq.user + "\"" +
-             ",\"base\":\"" + g_mq.base + "\"" +
-             ",\"discovery\":" + String(g_mq.discovery ? "true" : "false") +
-             "}";
-  server.send(200, "application/json", j);
+  g_mq = MqttCfg::load(); mqttTopicsBuild();
+  char buf[640]; JsonOut j(buf, sizeof(buf));
+  j.obj().key("enabled").b(g_mq.enabled).key("host").str(g_mq.host.c_str()).key("port").u(g_mq.port).key("user").str(g_mq.user.c_str())
+   .key("base").str(g_mq.base.c_str()).key("discovery").b(g_mq.discovery).key("connected").b(MqttLink::up());
+  static const char* const LINK_ST[] = { "off", "wait", "connecting", "up" };
+  const MqttLink::Stats ls = MqttLink::stats();
+  j.key("link").obj().key("state").str(LINK_ST[ls.state & 3]).key("attempts").u(ls.attempts).key("fails").u(ls.fails).key("connects").u(ls.connects)
+   .key("drops").u(ls.drops).key("rc").i(ls.rc).key("retry_ms").u(ls.retry_ms).key("last_ms").u(ls.last_ms).key("max_ms").u(ls.max_ms).end();
+  const MqttOutbox::Stats ob = MqttOutbox::stats(g_passes.lastSeq(), millis());
+  j.key("outbox").obj().key("depth").u(ob.depth).key("max_depth").u(ob.max_depth).key("acked").u(ob.acked).key("sent").u(ob.sent).key("msgs").u(ob.msgs).key("dropped").u(ob.dropped).key("replayed").u(g_mqReplayed)
+   .key("rate").fix(ob.rate_x10, 1).key("limit").u(ob.limit).key("window").u(ob.window).end().end();
+  sendJSON(j);
 }
 
 void handleMqttSet(){
@@ -842,15 +1284,11 @@ void handleMqttSet(){
 void handlePowerGet(){
   bumpActivity(); // nécessite: #include "power_cfg.h" et une variable globale PowerCfg::Settings g_pw
   g_pw = PowerCfg::load();
-  String j = String("{\"cpu_mhz\":") + String((unsigned)g_pw.cpu_mhz) +
-             ",\"mdns\":" + String(g_pw.mdns ? "true" : "false") +
-             ",\"wifi_sleep\":" + String(g_pw.wifi_sleep ? "true" : "false") +
-             ",\"sleep_gpio\":" + String((int)g_pw.sleep_gpio) +
-             ",\"sleep_gpio_ah\":" + String(g_pw.sleep_gpio_active_high ? "true" : "false") +
-             "}";
-  server.send(200, "application/json", j);
+  char buf[128]; JsonOut j(buf, sizeof(buf));
+  j.obj().key("cpu_mhz").u(g_pw.cpu_mhz).key("mdns").b(g_pw.mdns).key("wifi_sleep").b(g_pw.wifi_sleep).key("sleep_gpio").i(g_pw.sleep_gpio)
+   .key("sleep_gpio_ah").b(g_pw.sleep_gpio_active_high).end();
+  sendJSON(j);
 }
-
 void handlePowerSet(){
   bumpActivity(); PowerCfg::Settings s = PowerCfg::load();
   if (server.hasArg("cpu"))  s.cpu_mhz = (uint16_t) server.arg("cpu").toInt();           // 80/160/240
@@ -864,20 +1302,13 @@ void handlePowerSet(){
   if (ok) { g_rebootPending = true; g_rebootAt = millis() + 800; } // reboot auto
 }
 
-// Light-sleep par tranches quand "Mode de veille = Light sleep"
-static void maybeDoLightSleep(){
-  // Actif seulement si Sleep ON + mode=2 (Light) + radar OK + pas d’override GPIO
-  if (!(g_pw.wifi_sleep && g_pw.sleep_mode == 2)) return;
-  if (!g_ld2451_ok) return;
-  if (g_pw.sleep_gpio >= 0){
-    pinMode(g_pw.sleep_gpio, INPUT_PULLUP);
-    int lvl = digitalRead(g_pw.sleep_gpio);
-    bool active = g_pw.sleep_gpio_active_high ? (lvl==HIGH) : (lvl==LOW);
-    if (active) return; // override actif → pas de sleep
-  }
-
+// Light-sleep par tranches, tant que PowerFsm est en LIGHT_SLEEP (mode 2, sans activité récente) :
+// un front GPIO ou une cible est vu au plus une tranche plus tard
+static void lightSleepSlice(){
   // tranche ~150 ms (à ajuster si besoin)
   esp_sleep_enable_timer_wakeup(150000); // 150 ms
   Serial.flush();
+  const uint32_t t0 = micros();
   esp_light_sleep_start(); // réveil sur timer
+  Metrics::observe(Metrics::SLEEP, micros() - t0);
 }
\ No newline at end of file
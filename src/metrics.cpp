@@ -0,0 +1,87 @@
+#include "metrics.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+
+namespace Metrics {
+  // Seuils en µs, et leur écriture en secondes pour le label le
+  static const uint32_t LE_US[BUCKETS - 1] = { 100, 500, 1000, 5000, 10000, 50000, 100000, 500000, 1000000, 5000000 };
+  static const char* const LE_S[BUCKETS] = { "0.0001", "0.0005", "0.001", "0.005", "0.01", "0.05", "0.1", "0.5", "1", "5", "+Inf" };
+
+  struct H { uint32_t n[BUCKETS]; uint32_t count, max_us; uint64_t sum_us; };
+  static H s_h[HIST_COUNT];
+  static H s_r[MAX_ROUTES];
+  static const char* s_uri[MAX_ROUTES];
+  static uint8_t s_routes = 0;
+
+  static const char* const NAME[HIST_COUNT] = { "loop", "flash_write", "mqtt_publish", "light_sleep",
+    "frame_to_loop", "pass_close", "pass_to_flash", "pass_to_mqtt" };
+  static const char* const HELP[HIST_COUNT] = {
+    "Durée d'une itération de loop()", "Durée d'une écriture flash (journal, NVS)",
+    "Durée d'une publication MQTT", "Durée d'un light-sleep",
+    "Arrivée du 1er octet d'une trame -> traitement par loop()",
+    "Dernière trame d'une piste -> passage enregistré (inclut le silence de clôture)",
+    "Passage enregistré -> écrit en flash (trace)", "Passage enregistré -> publié en MQTT (trace)" };
+
+  static void add(H& h, uint32_t us){
+    uint8_t b = 0; while (b < BUCKETS - 1 && us > LE_US[b]) b++;
+    h.n[b]++; h.count++; h.sum_us += us; if (us > h.max_us) h.max_us = us;
+  }
+  void observe(Hist h, uint32_t us){ if (h < HIST_COUNT) add(s_h[h], us); }
+  void observeRoute(uint8_t id, uint32_t us){ if (id < s_routes) add(s_r[id], us); }
+  uint32_t maxUs(Hist h){ return h < HIST_COUNT ? s_h[h].max_us : 0; }
+  uint8_t route(const char* uri){
+    for (uint8_t i = 0; i < s_routes; i++) if (!strcmp(s_uri[i], uri)) return i;
+    if (s_routes >= MAX_ROUTES) return 0xFF;
+    s_uri[s_routes] = uri; return s_routes++;
+  }
+
+  // Tampon de ligne -> tampon de sortie -> sink ; sans sink, ne fait que compter
+  struct Out {
+    char* buf; size_t cap, len; Sink sink; void* ctx; size_t total;
+    void put(const char* p, size_t n){
+      total += n; if (!sink) return;
+      if (len + n > cap) { sink(ctx, buf, len); len = 0; }
+      if (n > cap) { sink(ctx, p, n); return; }
+      memcpy(buf + len, p, n); len += n;
+    }
+    void line(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+  };
+  void Out::line(const char* fmt, ...){
+    char l[256]; va_list ap; va_start(ap, fmt); int n = vsnprintf(l, sizeof(l), fmt, ap); va_end(ap);
+    if (n > 0) put(l, size_t(n) < sizeof(l) ? size_t(n) : sizeof(l) - 1);
+  }
+
+  // sum en secondes sans printf flottant
+  static void series(Out& o, const char* name, const char* label, const H& h){
+    const char* sep = label[0] ? "," : "";
+    uint32_t cum = 0;
+    for (uint8_t b = 0; b < BUCKETS; b++) { cum += h.n[b]; o.line("radar_%s_seconds_bucket{%s%sle=\"%s\"} %lu\n", name, label, sep, LE_S[b], (unsigned long)cum); }
+    const char* lb = label[0] ? "{" : ""; const char* le = label[0] ? "}" : "";
+    o.line("radar_%s_seconds_sum%s%s%s %lu.%06lu\n", name, lb, label, le, (unsigned long)(h.sum_us / 1000000), (unsigned long)(h.sum_us % 1000000));
+    o.line("radar_%s_seconds_count%s%s%s %lu\n", name, lb, label, le, (unsigned long)h.count);
+  }
+
+  size_t write(char* buf, size_t cap, Sink sink, void* ctx, const Value* vals, uint8_t n){
+    Out o = { buf, cap, 0, sink, ctx, 0 };
+    for (uint8_t i = 0; i < HIST_COUNT; i++) {
+      o.line("# HELP radar_%s_seconds %s\n# TYPE radar_%s_seconds histogram\n", NAME[i], HELP[i], NAME[i]);
+      series(o, NAME[i], "", s_h[i]);
+    }
+    o.line("# HELP radar_http_handler_seconds Durée d'un handler HTTP, par route\n# TYPE radar_http_handler_seconds histogram\n");
+    for (uint8_t i = 0; i < s_routes; i++) {
+      if (!s_r[i].count) continue;   // route jamais appelée : rien à exporter
+      char lbl[80]; snprintf(lbl, sizeof(lbl), "route=\"%s\"", s_uri[i]);
+      series(o, "http_handler", lbl, s_r[i]);
+    }
+    for (uint8_t i = 0; i < n; i++) {
+      const Value& v = vals[i];
+      o.line("# HELP radar_%s %s\n# TYPE radar_%s %s\n", v.name, v.help, v.name, v.counter ? "counter" : "gauge");
+      if (!v.dec) { o.line("radar_%s %lu\n", v.name, (unsigned long)v.v); continue; }
+      uint32_t p10 = 1; for (uint8_t d = 0; d < v.dec; d++) p10 *= 10;
+      o.line("radar_%s %lu.%0*lu\n", v.name, (unsigned long)(v.v / p10), int(v.dec), (unsigned long)(v.v % p10));
+    }
+    if (sink && o.len) sink(ctx, buf, o.len);
+    return o.total;
+  }
+}
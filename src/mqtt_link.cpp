@@ -0,0 +1,88 @@
+#include "mqtt_link.h"
+#include <WiFi.h>
+#include <freertos/task.h>
+#include "backoff.h"
+
+namespace MqttLink {
+  static const uint32_t    STACK       = 4096;
+  static const UBaseType_t TASK_PRIO   = 1;     // comme loop()
+  static const BaseType_t  TASK_CORE   = 0;     // PRO_CPU, avec la pile Wi-Fi : loop() garde APP_CPU
+  static const uint16_t    CONNACK_S   = 4;     // attente du CONNACK (PubSubClient : 15 s par défaut)
+
+  static PubSubClient* s_c = nullptr;
+  static Cfg  s_cfg;
+  static TaskHandle_t s_task = nullptr;
+  static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+  static volatile uint8_t s_state = OFF;
+  static volatile bool s_edge = false;          // connexion établie, pas encore vue par service()
+  static uint32_t s_nextTry = 0;
+  static Backoff  s_bo(RETRY_MIN_MS, RETRY_MAX_MS);
+  static Stats    s_st;
+
+  static void setState(uint8_t st, uint32_t retryIn){
+    portENTER_CRITICAL(&s_mux);
+    s_state = st; s_nextTry = millis() + retryIn;
+    portEXIT_CRITICAL(&s_mux);
+  }
+
+  static void attempt(){
+    const uint32_t t0 = millis(); s_st.attempts++;
+    s_c->setServer(s_cfg.host, s_cfg.port ? s_cfg.port : 1883);
+    Serial.printf("[MQTT] connect to %s:%u user=%s\n", s_cfg.host, (unsigned)(s_cfg.port ? s_cfg.port : 1883), s_cfg.user);
+    const bool auth = s_cfg.user[0] != 0;
+    const bool ok = s_c->connect(s_cfg.client, auth ? s_cfg.user : nullptr, auth ? s_cfg.pass : nullptr, s_cfg.will, 0, true, "offline");
+    s_st.last_ms = millis() - t0; if (s_st.last_ms > s_st.max_ms) s_st.max_ms = s_st.last_ms;
+    if (ok) { s_bo.reset(); s_st.connects++; s_edge = true; setState(UP, 0); return; }
+    s_st.fails++; s_st.rc = s_c->state();
+    const uint32_t wait = s_bo.next(esp_random());
+    Serial.printf("[MQTT] connect failed, state=%d (%lu ms), retry in %lu ms\n", s_st.rc, (unsigned long)s_st.last_ms, (unsigned long)wait);
+    setState(WAIT, wait);
+  }
+
+  static void task(void*){
+    for (;;){
+      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(250));   // réveil anticipé : kick()
+      if (s_state != WAIT || WiFi.status() != WL_CONNECTED) continue;
+      if ((int32_t)(millis() - s_nextTry) < 0) continue;
+      setState(CONNECTING, 0);
+      attempt();
+    }
+  }
+
+  bool begin(PubSubClient& c, const Cfg& cfg, bool enabled){
+    s_c = &c; s_cfg = cfg; memset(&s_st, 0, sizeof(s_st));
+    s_c->setSocketTimeout(CONNACK_S);
+    if (!enabled) return true;
+    s_state = WAIT;
+    return xTaskCreatePinnedToCore(task, "mqtt", STACK, nullptr, TASK_PRIO, &s_task, TASK_CORE) == pdPASS;
+  }
+
+  bool service(){
+    if (s_state != UP) return false;
+    if (!s_c->loop()) {   // session perdue : retour à la tâche, première reprise rapide
+      s_st.drops++;
+      Serial.printf("[MQTT] connection lost, state=%d\n", s_c->state());
+      setState(WAIT, s_bo.next(esp_random()));
+      return false;
+    }
+    if (!s_edge) return false;
+    s_edge = false; return true;
+  }
+
+  bool up(){ return s_state == UP; }
+
+  void kick(){
+    if (s_state != WAIT || !s_task) return;
+    portENTER_CRITICAL(&s_mux); s_nextTry = millis(); portEXIT_CRITICAL(&s_mux);
+    xTaskNotifyGive(s_task);
+  }
+
+  State state(){ return State(s_state); }
+
+  Stats stats(){
+    Stats s = s_st; s.state = s_state;
+    const int32_t r = (int32_t)(s_nextTry - millis());
+    s.retry_ms = (s_state == WAIT && r > 0) ? uint32_t(r) : 0;
+    return s;
+  }
+}
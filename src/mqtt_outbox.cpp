@@ -0,0 +1,68 @@
+#include "mqtt_outbox.h"
+
+namespace MqttOutbox {
+  static uint32_t s_acked = 0, s_saved = 0, s_savedMs = 0;
+  static uint32_t s_sent = 0, s_msgs = 0, s_dropped = 0, s_maxDepth = 0;
+  static uint16_t s_rate = DEFAULT_RATE;
+  static uint16_t s_window = 0; static uint8_t s_maxN = 1;
+  static bool     s_pend = false; static uint32_t s_pendMs = 0;   // début d'attente du lot courant
+  static uint32_t s_tokens = 0, s_tokMs = 0;                   // jetons en millièmes de message
+  static uint32_t s_winMs = 0, s_winSent = 0; static uint16_t s_rateX10 = 0;
+
+  void begin(uint32_t acked, uint32_t lastSeq){
+    s_acked = s_saved = (acked && acked <= lastSeq) ? acked : lastSeq;
+    s_tokens = uint32_t(s_rate) * 1000;
+  }
+  void     setRate(uint16_t perSec){ s_rate = perSec ? perSec : 1; if (s_tokens > uint32_t(s_rate) * 1000) s_tokens = uint32_t(s_rate) * 1000; }
+  uint16_t rate(){ return s_rate; }
+  void     setBatch(uint16_t windowS, uint8_t maxN){ s_window = windowS; s_maxN = windowS ? (maxN && maxN <= MAX_BATCH ? maxN : MAX_BATCH) : 1; }
+  uint16_t batchWindow(){ return s_window; }
+
+  static void roll(uint32_t nowMs){
+    if (nowMs - s_winMs < RATE_WIN_MS) return;
+    const uint32_t el = nowMs - s_winMs;
+    s_rateX10 = uint16_t(el < 2 * RATE_WIN_MS ? (s_winSent * 10000UL + el / 2) / el : 0);   // fenêtre sautée : rien envoyé
+    s_winMs = nowMs; s_winSent = 0;
+  }
+
+  uint8_t next(uint32_t firstSeq, uint32_t lastSeq, uint32_t nowMs, uint32_t& from){
+    if (s_acked > lastSeq) s_acked = lastSeq;                 // historique remis à zéro
+    if (s_acked + 1 < firstSeq) { s_dropped += firstSeq - 1 - s_acked; s_acked = firstSeq - 1; }
+    const uint32_t depth = lastSeq - s_acked;
+    if (depth > s_maxDepth) s_maxDepth = depth;
+    roll(nowMs);
+    if (!depth) { s_pend = false; return 0; }
+    if (!s_pend) { s_pend = true; s_pendMs = nowMs; }
+    const uint8_t n = depth < s_maxN ? uint8_t(depth) : s_maxN;
+    if (s_window && n < s_maxN && nowMs - s_pendMs < uint32_t(s_window) * 1000) return 0;
+    const uint32_t cap = uint32_t(s_rate) * 1000;
+    uint32_t el = nowMs - s_tokMs; if (el > 1000) el = 1000;   // rafale = 1 s ; borne avant produit (inactivité longue)
+    s_tokens += el * s_rate; if (s_tokens > cap) s_tokens = cap;
+    s_tokMs = nowMs;
+    if (s_tokens < 1000) return 0;
+    from = s_acked + 1;
+    return n;
+  }
+
+  void ack(uint32_t last, uint32_t nowMs){
+    if (last <= s_acked) return;
+    s_sent += last - s_acked; s_winSent += last - s_acked; s_msgs++;
+    s_acked = last; s_pend = false;          // le reste attend une nouvelle fenêtre
+    s_tokens = s_tokens >= 1000 ? s_tokens - 1000 : 0;
+    roll(nowMs);
+  }
+
+  uint32_t acked(){ return s_acked; }
+  void skipTo(uint32_t lastSeq){ s_acked = lastSeq; }
+  bool saveDue(uint32_t nowMs){ return s_acked != s_saved && nowMs - s_savedMs >= SAVE_MS; }
+  void markSaved(uint32_t nowMs){ s_saved = s_acked; s_savedMs = nowMs; }
+
+  Stats stats(uint32_t lastSeq, uint32_t nowMs){
+    roll(nowMs);
+    Stats s;
+    s.acked = s_acked; s.depth = lastSeq > s_acked ? lastSeq - s_acked : 0;
+    s.sent = s_sent; s.msgs = s_msgs; s.dropped = s_dropped; s.max_depth = s_maxDepth;
+    s.rate_x10 = s_rateX10; s.limit = s_rate; s.window = s_window;
+    return s;
+  }
+}
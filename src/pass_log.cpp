@@ -0,0 +1,325 @@
+#include "pass_log.h"
+#include "clock.h"
+#include <LittleFS.h>
+#include <algorithm>
+
+namespace PassLog {
+  static const char*    DIR_PATH    = "/plog";
+  static const char*    LEGACY_PATH = "/passes.bin";    // journal non segmenté (ancienne version)
+  static const uint32_t SEG_MAGIC   = 0x53504C44;       // "DLPS"
+  static const uint16_t SEG_VER     = 2;
+
+  struct __attribute__((packed)) SegHeader { uint32_t magic; uint16_t ver, recSize; uint32_t id, created; uint8_t rsv[8]; };
+  static_assert(sizeof(SegHeader) == sizeof(Record), "segment header must be one record long");
+
+  // Format v1 : en-tête de 16 o (les 16 premiers octets de SegHeader), enregistrements de 16 o
+  struct __attribute__((packed)) RecordV1 { uint32_t epoch, seq; uint8_t speed_kmh, dist_m; int8_t angle; uint8_t dir, snr, rsv; uint16_t crc; };
+  static const uint16_t V1_HDR = 16;
+
+  static Record   s_buf[BUF_RECS];
+  static uint8_t  s_n = 0;
+  static uint32_t s_firstMs = 0;     // âge du plus ancien enregistrement en attente
+  static SegInfo  s_seg[MAX_SEGS];
+  static uint8_t  s_nseg = 0;
+  static uint32_t s_budget = 512 * 1024;
+  static uint32_t s_nextId = 1;      // > tout id présent : les conversions v1 n'écrasent rien
+
+  static uint16_t crc16(const uint8_t* p, size_t n){
+    uint16_t c = 0xFFFF;
+    while (n--) { c ^= uint16_t(*p++) << 8; for (int i = 0; i < 8; i++) c = (c & 0x8000) ? (c << 1) ^ 0x1021 : (c << 1); }
+    return c;
+  }
+  static bool valid(const Record& r){ return r.crc == crc16((const uint8_t*)&r, sizeof(Record) - 2); }
+  static bool validV1(const RecordV1& r){ return r.crc == crc16((const uint8_t*)&r, sizeof(RecordV1) - 2); }
+  static void seal(Record& r){ r.crc = crc16((const uint8_t*)&r, sizeof(Record) - 2); }
+  // Horodatage en attente -> epoch si le boot d'origine a été calé depuis (copie lue, CRC non recalculé)
+  static void fix(Record& r){
+    if (!(r.ms & Passage::MS_PENDING)) return;
+    uint32_t s = r.epoch; uint16_t m = r.ms;
+    if (Clock::resolve(r.boot, s, m)) { r.epoch = s; r.ms = m; }
+  }
+  static Record fromV1(const RecordV1& o){
+    Record r; memset(&r, 0, sizeof(r));
+    r.epoch = o.epoch; r.seq = o.seq; r.speed_kmh = o.speed_kmh; r.dist_m = o.dist_m; r.angle = o.angle;
+    r.dir = o.dir; r.snr = o.snr; r.dist_out = o.dist_m; seal(r);
+    return r;
+  }
+
+  static int32_t dayOf(uint32_t epoch){ time_t t = (time_t)epoch; struct tm tm; localtime_r(&t, &tm); return int32_t(tm.tm_year) * 400 + tm.tm_yday; }
+  static void segPath(char* out, size_t n, uint32_t id){ snprintf(out, n, "%s/%08lu.bin", DIR_PATH, (unsigned long)id); }
+
+  // ---- Index : en-tête + premier/dernier enregistrement valide de chaque segment
+  enum Scan : uint8_t { SCAN_BAD, SCAN_OK, SCAN_V1 };
+  static Scan scanSeg(uint32_t id, SegInfo& si){
+    char path[32]; segPath(path, sizeof(path), id);
+    File f = LittleFS.open(path, FILE_READ); if (!f) return SCAN_BAD;
+    SegHeader h; si = SegInfo{ id, 0, 0, 0, (uint32_t)f.size(), 0 };
+    const size_t got = f.read((uint8_t*)&h, sizeof(h));
+    if (got >= V1_HDR && h.magic == SEG_MAGIC && h.ver == 1 && h.recSize == sizeof(RecordV1)) { f.close(); return SCAN_V1; }
+    if (got != sizeof(h) || h.magic != SEG_MAGIC || h.recSize != sizeof(Record)) { f.close(); return SCAN_BAD; }
+    const uint32_t nrec = (si.bytes - sizeof(h)) / sizeof(Record); si.count = nrec;
+    Record r;
+    for (uint32_t i = 0; i < nrec && i < 4; i++) { f.seek(sizeof(h) + i * sizeof(Record)); if (f.read((uint8_t*)&r, sizeof(r)) == sizeof(r) && valid(r)) { fix(r); si.first = r.epoch; break; } }
+    for (uint32_t i = 0; i < nrec && i < 4; i++) { f.seek(sizeof(h) + (nrec - 1 - i) * sizeof(Record)); if (f.read((uint8_t*)&r, sizeof(r)) == sizeof(r) && valid(r)) { fix(r); si.last = r.epoch; si.lastSeq = r.seq; break; } }
+    f.close();
+    si.day = dayOf(si.first ? si.first : h.created);
+    return SCAN_OK;
+  }
+
+  static void dropOldest(){
+    char path[32]; segPath(path, sizeof(path), s_seg[0].id);
+    LittleFS.remove(path);
+    Serial.printf("[LOG] evict segment %lu (%lu rec, budget %lu KB)\n", (unsigned long)s_seg[0].id, (unsigned long)s_seg[0].count, (unsigned long)(s_budget / 1024));
+    memmove(s_seg, s_seg + 1, sizeof(SegInfo) * --s_nseg);
+  }
+  static void evict(){ while (s_nseg > 1 && bytes() > s_budget) dropOldest(); }   // jamais le segment courant
+
+  static bool newSeg(uint32_t epoch){
+    if (s_nseg == MAX_SEGS) dropOldest();
+    SegInfo si{ s_nextId++, 0, 0, 0, sizeof(SegHeader), dayOf(epoch) };
+    SegHeader h{ SEG_MAGIC, SEG_VER, (uint16_t)sizeof(Record), si.id, epoch, {0} };
+    char path[32]; segPath(path, sizeof(path), si.id);
+    File f = LittleFS.open(path, FILE_WRITE);
+    if (!f) { Serial.printf("[LOG] cannot create %s\n", path); return false; }
+    f.write((const uint8_t*)&h, sizeof(h)); f.close();
+    s_seg[s_nseg++] = si;
+    return true;
+  }
+
+  // Écrit s_buf[a..b[ dans le segment courant (un open/write/close)
+  static bool writeRun(uint8_t a, uint8_t b){
+    SegInfo& si = s_seg[s_nseg - 1];
+    char path[32]; segPath(path, sizeof(path), si.id);
+    File f = LittleFS.open(path, FILE_APPEND);
+    if (!f) { Serial.printf("[LOG] cannot append %s\n", path); return false; }
+    // Écriture précédente interrompue : bourrage jusqu'à la frontière d'enregistrement (CRC faux -> ignoré)
+    size_t tail = f.size() % sizeof(Record);
+    if (tail) { static const uint8_t Z[sizeof(Record)] = {0}; f.write(Z, sizeof(Record) - tail); }
+    size_t want = sizeof(Record) * (b - a), w = f.write((const uint8_t*)(s_buf + a), want);
+    si.bytes = (uint32_t)f.size(); f.close();
+    if (w != want) { Serial.printf("[LOG] short write %u/%u\n", (unsigned)w, (unsigned)want); return false; }
+    if (!si.first) si.first = s_buf[a].epoch;
+    si.count = (si.bytes - sizeof(SegHeader)) / sizeof(Record); si.last = s_buf[b - 1].epoch; si.lastSeq = s_buf[b - 1].seq;
+    return true;
+  }
+
+  static void push(const Record& r){
+    if (s_n == BUF_RECS) flush();
+    if (s_n == BUF_RECS) { memmove(s_buf, s_buf + 1, sizeof(Record) * (BUF_RECS - 1)); s_n--; }   // flash KO : garder les plus récents
+    s_buf[s_n++] = r;
+    if (s_n == 1) s_firstMs = millis();
+    if (s_n == BUF_RECS) flush();
+  }
+
+  // Fichier v1 (segment ou /passes.bin) -> enregistrements v2 dans les segments courants, puis suppression
+  static void migrateV1(const char* path, size_t skip){
+    File f = LittleFS.open(path, FILE_READ); if (!f) return;
+    uint32_t n = 0; RecordV1 r;
+    f.seek(skip);
+    while (f.read((uint8_t*)&r, sizeof(r)) == sizeof(r)) if (validV1(r)) { push(fromV1(r)); n++; }
+    f.close(); flush();
+    LittleFS.remove(path);
+    Serial.printf("[LOG] migrated %lu v1 record(s) from %s\n", (unsigned long)n, path);
+  }
+
+  bool begin(uint32_t budgetBytes){
+    s_budget = budgetBytes; s_nseg = 0;
+    if (!LittleFS.exists(DIR_PATH)) LittleFS.mkdir(DIR_PATH);
+    uint32_t ids[MAX_SEGS]; uint8_t nid = 0;
+    File d = LittleFS.open(DIR_PATH);
+    if (d && d.isDirectory()) {
+      for (File e = d.openNextFile(); e; e = d.openNextFile()) {
+        const char* nm = strrchr(e.name(), '/'); nm = nm ? nm + 1 : e.name();
+        uint32_t id = strtoul(nm, nullptr, 10); e.close();
+        if (!id) continue;
+        if (nid < MAX_SEGS) ids[nid++] = id;
+        else { char path[32]; segPath(path, sizeof(path), id); LittleFS.remove(path); }
+      }
+      d.close();
+    }
+    std::sort(ids, ids + nid);
+    s_nextId = nid ? ids[nid - 1] + 1 : 1;
+    if (LittleFS.exists(LEGACY_PATH)) migrateV1(LEGACY_PATH, 0);
+    for (uint8_t i = 0; i < nid; i++) {
+      char path[32]; segPath(path, sizeof(path), ids[i]);
+      switch (scanSeg(ids[i], s_seg[s_nseg])) {
+        case SCAN_OK: s_nseg++; break;
+        case SCAN_V1: migrateV1(path, V1_HDR); break;
+        default:      LittleFS.remove(path); break;    // en-tête illisible
+      }
+    }
+    // Les segments convertis portent des id neufs : l'ordre des id est l'ordre chronologique
+    std::sort(s_seg, s_seg + s_nseg, [](const SegInfo& a, const SegInfo& b){ return a.id < b.id; });
+    evict();
+    Serial.printf("[LOG] %u segment(s), %lu record(s), %lu/%lu KB\n", (unsigned)s_nseg, (unsigned long)count(),
+                  (unsigned long)(bytes() / 1024), (unsigned long)(s_budget / 1024));
+    return true;
+  }
+
+  void append(uint32_t seq, const Passage& p){
+    Record r; memset(&r, 0, sizeof(r));
+    r.epoch = (uint32_t)p.ts; r.seq = seq; r.speed_kmh = p.speed_kmh; r.dist_m = p.dist_m; r.angle = p.angle;
+    r.dir = p.dir; r.snr = p.snr; r.dist_out = p.dist_out; r.dwell_ds = p.dwell_ds; r.speed_raw = p.speed_raw; r.zone = p.zone;
+    r.ms = p.ms; r.boot = Clock::boot(); seal(r);
+    push(r);
+  }
+
+  void poll(){ if (s_n && millis() - s_firstMs >= FLUSH_MS) flush(); }
+
+  // Découpe le tampon en séries contiguës par segment (changement de jour ou segment plein)
+  bool flush(){
+    uint8_t a = 0;
+    while (a < s_n) {
+      const int32_t day = dayOf(s_buf[a].epoch);
+      if (!s_nseg || s_seg[s_nseg - 1].day != day || s_seg[s_nseg - 1].bytes >= SEG_MAX_BYTES)
+        if (!newSeg(s_buf[a].epoch)) break;
+      const uint32_t used = s_seg[s_nseg - 1].bytes;
+      uint32_t room = used < SEG_MAX_BYTES ? (SEG_MAX_BYTES - used) / sizeof(Record) : 0; if (!room) room = 1;
+      uint8_t b = a + 1;
+      while (b < s_n && uint32_t(b - a) < room && dayOf(s_buf[b].epoch) == day) b++;
+      if (!writeRun(a, b)) break;
+      a = b;
+    }
+    if (a) { memmove(s_buf, s_buf + a, sizeof(Record) * (s_n - a)); s_n -= a; s_firstMs = millis(); evict(); }
+    return s_n == 0;
+  }
+
+  void clear(){
+    for (uint8_t i = 0; i < s_nseg; i++) { char path[32]; segPath(path, sizeof(path), s_seg[i].id); LittleFS.remove(path); }
+    s_nseg = 0; s_n = 0;
+  }
+
+  void setBudget(uint32_t b){ s_budget = b; evict(); }
+  uint32_t budget(){ return s_budget; }
+  uint32_t pending(){ return s_n; }
+  uint32_t count(){ uint32_t n = s_n; for (uint8_t i = 0; i < s_nseg; i++) n += s_seg[i].count; return n; }
+  uint32_t bytes(){ uint32_t n = 0; for (uint8_t i = 0; i < s_nseg; i++) n += s_seg[i].bytes; return n; }
+  uint8_t segments(const SegInfo** out){ *out = s_seg; return s_nseg; }
+
+  // Le tampon RAM est réécrit (pas encore en flash) ; les segments déjà écrits ne le sont pas,
+  // seul leur index est recalculé (fix() à la relecture)
+  void fixPending(){
+    for (uint8_t i = 0; i < s_n; i++) if (s_buf[i].ms & Passage::MS_PENDING) { fix(s_buf[i]); seal(s_buf[i]); }
+    for (uint8_t i = 0; i < s_nseg; i++) {
+      SegInfo& si = s_seg[i];
+      if (si.first >= uint32_t(Clock::MIN_VALID_EPOCH) && si.last >= uint32_t(Clock::MIN_VALID_EPOCH)) continue;
+      const int32_t day = si.day; scanSeg(si.id, si); si.day = day;   // jour d'écriture : flush() ne rouvre pas ce segment
+    }
+  }
+
+  uint32_t readTail(Record* out, uint32_t n, uint32_t deadlineMs){
+    uint32_t got = 0;
+    for (int i = s_n - 1; i >= 0 && got < n; i--) { out[n - 1 - got] = s_buf[i]; fix(out[n - 1 - got++]); }
+    Record blk[16];
+    for (int sgi = s_nseg - 1; sgi >= 0 && got < n; sgi--) {
+      char path[32]; segPath(path, sizeof(path), s_seg[sgi].id);
+      File f = LittleFS.open(path, FILE_READ); if (!f) continue;
+      uint32_t pos = s_seg[sgi].count;
+      while (pos && got < n && int32_t(millis() - deadlineMs) < 0) {
+        uint32_t k = pos < 16 ? pos : 16; pos -= k;
+        f.seek(sizeof(SegHeader) + pos * sizeof(Record));
+        k = f.read((uint8_t*)blk, k * sizeof(Record)) / sizeof(Record);
+        for (int j = int(k) - 1; j >= 0 && got < n; j--) if (valid(blk[j])) { fix(blk[j]); out[n - 1 - got++] = blk[j]; }
+      }
+      f.close();
+      if (int32_t(millis() - deadlineMs) >= 0) break;
+    }
+    if (got < n) memmove(out, out + (n - got), got * sizeof(Record));
+    return got;
+  }
+
+  Passage toPassage(const Record& r){
+    Passage p; p.ts = (time_t)r.epoch; p.angle = r.angle; p.dist_m = r.dist_m; p.speed_kmh = r.speed_kmh; p.dir = r.dir; p.snr = r.snr;
+    p.dist_out = r.dist_out; p.dwell_ds = r.dwell_ds; p.speed_raw = r.speed_raw ? r.speed_raw : r.speed_kmh; p.zone = r.zone; p.ms = r.ms;
+    return p;
+  }
+
+  uint32_t readFrom(uint32_t seq, Record* out, uint32_t n){
+    uint32_t got = 0; Record blk[16];
+    for (uint8_t sgi = 0; sgi < s_nseg && got < n; sgi++) {
+      const SegInfo& si = s_seg[sgi];
+      if (si.lastSeq && si.lastSeq < seq) continue;
+      char path[32]; segPath(path, sizeof(path), si.id);
+      File f = LittleFS.open(path, FILE_READ); if (!f) continue;
+      uint32_t lo = 0, hi = si.count; Record r;   // illisible : à gauche (relu puis écarté)
+      while (lo < hi) {
+        const uint32_t mid = (lo + hi) / 2;
+        f.seek(sizeof(SegHeader) + mid * sizeof(Record));
+        if (f.read((uint8_t*)&r, sizeof(r)) == sizeof(r) && valid(r) && r.seq < seq) lo = mid + 1; else hi = mid;
+      }
+      f.seek(sizeof(SegHeader) + lo * sizeof(Record));
+      uint32_t k;
+      while (got < n && (k = f.read((uint8_t*)blk, sizeof(blk)) / sizeof(Record)) != 0)
+        for (uint32_t j = 0; j < k && got < n; j++) if (valid(blk[j]) && blk[j].seq >= seq) { fix(blk[j]); out[got++] = blk[j]; }
+      f.close();
+    }
+    for (uint8_t i = 0; i < s_n && got < n; i++) if (s_buf[i].seq >= seq) { out[got] = s_buf[i]; fix(out[got++]); }
+    return got;
+  }
+
+  // ---- Reader : segments dans l'ordre, puis ce qui reste en RAM si le flush a échoué
+  bool Reader::open(uint32_t from, uint32_t to){
+    close(); bad_ = 0;
+    flush();                                   // un export voit tout ce qui est connu
+    from_ = from; to_ = to; first_ = true;
+    // Premier segment dont le dernier epoch >= from ; parcours linéaire (128 entrées au plus) :
+    // un segment d'un boot jamais calé (epochs depuis le boot) casse l'ordre de l'index
+    uint8_t lo = 0;
+    while (from && lo < s_nseg && s_seg[lo].last < from) lo++;
+    seg_ = lo; mem_ = 0; memEnd_ = s_n;
+    return true;
+  }
+
+  // Ouvre le segment seg_ ; pour le premier, saute par dichotomie au premier epoch >= from
+  bool Reader::openSeg(){
+    while (seg_ < s_nseg) {
+      const SegInfo& si = s_seg[seg_++];
+      if ((to_ && si.first > to_) || (from_ && si.last < from_)) continue;
+      char path[32]; segPath(path, sizeof(path), si.id);
+      f_ = LittleFS.open(path, FILE_READ); if (!f_) continue;
+      uint32_t lo = 0;
+      if (first_ && from_) {
+        uint32_t hi = si.count; Record r;
+        while (lo < hi) {
+          uint32_t mid = (lo + hi) / 2;
+          f_.seek(sizeof(SegHeader) + mid * sizeof(Record));
+          if (f_.read((uint8_t*)&r, sizeof(r)) == sizeof(r) && valid(r) && (fix(r), r.epoch < from_)) lo = mid + 1; else hi = mid;
+        }
+      }
+      first_ = false;
+      f_.seek(sizeof(SegHeader) + lo * sizeof(Record));
+      file_ = true; n_ = i_ = 0;
+      return true;
+    }
+    return false;
+  }
+
+  bool Reader::next(Record& r){
+    while (true) {
+      if (i_ < n_) {
+        r = blk_[i_++];
+        if (!valid(r)) { bad_++; continue; }
+        fix(r);
+        if ((from_ || to_) && (r.ms & Passage::MS_PENDING)) continue;   // boot jamais calé : hors bornes
+        if (from_ && r.epoch < from_) continue;
+        if (to_ && r.epoch > to_) { f_.close(); file_ = false; n_ = i_ = 0; continue; }   // segment suivant
+        return true;
+      }
+      if (file_) {
+        size_t got = f_.read((uint8_t*)blk_, sizeof(blk_));
+        n_ = uint8_t(got / sizeof(Record)); i_ = 0;
+        if (n_) continue;
+        f_.close(); file_ = false;
+      }
+      if (openSeg()) continue;
+      while (mem_ < memEnd_ && mem_ < s_n) {
+        r = s_buf[mem_++]; fix(r);
+        if (!from_ && !to_) return true;
+        if (!(r.ms & Passage::MS_PENDING) && (!from_ || r.epoch >= from_) && (!to_ || r.epoch <= to_)) return true;
+      }
+      return false;
+    }
+  }
+
+  void Reader::close(){ if (file_) f_.close(); file_ = false; n_ = i_ = 0; seg_ = s_nseg; }
+}
@@ -0,0 +1,37 @@
+#include "pass_pack.h"
+
+namespace PassPack {
+  static void put16(uint8_t* p, uint32_t v){ p[0] = uint8_t(v); p[1] = uint8_t(v >> 8); }
+  static void put32(uint8_t* p, uint32_t v){ put16(p, v); put16(p + 2, v >> 16); }
+  static uint16_t get16(const uint8_t* p){ return uint16_t(p[0] | (p[1] << 8)); }
+  static uint32_t get32(const uint8_t* p){ return get16(p) | (uint32_t(get16(p + 2)) << 16); }
+
+  size_t header(uint8_t* out, uint32_t seq0, uint32_t t0, uint8_t n, uint8_t flags){
+    out[0] = MAGIC; out[1] = VERSION; out[2] = n; out[3] = flags;
+    put32(out + 4, seq0); put32(out + 8, t0);
+    return HDR_SIZE;
+  }
+
+  size_t record(uint8_t* out, const Passage& p, uint32_t t0){
+    const uint32_t dt = uint32_t(p.ts) > t0 ? uint32_t(p.ts) - t0 : 0;
+    put16(out, dt > 0xFFFF ? 0xFFFF : dt); put16(out + 2, p.dwell_ds);
+    out[4] = p.speed_kmh; out[5] = p.speed_raw; out[6] = p.dist_m; out[7] = p.dist_out;
+    out[8] = uint8_t(p.angle); out[9] = p.snr; out[10] = uint8_t((p.dir ? 1 : 0) | ((p.zone & 7) << 1));
+    put16(out + 11, p.ms & Passage::MS_MASK);
+    return REC_SIZE;
+  }
+
+  bool decode(const uint8_t* in, size_t len, Header& h, Passage* out, uint8_t max){
+    if (len < HDR_SIZE || in[0] != MAGIC || in[1] != VERSION) return false;
+    h.n = in[2]; h.flags = in[3]; h.seq0 = get32(in + 4); h.t0 = get32(in + 8);
+    if (len != HDR_SIZE + size_t(h.n) * REC_SIZE) return false;
+    for (uint8_t i = 0; i < h.n && i < max; i++) {
+      const uint8_t* r = in + HDR_SIZE + size_t(i) * REC_SIZE; Passage& p = out[i];
+      p.ts = time_t(h.t0 + get16(r)); p.dwell_ds = get16(r + 2);
+      p.speed_kmh = r[4]; p.speed_raw = r[5]; p.dist_m = r[6]; p.dist_out = r[7];
+      p.angle = int8_t(r[8]); p.snr = r[9]; p.dir = r[10] & 1; p.zone = (r[10] >> 1) & 7;
+      p.ms = uint16_t(get16(r + 11) | ((h.flags & F_BOOT) ? Passage::MS_PENDING : 0));
+    }
+    return true;
+  }
+}
@@ -0,0 +1,83 @@
+#include "pass_stats.h"
+#include <string.h>
+
+namespace PassStats {
+  static uint32_t s_speed[256], s_raw[256];
+  static uint32_t s_hour[24], s_wday[7];
+  static uint32_t s_count = 0, s_app = 0;
+  static uint64_t s_sum = 0, s_sumRaw = 0;
+  static uint32_t s_zhist[Zones::MAX_ZONES][256], s_zcount[Zones::MAX_ZONES], s_zapp[Zones::MAX_ZONES];
+  static uint64_t s_zsum[Zones::MAX_ZONES];
+
+  static void zoneAdd(const Passage& p, int k){
+    if (!p.zone || p.zone > Zones::MAX_ZONES) return;
+    const uint8_t z = p.zone - 1;
+    if (k < 0 && (!s_zcount[z] || !s_zhist[z][p.speed_kmh])) return;
+    s_zhist[z][p.speed_kmh] += k; s_zcount[z] += k; s_zsum[z] += k * int64_t(p.speed_kmh); if (p.dir) s_zapp[z] += k;
+  }
+
+  static void slot(const Passage& p, int& hour, int& wday){
+    struct tm tm; time_t t = p.ts; localtime_r(&t, &tm);
+    hour = tm.tm_hour; wday = tm.tm_wday;
+  }
+
+  void add(const Passage& p){
+    int h, d; slot(p, h, d);
+    s_speed[p.speed_kmh]++; s_raw[p.speed_raw]++; s_hour[h]++; s_wday[d]++;
+    s_count++; s_sum += p.speed_kmh; s_sumRaw += p.speed_raw; if (p.dir) s_app++;
+    zoneAdd(p, 1);
+  }
+
+  void remove(const Passage& p){
+    if (!s_count || !s_speed[p.speed_kmh]) return;
+    int h, d; slot(p, h, d);
+    s_speed[p.speed_kmh]--; if (s_hour[h]) s_hour[h]--; if (s_wday[d]) s_wday[d]--;
+    if (s_raw[p.speed_raw]) { s_raw[p.speed_raw]--; s_sumRaw -= p.speed_raw; }
+    s_count--; s_sum -= p.speed_kmh; if (p.dir && s_app) s_app--;
+    zoneAdd(p, -1);
+  }
+
+  void reset(){
+    memset(s_speed, 0, sizeof(s_speed)); memset(s_raw, 0, sizeof(s_raw)); memset(s_hour, 0, sizeof(s_hour)); memset(s_wday, 0, sizeof(s_wday));
+    s_count = 0; s_app = 0; s_sum = 0; s_sumRaw = 0;
+    memset(s_zhist, 0, sizeof(s_zhist)); memset(s_zcount, 0, sizeof(s_zcount)); memset(s_zapp, 0, sizeof(s_zapp)); memset(s_zsum, 0, sizeof(s_zsum));
+  }
+
+  static void range(const uint32_t* hst, uint8_t& vmin, uint8_t& vmax){
+    int lo = 0;   while (lo < 255 && !hst[lo]) lo++;
+    int hi = 255; while (hi > 0 && !hst[hi]) hi--;
+    vmin = uint8_t(lo); vmax = uint8_t(hi);
+  }
+
+  Summary summary(){
+    Summary s; s.count = s_count; s.approach = s_app; s.away = s_count - s_app;
+    if (!s_count) return s;
+    range(s_speed, s.vmin, s.vmax); s.vmean = float(double(s_sum) / s_count);
+    range(s_raw, s.rmin, s.rmax);   s.rmean = float(double(s_sumRaw) / s_count);
+    return s;
+  }
+
+  // V85 : première classe où le cumul atteint 85 % des passages de la zone
+  ZoneSummary zone(uint8_t zi){
+    ZoneSummary s; if (!zi || zi > Zones::MAX_ZONES) return s;
+    const uint8_t z = zi - 1; const uint32_t* h = s_zhist[z];
+    s.count = s_zcount[z]; s.approach = s_zapp[z]; s.away = s.count - s.approach;
+    if (!s.count) return s;
+    range(h, s.vmin, s.vmax); s.vmean = float(double(s_zsum[z]) / s.count);
+    uint32_t acc = h[0]; const uint32_t rank = (s.count * 85 + 99) / 100; int v = 0;
+    while (v < 255 && acc < rank) acc += h[++v];
+    s.v85 = uint8_t(v);
+    return s;
+  }
+
+  uint8_t bins(uint8_t w, uint8_t maxKmh, uint32_t* out, uint8_t cap){
+    if (!w) w = 1;
+    uint8_t nb = uint8_t(maxKmh / w + 1); if (nb > cap) nb = cap;
+    memset(out, 0, nb * sizeof(uint32_t));
+    for (int v = 0; v < 256; v++){ int b = v / w; if (b >= nb) b = nb - 1; out[b] += s_speed[v]; }
+    return nb;
+  }
+
+  const uint32_t* hours(){ return s_hour; }
+  const uint32_t* weekdays(){ return s_wday; }
+}
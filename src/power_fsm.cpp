@@ -0,0 +1,58 @@
+#include "power_fsm.h"
+
+namespace PowerFsm {
+  static Cfg      s_cfg = { false, 1 };
+  static State    s_state = ACTIVE;
+  static bool     s_radarOk = false, s_ovr = false;
+  static bool     s_dirty = true;                    // entrée modifiée : réévaluer au prochain poll()
+  static bool     s_hasDl = false; static uint32_t s_dl = 0;   // prochaine échéance
+  static uint32_t s_user = 0, s_radar = 0;           // dernières activités
+  static uint32_t s_since = 0;                       // entrée dans l'état courant
+  static Stats    s_st = {};
+
+  void begin(const Cfg& c, uint32_t now){ s_cfg = c; s_state = ACTIVE; s_user = s_radar = s_since = now; s_dirty = true; s_hasDl = false; s_st = Stats(); }
+  void setCfg(const Cfg& c){ s_cfg = c; s_dirty = true; }
+  void setRadarOk(bool ok){ if (ok != s_radarOk) { s_radarOk = ok; s_dirty = true; } }
+  void setOverride(bool on){ if (on != s_ovr) { s_ovr = on; s_dirty = true; } }
+
+  // Seul un état de veille profonde est quitté par l'activité ; en ACTIVE, l'échéance en cours
+  // est simplement repoussée à sa réévaluation
+  void activity(Src s, uint32_t now){
+    if (s == USER) s_user = now; else s_radar = now;
+    if (s_state == LIGHT_SLEEP || (s_state == RADIO_OFF && s == USER)) s_dirty = true;
+  }
+
+  static State eval(uint32_t now){
+    s_hasDl = false;
+    if (!s_cfg.sleep || !s_radarOk || s_ovr) return ACTIVE;
+    switch (s_cfg.mode) {
+      case 1: return MODEM_SLEEP;
+      case 2: {
+        const uint32_t last = int32_t(s_radar - s_user) > 0 ? s_radar : s_user;
+        if (now - last >= LIGHT_IDLE_MS) return LIGHT_SLEEP;
+        s_hasDl = true; s_dl = last + LIGHT_IDLE_MS; return ACTIVE;
+      }
+      case 3:
+        if (now - s_user >= RADIO_KEEP_MS) return RADIO_OFF;
+        s_hasDl = true; s_dl = s_user + RADIO_KEEP_MS; return ACTIVE;
+      default: return ACTIVE;
+    }
+  }
+
+  bool poll(uint32_t now, State& from, State& to){
+    if (!s_dirty && (!s_hasDl || int32_t(now - s_dl) < 0)) return false;
+    s_dirty = false; s_st.evals++;
+    const State n = eval(now);
+    if (n == s_state) return false;
+    s_st.ms_in[s_state] += now - s_since; s_since = now; s_st.transitions++;
+    from = s_state; to = s_state = n;
+    return true;
+  }
+
+  State state(){ return s_state; }
+  bool  overridden(){ return s_ovr; }
+  Stats stats(uint32_t now){ Stats s = s_st; s.ms_in[s_state] += now - s_since; return s; }
+  const char* name(State s){
+    switch (s){ case ACTIVE: return "active"; case MODEM_SLEEP: return "modem_sleep"; case LIGHT_SLEEP: return "light_sleep"; case RADIO_OFF: return "radio_off"; default: return "?"; }
+  }
+}
@@ -0,0 +1,140 @@
+#include "radar_cmd.h"
+#include "radar_task.h"
+
+namespace RadarCmd {
+  static const uint16_t ENABLE_TIMEOUT_MS = 800;
+  static const uint16_t END_TIMEOUT_MS    = 800;
+
+  static Job      s_jobs[HISTORY];        // slot = id % HISTORY
+  static uint32_t s_nextId = 1;           // prochain id attribué
+  static uint32_t s_head   = 1;           // prochain job à dérouler (ordre FIFO)
+
+  static Job& slot(uint32_t id){ return s_jobs[id % HISTORY]; }
+
+  const StepResult* Job::result(uint16_t c) const {
+    for (uint8_t i = 0; i < n; i++) if (steps[i].cmd == c && res[i].acked) return &res[i];
+    return nullptr;
+  }
+
+  Step step(uint16_t cmd, const uint8_t* v, uint8_t n, uint16_t timeout_ms){
+    Step s; s.cmd = cmd; s.n = n > 4 ? 4 : n; s.timeout_ms = timeout_ms;
+    memset(s.v, 0, sizeof(s.v)); if (v && s.n) memcpy(s.v, v, s.n);
+    return s;
+  }
+
+  void send(uint16_t cmd, const uint8_t* payload, uint16_t plen){
+    // Spéc LD2451 : HDR + LEN(2+N) + CMD(2 LE) + VALUE(N) + TAIL ; LEN n'inclut pas le tail
+    uint8_t f[4 + 2 + 2 + CMD_MAX_LEN + 4]; size_t k = 0;
+    if (plen > CMD_MAX_LEN - 2) plen = CMD_MAX_LEN - 2;
+    uint16_t dataLen = uint16_t(2 + plen);
+    memcpy(f + k, CMD_HDR, 4); k += 4;
+    f[k++] = uint8_t(dataLen & 0xFF); f[k++] = uint8_t(dataLen >> 8);
+    f[k++] = uint8_t(cmd & 0xFF);     f[k++] = uint8_t(cmd >> 8);
+    if (payload && plen) { memcpy(f + k, payload, plen); k += plen; }
+    memcpy(f + k, CMD_TAIL, 4); k += 4;
+    char hex[sizeof(f) * 3 + 1]; size_t h = 0;
+    for (size_t i = 0; i < k; i++) h += snprintf(hex + h, sizeof(hex) - h, i ? " %02X" : "%02X", f[i]);
+    Serial.printf("[TX CMD] 0x%04X payload=%u raw:%s\n", cmd, plen, hex);
+    RadarTask::write(f, k);
+  }
+
+  uint32_t submit(const char* name, std::initializer_list<Step> steps, Callback cb, bool wrapCfg){
+    return submit(name, steps.begin(), (uint8_t)steps.size(), cb, wrapCfg);
+  }
+
+  uint32_t submit(const char* name, const Step* steps, uint8_t n, Callback cb, bool wrapCfg){
+    if (n > MAX_STEPS) return 0;
+    uint32_t id = s_nextId;
+    Job& j = slot(id);
+    if (j.id && (j.state == QUEUED || j.state == RUNNING)) { Serial.printf("[CMD] queue full, '%s' rejected\n", name); return 0; }
+    j = Job();
+    j.id = id; j.name = name; j.state = QUEUED; j.wrap = wrapCfg; j.cb = cb; j.t_submit = millis();
+    if (wrapCfg) j.steps[j.n++] = step(CMD_ENABLE_CFG, nullptr, 0, ENABLE_TIMEOUT_MS);
+    for (uint8_t i = 0; i < n; i++) j.steps[j.n++] = steps[i];
+    if (wrapCfg) { uint8_t v[2] = {0x01, 0x00}; j.steps[j.n++] = step(CMD_END_CFG, v, 2, END_TIMEOUT_MS); }
+    memset(j.res, 0, sizeof(j.res));
+    s_nextId++;
+    return id;
+  }
+
+  bool setHook(uint32_t id, StepHook hook){
+    Job& j = slot(id);
+    if (j.id != id || j.state != QUEUED) return false;
+    j.hook = hook; return true;
+  }
+
+  bool insertBeforeEnd(Job& j, const Step& s){
+    if (!j.wrap || j.n >= MAX_STEPS + 2) return false;
+    j.steps[j.n] = j.steps[j.n - 1]; j.res[j.n] = j.res[j.n - 1];
+    j.steps[j.n - 1] = s; memset(&j.res[j.n - 1], 0, sizeof(StepResult));
+    j.n++;
+    return true;
+  }
+
+  static void finish(Job& j, bool skipped = false){
+    // Succès : toutes les commandes utiles acquittées avec status 0 (END ignoré, comme avant)
+    bool ok = true;
+    for (uint8_t i = 0; i < j.n && !skipped; i++){
+      if (j.wrap && i == j.n - 1) break;
+      if (!j.res[i].acked || j.res[i].status != 0) { ok = false; break; }
+    }
+    j.state = ok ? DONE : FAILED; j.t_end = millis();
+    Serial.printf("[CMD] job %lu '%s' %s in %lu ms\n", (unsigned long)j.id, j.name, ok ? "OK" : "FAIL", (unsigned long)(j.t_end - j.t_start));
+    s_head++;
+    Callback cb; cb.swap(j.cb);
+    if (cb) cb(j);
+  }
+
+  // Étape suivante ; sur échec d'une commande, on saute directement à END_CFG.
+  static void advance(Job& j, bool stepOk){
+    bool inCfg = j.wrap && j.cur > 0;
+    if (!stepOk && (!j.wrap || j.cur == 0)) { finish(j); return; }      // ENABLE refusé : rien à refermer
+    if (!stepOk && inCfg && j.cur < j.n - 1) j.cur = j.n - 1;           // -> END
+    else j.cur++;
+    j.sent = false;
+    if (j.cur >= j.n) finish(j);
+  }
+
+  void onAck(uint16_t ackCmd, uint16_t status, const uint8_t* data, uint8_t n){
+    if (s_head >= s_nextId) return;
+    Job& j = slot(s_head);
+    if (j.state != RUNNING || !j.sent) return;
+    const Step& s = j.steps[j.cur];
+    if (ackCmd != (s.cmd | 0x0100)) return;   // ACK périmé, ou écho brut de notre commande (bouclage) : ignoré
+    StepResult& r = j.res[j.cur];
+    r.acked = true; r.status = status; r.n = n > RET_MAX ? RET_MAX : n; memcpy(r.data, data, r.n);
+    if (j.hook && status == 0) j.hook(j, j.cur);
+    advance(j, status == 0);
+  }
+
+  void poll(){
+    if (s_head >= s_nextId) return;
+    Job& j = slot(s_head);
+    if (j.state == QUEUED) {
+      j.state = RUNNING; j.cur = 0; j.sent = false; j.t_start = millis();
+      // Rien à envoyer (ENABLE/END seuls, sans hook) : pas de session radar inutile
+      if (j.wrap && j.n == 2 && !j.hook) { finish(j, true); return; }
+    }
+    if (j.state != RUNNING) return;
+    if (!j.sent) {
+      const Step& s = j.steps[j.cur];
+      send(s.cmd, s.n ? s.v : nullptr, s.n);
+      j.sent = true; j.t_sent = millis();
+      return;
+    }
+    if (millis() - j.t_sent > j.steps[j.cur].timeout_ms) {
+      Serial.printf("[CMD] job %lu: timeout on 0x%04X\n", (unsigned long)j.id, j.steps[j.cur].cmd);
+      advance(j, false);
+    }
+  }
+
+  const Job* find(uint32_t id){
+    if (!id) return nullptr;
+    const Job& j = slot(id);
+    return j.id == id ? &j : nullptr;
+  }
+  bool idle(){ return s_head >= s_nextId; }
+  const char* stateStr(State s){
+    switch (s){ case QUEUED: return "queued"; case RUNNING: return "running"; case DONE: return "done"; default: return "failed"; }
+  }
+}
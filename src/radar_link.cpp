@@ -0,0 +1,151 @@
+#include "radar_link.h"
+#include "radar_cmd.h"
+#include "radar_task.h"
+#include "backoff.h"
+#include <esp_system.h>
+
+namespace RadarLink {
+  static const uint32_t RATES[9] = { 0, 9600, 19200, 38400, 57600, 115200, 230400, 256000, 460800 };   // index CMD_SET_BAUD
+  static const uint8_t  ORDER[8] = { 5, 7, 8, 6, 4, 3, 2, 1 };   // après le dernier connu : les plus courants d'abord
+  static const uint16_t PROBE_TIMEOUT_MS = 300;                  // READ_VERSION (ENABLE : délai de RadarCmd)
+
+  static State    s_state = IDLE;
+  static ReadyFn  s_ready;
+  static bool     s_have = false;                 // un débit a été vérifié depuis le boot
+  static uint32_t s_want = 0, s_last = 115200;    // débit visé / dernier débit vérifié
+  static uint8_t  s_try[8], s_ntry = 0, s_pi = 0; // candidats de l'autobaud en cours
+  static uint32_t s_jobId = 0; static uint8_t s_res = 0;   // job en cours : 0 en attente, 1 OK, 2 échec
+  static uint32_t s_from = 0, s_to = 0; static bool s_revert = false;
+  static uint8_t  s_okN = 0, s_verN = 0;
+  static uint32_t s_t0 = 0, s_waitMs = 0, s_scanT0 = 0;
+  static uint32_t s_rxSeen = 0, s_rxMs = 0, s_okMs = 0;
+  static Backoff  s_bo(RETRY_MIN_MS, RETRY_MAX_MS);
+  static Stats    s_st = {};
+
+  uint32_t idxToBaud(int idx){ return idx >= 1 && idx <= 8 ? RATES[idx] : 115200; }
+  int baudToIdx(uint32_t b){ for (int i = 1; i <= 8; i++) if (RATES[i] == b) return i; return 5; }
+  static bool known(uint32_t b){ for (int i = 1; i <= 8; i++) if (RATES[i] == b) return true; return false; }
+
+  static void setState(State s, uint32_t waitMs = 0){ s_state = s; s_t0 = millis(); s_waitMs = waitMs; }
+  static void onJob(const RadarCmd::Job& j){ if (j.id == s_jobId) s_res = j.ok() ? 1 : 2; }   // job d'un cycle abandonné : ignoré
+
+  // Poignée de main au débit courant : ENABLE_CFG + READ_VERSION (+ END)
+  static void probe(){
+    s_res = 0; s_st.probes++;
+    s_jobId = RadarCmd::submit("probe", { RadarCmd::step(CMD_READ_VERSION, nullptr, 0, PROBE_TIMEOUT_MS) }, onJob);
+  }
+  static void tryRate(){ RadarTask::setBaud(RATES[s_try[s_pi]]); setState(PROBE); probe(); }
+
+  static void startScan(){
+    s_ntry = s_pi = 0;
+    const uint8_t first = uint8_t(baudToIdx(s_last));
+    s_try[s_ntry++] = first;
+    for (uint8_t i = 0; i < sizeof(ORDER); i++) if (ORDER[i] != first) s_try[s_ntry++] = ORDER[i];
+    s_st.scans++; s_scanT0 = millis();
+    tryRate();
+  }
+
+  static void adopt(uint32_t b, const char* why){
+    s_last = b; s_have = true; s_okMs = millis(); s_bo.reset(); setState(IDLE);
+    Serial.printf("[LINK] %lu baud (%s)\n", (unsigned long)b, why);
+    if (s_ready) s_ready(b);
+  }
+
+  // SET_BAUD + REBOOT au débit courant ; la suite (attente, vérification) dans poll()
+  static uint32_t startSwitch(uint32_t to, bool revert){
+    const uint8_t v[2] = { uint8_t(baudToIdx(to)), 0 };
+    const uint32_t id = RadarCmd::submit("baud", { RadarCmd::step(CMD_SET_BAUD, v, 2, 2000), RadarCmd::step(CMD_REBOOT, nullptr, 0, 1000) }, onJob);
+    if (!id) return 0;
+    s_from = RadarTask::baud(); s_to = to; s_revert = revert; s_res = 0; s_jobId = id;
+    setState(SWITCH);
+    Serial.printf("[LINK] %s %lu -> %lu baud\n", revert ? "revert" : "switch", (unsigned long)s_from, (unsigned long)to);
+    return id;
+  }
+
+  void begin(uint32_t last, uint32_t want, ReadyFn onReady){
+    s_last = known(last) ? last : 115200; s_want = known(want) ? want : 0; s_ready = onReady;
+    startScan();
+  }
+
+  uint32_t switchTo(uint32_t b){
+    if (!known(b) || (s_state != IDLE && s_state != LOST)) return 0;
+    return startSwitch(b, false);
+  }
+
+  void setWant(uint32_t b){
+    s_want = known(b) ? b : 0;
+    if (s_want && s_state == IDLE && s_have && s_want != s_last) startSwitch(s_want, false);
+  }
+
+  void rescan(uint32_t delayMs){ s_jobId = 0; setState(LOST, delayMs); }
+
+  // Perte : des octets arrivent mais aucune trame valide depuis LOST_MS (radar à un autre débit).
+  // Radar muet : rien à conclure, pas de balayage.
+  static void watch(uint32_t now){
+    if (now - s_t0 < 1000) return;
+    s_t0 = now;
+    const RadarTask::Stats st = RadarTask::stats();
+    if (st.bytes_rx != s_rxSeen) { s_rxSeen = st.bytes_rx; s_rxMs = now; }
+    const uint32_t lastOk = (st.last_frame_ms && int32_t(st.last_frame_ms - s_okMs) > 0) ? st.last_frame_ms : s_okMs;
+    if (now - lastOk < LOST_MS || now - s_rxMs > 2000) return;
+    s_st.lost++;
+    Serial.printf("[LINK] bytes but no valid frame for %lu s at %lu baud, rescanning\n", (unsigned long)((now - lastOk) / 1000), (unsigned long)RadarTask::baud());
+    startScan();
+  }
+
+  void poll(){
+    const uint32_t now = millis();
+    switch (s_state) {
+      case IDLE:  if (s_have) watch(now); return;
+      case LOST:  if (now - s_t0 >= s_waitMs) startScan(); return;
+      case REBOOT_WAIT:
+        if (now - s_t0 < s_waitMs) return;
+        RadarTask::setBaud(s_to); s_okN = s_verN = 0; setState(VERIFY); probe();
+        return;
+      default: break;
+    }
+    if (!s_jobId) { if (s_state != SWITCH) probe(); return; }   // file RadarCmd pleine : on réessaie
+    if (!s_res) return;
+    const bool ok = s_res == 1; s_res = 0; s_jobId = 0;
+    switch (s_state) {
+      case PROBE:
+        if (ok) {
+          s_st.scan_ms = now - s_scanT0; adopt(RadarTask::baud(), "autobaud");
+          if (s_want && s_want != s_last) startSwitch(s_want, false);
+          return;
+        }
+        if (++s_pi < s_ntry) { tryRate(); return; }
+        RadarTask::setBaud(s_last);
+        { const uint32_t w = s_bo.next(esp_random());
+          Serial.printf("[LINK] no answer at any rate, retry in %lu ms\n", (unsigned long)w);
+          setState(LOST, w); }
+        return;
+      case SWITCH:
+        if (ok) { setState(REBOOT_WAIT, REBOOT_MS); return; }
+        Serial.println("[LINK] baud switch not acknowledged, rescanning");
+        startScan();
+        return;
+      case VERIFY:
+        s_verN++; if (ok) s_okN++;
+        if (s_verN < VERIFY_N) { probe(); return; }
+        if (s_okN == VERIFY_N) {
+          if (s_revert) s_st.reverts++; else s_st.switches++;
+          adopt(s_to, s_revert ? "reverted" : "switched");
+          return;
+        }
+        Serial.printf("[LINK] %lu baud: %u/%u handshakes\n", (unsigned long)s_to, (unsigned)s_okN, (unsigned)VERIFY_N);
+        if (s_okN && !s_revert) { s_want = 0; if (startSwitch(s_from, true)) return; }   // liaison partielle : on revient
+        startScan();
+        return;
+      default: return;
+    }
+  }
+
+  bool     ready(){ return s_have && s_state == IDLE; }
+  uint32_t baud(){ return RadarTask::baud(); }
+  Stats stats(){ Stats s = s_st; s.state = s_state; s.baud = RadarTask::baud(); return s; }
+  const char* stateStr(uint8_t s){
+    switch (s){ case IDLE: return "ok"; case PROBE: return "probe"; case SWITCH: return "switch"; case REBOOT_WAIT: return "reboot_wait";
+                case VERIFY: return "verify"; default: return "lost"; }
+  }
+}
@@ -0,0 +1,178 @@
+#include "radar_task.h"
+#include <driver/uart.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include <esp_timer.h>
+
+namespace RadarTask {
+  static const uart_port_t PORT   = UART_NUM_2;
+  static const int  DRV_RX_BUF    = 4096;   // tampon logiciel du driver (FIFO HW = 128 o)
+  static const int  EVT_Q_LEN     = 20;
+  static const UBaseType_t FRAME_Q_LEN = 64;   // ~6 s de trames à 10 Hz pendant un blocage de loop()
+  static const UBaseType_t ACK_Q_LEN   = 4;
+  static const BaseType_t  TASK_CORE   = 1;    // APP_CPU : la pile Wi-Fi tourne sur PRO_CPU
+  static const UBaseType_t TASK_PRIO   = 10;   // au-dessus de loop() (prio 1)
+  static const uint8_t RX_TOUT_SYMBOLS = 3;    // événement UART_DATA dès ~3 octets de silence (fin de trame)
+
+  static QueueHandle_t s_uartQ = nullptr, s_frameQ = nullptr, s_ackQ = nullptr;
+  static TaskHandle_t  s_task = nullptr;
+  static RadarRx::Ring<4096> s_ring;
+  static Stats    s_st;                           // écrit par la tâche et noteConsumed() : sous s_stMux
+  static RadarRx::Stats s_rxSt;                   // copie des compteurs de l'anneau, sous s_stMux
+  static uint32_t s_baud = 115200;
+  static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+  static portMUX_TYPE s_stMux = portMUX_INITIALIZER_UNLOCKED;
+  static uint32_t s_winUs = 0, s_winFrames = 0;   // fenêtre de mesure de fps_x10
+  static uint8_t  s_lastTx[4 + 2 + CMD_MAX_LEN + 4];
+  static size_t   s_lastTxN = 0;
+
+  static inline uint16_t u16le(const uint8_t* p){ return uint16_t(p[0]) | (uint16_t(p[1])<<8); }
+  static inline uint32_t wireUs(size_t n){ return uint32_t((uint64_t)n * 10u * 1000000u / s_baud); }   // 8N1
+
+  static void onData(const uint8_t* p, size_t n, uint32_t t_us){
+    uint16_t L = u16le(p + 4);
+    const uint8_t* pl = p + 6; const uint8_t* end = pl + L;
+    TargetFrame tf; tf.t_us = t_us - wireUs(n); tf.count = 0; tf.truncated = 0;
+    uint8_t cnt = 0;
+    if (L >= 2){
+      cnt = pl[0]; const uint8_t* tp = pl + 2;
+      for (uint8_t i = 0; i < cnt && tp + 5 <= end; i++, tp += 5){
+        if (tf.count >= MAX_TARGETS) { tf.truncated++; continue; }
+        Target& t = tf.t[tf.count++];
+        t.angle = int8_t(int(tp[0]) - 0x80); t.dist_m = tp[1]; t.dir = tp[2]; t.speed_kmh = tp[3]; t.snr = tp[4];
+      }
+    }
+    const uint32_t nowMs = millis();
+    const bool sent = xQueueSend(s_frameQ, &tf, 0) == pdTRUE;
+    portENTER_CRITICAL(&s_stMux);
+    s_st.frames_data++; s_st.targets += cnt; s_st.truncated += tf.truncated;
+    if (!cnt) s_st.frames_empty++;
+    s_st.tgt_hist[cnt < TGT_BINS - 1 ? cnt : TGT_BINS - 1]++;
+    s_st.last_frame_ms = nowMs;
+    if (!sent) s_st.queue_drops++;
+    s_winFrames++;
+    const uint32_t el = t_us - s_winUs;
+    if (el >= FPS_WIN_US) {
+      s_st.fps_x10 = uint16_t(el < 2 * FPS_WIN_US ? (uint64_t(s_winFrames) * 10000000u + el / 2) / el : 0);
+      s_winUs = t_us; s_winFrames = 0;
+    }
+    portEXIT_CRITICAL(&s_stMux);
+  }
+
+  static void onAck(const uint8_t* p, size_t n){
+    portENTER_CRITICAL(&s_mux);
+    bool echo = (n == s_lastTxN) && memcmp(p, s_lastTx, n) == 0;
+    portEXIT_CRITICAL(&s_mux);
+    if (echo) { portENTER_CRITICAL(&s_stMux); s_st.echo_drops++; portEXIT_CRITICAL(&s_stMux); return; }
+    uint16_t L = u16le(p + 4);
+    size_t retLen = L - 2;                        // L>=2 garanti par l'anneau
+    Ack a; a.cmd = u16le(p + 6); a.status = (retLen >= 2) ? u16le(p + 8) : 0xFFFF;
+    const uint8_t* first = p + 8 + (retLen >= 2 ? 2 : 0); const uint8_t* last = p + n - 4;
+    a.n = uint8_t(last - first); memcpy(a.data, first, a.n);
+    a.t_ms = millis();
+    const bool sent = xQueueSend(s_ackQ, &a, 0) == pdTRUE;
+    portENTER_CRITICAL(&s_stMux);
+    s_st.frames_ack++; s_st.last_frame_ms = a.t_ms;
+    if (!sent) s_st.queue_drops++;
+    portEXIT_CRITICAL(&s_stMux);
+  }
+
+  static void drain(uint32_t t_us){
+    uint8_t buf[256]; size_t avail = 0; uint32_t got = 0;
+    uart_get_buffered_data_len(PORT, &avail);
+    while (avail){
+      int n = uart_read_bytes(PORT, buf, avail < sizeof(buf) ? avail : sizeof(buf), 0);
+      if (n <= 0) break;
+      s_ring.push(buf, size_t(n)); got += uint32_t(n); avail -= size_t(n);
+    }
+    static uint8_t scratch[4 + 2 + DAT_MAX_LEN + 4];
+    RadarRx::Frame f;
+    while (s_ring.next(f)){
+      const uint8_t* p = f.raw.linear(scratch);
+      if (f.kind == RadarRx::DATA) onData(p, f.raw.size(), t_us);
+      else                         onAck(p, f.raw.size());
+      s_ring.release(f);
+    }
+    portENTER_CRITICAL(&s_stMux);
+    s_st.bytes_rx += got; s_rxSt = s_ring.stats();
+    portEXIT_CRITICAL(&s_stMux);
+  }
+  static void hwOverflow(){ portENTER_CRITICAL(&s_stMux); s_st.hw_overflows++; portEXIT_CRITICAL(&s_stMux); }
+
+  static void task(void*){
+    uart_event_t ev;
+    for (;;){
+      if (xQueueReceive(s_uartQ, &ev, portMAX_DELAY) != pdTRUE) continue;
+      uint32_t t = (uint32_t)esp_timer_get_time();
+      switch (ev.type){
+        case UART_DATA:        drain(t); break;
+        case UART_BUFFER_FULL: hwOverflow(); drain(t); break;
+        case UART_FIFO_OVF:    hwOverflow(); uart_flush_input(PORT); xQueueReset(s_uartQ); break;
+        default: break;
+      }
+    }
+  }
+
+  bool begin(uint32_t baud, int rxPin, int txPin){
+    s_baud = baud ? baud : 115200;
+    uart_config_t c = {};
+    c.baud_rate = (int)s_baud; c.data_bits = UART_DATA_8_BITS; c.parity = UART_PARITY_DISABLE;
+    c.stop_bits = UART_STOP_BITS_1; c.flow_ctrl = UART_HW_FLOWCTRL_DISABLE; c.source_clk = UART_SCLK_APB;
+    if (uart_driver_install(PORT, DRV_RX_BUF, 0, EVT_Q_LEN, &s_uartQ, 0) != ESP_OK) { Serial.println("[RADAR] uart_driver_install failed"); return false; }
+    uart_param_config(PORT, &c);
+    uart_set_pin(PORT, txPin, rxPin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+    // Les en-têtes LD2451 (F4F3F2F1 / FDFCFBFA) ne sont pas des répétitions d'un même
+    // caractère : la détection de motif AT_CMD du driver ne s'applique pas. On se cale
+    // sur le timeout RX (silence inter-trames) pour être réveillé une fois par trame.
+    uart_set_rx_timeout(PORT, RX_TOUT_SYMBOLS);
+    s_frameQ = xQueueCreate(FRAME_Q_LEN, sizeof(TargetFrame));
+    s_ackQ   = xQueueCreate(ACK_Q_LEN, sizeof(Ack));
+    if (!s_frameQ || !s_ackQ) { Serial.println("[RADAR] queue alloc failed"); return false; }
+    if (xTaskCreatePinnedToCore(task, "radar_rx", 4096, nullptr, TASK_PRIO, &s_task, TASK_CORE) != pdPASS) {
+      Serial.println("[RADAR] task create failed"); return false;
+    }
+    Serial.printf("[RADAR] ingest task on core %d prio %u, frame queue %u x %uB\n",
+                  (int)TASK_CORE, (unsigned)TASK_PRIO, (unsigned)FRAME_Q_LEN, (unsigned)sizeof(TargetFrame));
+    return true;
+  }
+
+  void setBaud(uint32_t baud){
+    if (!baud || baud == s_baud) return;
+    uart_wait_tx_done(PORT, pdMS_TO_TICKS(100));
+    uart_set_baudrate(PORT, baud); uart_flush_input(PORT);
+    s_baud = baud;
+  }
+  uint32_t baud(){ return s_baud; }
+
+  void write(const uint8_t* p, size_t n){
+    portENTER_CRITICAL(&s_mux);
+    s_lastTxN = n <= sizeof(s_lastTx) ? n : 0;
+    if (s_lastTxN) memcpy(s_lastTx, p, n);
+    portEXIT_CRITICAL(&s_mux);
+    uart_write_bytes(PORT, p, n);
+    uart_wait_tx_done(PORT, pdMS_TO_TICKS(100));
+  }
+
+  bool popFrame(TargetFrame& f){ return s_frameQ && xQueueReceive(s_frameQ, &f, 0) == pdTRUE; }
+  bool popAck(Ack& a, uint32_t timeout_ms){ return s_ackQ && xQueueReceive(s_ackQ, &a, pdMS_TO_TICKS(timeout_ms)) == pdTRUE; }
+
+  uint32_t noteConsumed(const TargetFrame& f){
+    uint32_t lat = (uint32_t)esp_timer_get_time() - f.t_us;
+    portENTER_CRITICAL(&s_stMux);
+    s_st.lat_last_us = lat;
+    if (lat > s_st.lat_max_us) s_st.lat_max_us = lat;
+    portEXIT_CRITICAL(&s_stMux);
+    return lat;
+  }
+
+  // Copies cohérentes : la tâche tourne sur l'autre cœur
+  Stats stats(){
+    const uint32_t now = (uint32_t)esp_timer_get_time();
+    portENTER_CRITICAL(&s_stMux);
+    Stats s = s_st; const uint32_t winUs = s_winUs;
+    portEXIT_CRITICAL(&s_stMux);
+    if (now - winUs >= 2 * FPS_WIN_US) s.fps_x10 = 0;   // plus de trame : fenêtre jamais close
+    return s;
+  }
+  RadarRx::Stats rxStats(){ portENTER_CRITICAL(&s_stMux); RadarRx::Stats s = s_rxSt; portEXIT_CRITICAL(&s_stMux); return s; }
+}
@@ -0,0 +1,73 @@
+#include "speed_corr.h"
+
+namespace SpeedCorr {
+  // ---- Tables constexpr (C++11 : fonctions à une seule expression, récursives)
+  static constexpr double PI = 3.14159265358979323846;
+  // cos par série de Taylor (x en radians, |x| <= pi/3 : 12 termes suffisent largement)
+  static constexpr double cosT(double x2, int n, double term){ return n > 12 ? 0 : term + cosT(x2, n + 1, -term * x2 / ((2 * n - 1) * (2 * n))); }
+  static constexpr double cosd(int deg){ return cosT((deg * PI / 180) * (deg * PI / 180), 1, 1); }
+  static constexpr double sqrtN(double a, double x, int i){ return i ? sqrtN(a, 0.5 * (x + a / x), i - 1) : x; }
+  static constexpr uint16_t q12(double f){ return f * ONE >= MAX_FACTOR ? MAX_FACTOR : uint16_t(f * ONE + 0.5); }
+
+  static constexpr uint16_t invCos(int deg){ return q12(1 / cosd(deg)); }
+  // 1 / sqrt(1 - s²), s = i / 256 (sinus de l'angle d'élévation / de déport)
+  static constexpr uint16_t invCosAsin(int i){ return i >= 256 ? MAX_FACTOR : q12(1 / sqrtN(1 - (i / 256.0) * (i / 256.0), 1, 12)); }
+
+  template<int... I> struct Seq {};
+  template<int N, int... I> struct Gen : Gen<N - 1, N - 1, I...> {};
+  template<int... I> struct Gen<0, I...> { typedef Seq<I...> type; };
+
+  struct CosTable { uint16_t v[MAX_ANGLE + 1]; };
+  struct SinTable { uint16_t v[256]; };
+  template<int... I> static constexpr CosTable makeCos(Seq<I...>){ return CosTable{{ invCos(I)... }}; }
+  template<int... I> static constexpr SinTable makeSin(Seq<I...>){ return SinTable{{ invCosAsin(I)... }}; }
+
+  static constexpr CosTable INV_COS = makeCos(Gen<MAX_ANGLE + 1>::type());
+  static constexpr SinTable INV_COS_ASIN = makeSin(Gen<256>::type());
+  static_assert(INV_COS.v[0] == ONE && INV_COS.v[30] == 4730 && INV_COS.v[MAX_ANGLE] == MAX_FACTOR, "1/cos table");
+  static_assert(INV_COS_ASIN.v[0] == ONE && INV_COS_ASIN.v[128] == 4730 && INV_COS_ASIN.v[255] == MAX_FACTOR, "1/cos(asin) table");
+
+  // ---- Réglages
+  static Geometry s_g;
+  static uint16_t s_k_dm = 0;     // sqrt(h² + o²) : distance minimale à la voie (M_GEOM)
+
+  static uint16_t isqrt(uint32_t v){ uint32_t r = 0, b = 1UL << 30; while (b > v) b >>= 2; while (b) { if (v >= r + b) { v -= r + b; r = (r >> 1) + b; } else r >>= 1; b >>= 2; } return uint16_t(r); }
+
+  // Terme 1/cos(asin(k/d)) ; d <= k : cible au point le plus proche, facteur plafonné
+  static uint16_t slant(uint16_t k_dm, uint8_t dist_m){
+    if (!k_dm) return ONE;
+    const uint32_t d_dm = uint32_t(dist_m) * 10;
+    if (d_dm <= k_dm) return MAX_FACTOR;
+    const uint32_t i = ((uint32_t(k_dm) << 8) + d_dm / 2) / d_dm;   // sinus en Q8, arrondi
+    return INV_COS_ASIN.v[i > 255 ? 255 : i];
+  }
+
+  void set(const Geometry& g){
+    s_g = g; if (s_g.mode >= M_COUNT) s_g.mode = M_OFF;
+    s_k_dm = isqrt(uint32_t(g.height_dm) * g.height_dm + uint32_t(g.offset_dm) * g.offset_dm);
+  }
+  Geometry get(){ return s_g; }
+
+  uint16_t factor(int8_t angle, uint8_t dist_m){
+    switch (s_g.mode) {
+      case M_ANGLE: {
+        int a = int(angle) + s_g.yaw_deg; if (a < 0) a = -a; if (a > MAX_ANGLE) a = MAX_ANGLE;
+        const uint32_t f = (uint32_t(INV_COS.v[a]) * slant(s_g.height_dm, dist_m)) >> 12;
+        return f > MAX_FACTOR ? MAX_FACTOR : uint16_t(f);
+      }
+      case M_GEOM: return slant(s_k_dm, dist_m);
+      default:     return ONE;
+    }
+  }
+
+  uint8_t correct(uint8_t v, int8_t angle, uint8_t dist_m){
+    if (s_g.mode == M_OFF || !v) return v;
+    const uint32_t c = (uint32_t(v) * factor(angle, dist_m) + ONE / 2) >> 12;
+    return c > 255 ? 255 : uint8_t(c);
+  }
+
+  const char* modeName(uint8_t m){
+    static const char* N[M_COUNT] = { "off", "angle", "geom" };
+    return m < M_COUNT ? N[m] : "off";
+  }
+}
@@ -0,0 +1,135 @@
+#include "speed_quantiles.h"
+#include <Preferences.h>
+#include <string.h>
+#include <math.h>
+
+namespace SpeedQ {
+  static const char*    NS  = "speedq";
+  static const char*    K_ST = "state";
+  static const uint16_t VER = 1;
+  static const float    PROBS[2] = { 0.50f, 0.85f };
+
+  // Un estimateur P² : hauteurs q, positions n (réelles), positions désirées np
+  struct P2 {
+    float    q[5];
+    double   np[5];     // double : positions exactes même après des millions de passages
+    int32_t  n[5];
+    uint32_t count;
+
+    void clear(){ memset(this, 0, sizeof(*this)); }
+
+    void add(float x, float p){
+      if (count < 5){
+        q[count++] = x;
+        if (count == 5){
+          for (int i = 1; i < 5; i++) for (int j = i; j > 0 && q[j-1] > q[j]; j--){ float t = q[j]; q[j] = q[j-1]; q[j-1] = t; }
+          for (int i = 0; i < 5; i++) n[i] = i;
+          np[0] = 0; np[1] = 2*p; np[2] = 4*p; np[3] = 2 + 2*p; np[4] = 4;
+        }
+        return;
+      }
+      int k;
+      if (x < q[0]) { q[0] = x; k = 0; }
+      else if (x >= q[4]) { q[4] = x; k = 3; }
+      else { k = 0; while (k < 3 && x >= q[k+1]) k++; }
+      for (int i = k + 1; i < 5; i++) n[i]++;
+      const float dn[5] = { 0, p/2, p, (1+p)/2, 1 };
+      for (int i = 0; i < 5; i++) np[i] += dn[i];
+      count++;
+      for (int i = 1; i < 4; i++){
+        float d = float(np[i] - n[i]);
+        if ((d >= 1 && n[i+1] - n[i] > 1) || (d <= -1 && n[i-1] - n[i] < -1)){
+          int s = d > 0 ? 1 : -1;
+          // Interpolation parabolique, repli linéaire si elle sort de [q[i-1], q[i+1]]
+          float qp = q[i] + float(s) / (n[i+1] - n[i-1]) *
+                     ((n[i] - n[i-1] + s) * (q[i+1] - q[i]) / (n[i+1] - n[i]) +
+                      (n[i+1] - n[i] - s) * (q[i] - q[i-1]) / (n[i] - n[i-1]));
+          if (q[i-1] < qp && qp < q[i+1]) q[i] = qp;
+          else q[i] += s * (q[i+s] - q[i]) / (n[i+s] - n[i]);
+          n[i] += s;
+        }
+      }
+    }
+
+    float value(float p) const {
+      if (count >= 5) return q[2];
+      if (!count) return 0;
+      float s[5]; memcpy(s, q, sizeof(s));
+      for (uint32_t i = 1; i < count; i++) for (uint32_t j = i; j > 0 && s[j-1] > s[j]; j--){ float t = s[j]; s[j] = s[j-1]; s[j-1] = t; }
+      int idx = int(ceilf(p * count)) - 1; if (idx < 0) idx = 0;
+      return s[idx];
+    }
+  };
+
+  struct Win { P2 e[D_COUNT][2]; int32_t key; };
+  struct State { uint16_t ver; Win w[W_COUNT]; };
+
+  static State    s_st;
+  static uint32_t s_changes = 0;
+
+  // Clés de fenêtre : jour = année*400 + jour de l'année, heure = jour*24 + heure
+  static int32_t keyOf(Window w, time_t t){
+    if (w == W_TOTAL) return 0;
+    struct tm tm; localtime_r(&t, &tm);
+    int32_t day = int32_t(tm.tm_year) * 400 + tm.tm_yday;
+    return w == W_DAY ? day : day * 24 + tm.tm_hour;
+  }
+  static void clearWin(Win& w, int32_t key){ for (auto& d: w.e) for (auto& e: d) e.clear(); w.key = key; }
+
+  static void save(){
+    Preferences p;
+    if (p.begin(NS, false)){ p.putBytes(K_ST, &s_st, sizeof(s_st)); p.end(); }
+  }
+
+  void begin(){
+    Preferences p; bool ok = false;
+    if (p.begin(NS, true)){
+      ok = p.getBytesLength(K_ST) == sizeof(s_st) && p.getBytes(K_ST, &s_st, sizeof(s_st)) == sizeof(s_st) && s_st.ver == VER;
+      p.end();
+    }
+    if (!ok){ memset(&s_st, 0, sizeof(s_st)); s_st.ver = VER; }
+  }
+
+  // Les fenêtres n'avancent que vers l'avant : un horodatage antérieur (pointe datée en
+  // arrière, heure d'été) ne rouvre pas une fenêtre déjà fermée
+  bool tick(time_t now){
+    bool rolled = false;
+    for (uint8_t w = W_DAY; w < W_COUNT; w++){
+      int32_t k = keyOf(Window(w), now);
+      if (k > s_st.w[w].key){ clearWin(s_st.w[w], k); rolled = true; }
+    }
+    if (rolled) save();
+    return rolled;
+  }
+
+  // ts = 0 : horodatage inconnu, compté dans le total seulement. Un passage d'une fenêtre
+  // déjà fermée n'est compté que dans le total et les fenêtres plus longues qui le couvrent.
+  void add(time_t ts, uint8_t dir, uint8_t speed_kmh){
+    if (ts) tick(ts);
+    const uint8_t d = dir ? D_APPROACH : D_AWAY;
+    const float x = speed_kmh;
+    for (uint8_t w = 0; w < W_COUNT; w++){
+      if (w != W_TOTAL && (!ts || keyOf(Window(w), ts) != s_st.w[w].key)) continue;
+      Win& win = s_st.w[w];
+      for (uint8_t k = 0; k < 2; k++){ win.e[d][k].add(x, PROBS[k]); win.e[D_ALL][k].add(x, PROBS[k]); }
+    }
+    s_changes++;
+  }
+
+  void reset(){
+    time_t now = time(nullptr);
+    for (uint8_t w = 0; w < W_COUNT; w++) clearWin(s_st.w[w], keyOf(Window(w), now));
+    s_changes++;
+    save();
+  }
+
+  Result get(Window w, Dir d){
+    Result r; const P2* e = s_st.w[w].e[d];
+    r.n = e[0].count; r.p50 = e[0].value(PROBS[0]); r.p85 = e[1].value(PROBS[1]);
+    return r;
+  }
+
+  const char* windowName(Window w){ static const char* N[] = { "total", "day", "hour" }; return w < W_COUNT ? N[w] : "?"; }
+  const char* dirName(Dir d){ static const char* N[] = { "away", "approach", "all" }; return d < D_COUNT ? N[d] : "?"; }
+  uint32_t changes(){ return s_changes; }
+}
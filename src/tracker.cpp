@@ -0,0 +1,110 @@
+#include "tracker.h"
+#include <string.h>
+
+namespace Tracker {
+  struct Track {
+    bool     used;
+    uint8_t  dir, speed, dist, peak, peak_true, dist_in, snr_pk;
+    int8_t   angle, angle_pk;
+    uint16_t hits;
+    uint32_t t_first, t_last, t_peak;
+    uint8_t  zhits[8];     // détections par bit de zone (saturé)
+  };
+
+  static Track  s_tr[MAX_TRACKS];
+  static Params s_p;
+  static Stats  s_st;
+
+  static inline int iabs(int v){ return v < 0 ? -v : v; }
+
+  // Distance attendue à t_us : la vitesse radiale rapproche (dir=1) ou éloigne (dir=0) la cible.
+  // v km/h * dt ms / 3600 -> m, en 32 bits (dt plafonné à 10 s : 255 * 10000 tient large)
+  static int predictDist(const Track& k, uint32_t t_us){
+    uint32_t dt_ms = (t_us - k.t_last) / 1000; if (dt_ms > 10000) dt_ms = 10000;
+    int step = int((k.speed * dt_ms) / 3600);
+    return k.dir ? int(k.dist) - step : int(k.dist) + step;
+  }
+
+  // Coût normalisé (somme des écarts / porte, x256) ; -1 si hors porte
+  static int cost(const Track& k, int pred, const Det& d){
+    if (k.dir != d.dir) return -1;
+    int da = iabs(int(d.angle) - k.angle), dd = iabs(int(d.dist_m) - pred), dv = iabs(int(d.speed_kmh) - k.speed);
+    if (da > s_p.gate_ang || dd > s_p.gate_dist || dv > s_p.gate_spd) return -1;
+    return (da << 8) / (s_p.gate_ang + 1) + (dd << 8) / (s_p.gate_dist + 1) + (dv << 8) / (s_p.gate_spd + 1);
+  }
+
+  static void hit(Track& k, const Det& d, uint32_t t_us){
+    k.angle = d.angle; k.dist = d.dist_m; k.speed = d.speed_kmh; k.t_last = t_us; k.hits++;
+    for (uint8_t m = d.zones, b = 0; m; m >>= 1, b++) if ((m & 1) && k.zhits[b] < 255) k.zhits[b]++;
+    if (d.speed_kmh > k.peak) { k.peak = d.speed_kmh; k.peak_true = d.speed_true; k.angle_pk = d.angle; k.snr_pk = d.snr; k.t_peak = t_us; }
+  }
+
+  static void open(const Det& d, uint32_t t_us){
+    for (auto& k: s_tr) if (!k.used) {
+      memset(&k, 0, sizeof(k)); k.used = true; k.dir = d.dir; k.dist_in = d.dist_m; k.t_first = t_us;
+      hit(k, d, t_us); s_st.opened++;
+      return;
+    }
+    s_st.full_drops++;
+  }
+
+  static uint8_t close(Track& k, Result* out, uint8_t cap, uint8_t n){
+    k.used = false;
+    if (k.hits < s_p.min_hits) { s_st.short_drops++; return n; }
+    s_st.passes++;
+    if (n >= cap) return n;
+    Result& r = out[n];
+    r.t_first_us = k.t_first; r.t_last_us = k.t_last; r.t_peak_us = k.t_peak; r.hits = k.hits;
+    r.dir = k.dir; r.peak_kmh = k.peak; r.peak_true = k.peak_true; r.dist_in = k.dist_in; r.dist_out = k.dist; r.snr = k.snr_pk; r.angle = k.angle_pk;
+    r.zone = 0; for (uint8_t b = 0, best = 0; b < 8; b++) if (k.zhits[b] > best) { best = k.zhits[b]; r.zone = uint8_t(b + 1); }
+    return n + 1;
+  }
+
+  uint8_t expire(uint32_t now_us, Result* out, uint8_t cap){
+    uint8_t n = 0;
+    for (auto& k: s_tr)
+      if (k.used && (now_us - k.t_last > s_p.gap_us || (k.hits < s_p.min_hits && now_us - k.t_first > s_p.confirm_us))) n = close(k, out, cap, n);
+    return n;
+  }
+
+  uint8_t update(uint32_t t_us, const Det* d, uint8_t nd, Result* out, uint8_t cap){
+    s_st.frames++; s_st.dets += nd;
+    uint8_t n = expire(t_us, out, cap);
+    if (nd > MAX_DETS) nd = MAX_DETS;
+    // Matrice de coûts calculée une fois, puis affectation gloutonne : à chaque tour la
+    // paire (piste, cible) de coût minimal
+    int16_t c[MAX_TRACKS][MAX_DETS]; uint8_t live = 0;
+    for (int i = 0; i < MAX_TRACKS; i++) {
+      if (!s_tr[i].used) continue;
+      live |= uint8_t(1u << i);
+      const int pred = predictDist(s_tr[i], t_us);
+      for (int j = 0; j < nd; j++) c[i][j] = int16_t(cost(s_tr[i], pred, d[j]));
+    }
+    uint16_t dUsed = 0; uint8_t matched = 0;
+    while (live) {
+      int best = -1, bi = -1, bj = -1;
+      for (int i = 0; i < MAX_TRACKS; i++) {
+        if (!(live >> i & 1)) continue;
+        for (int j = 0; j < nd; j++)
+          if (!(dUsed >> j & 1) && c[i][j] >= 0 && (best < 0 || c[i][j] < best)) { best = c[i][j]; bi = i; bj = j; }
+      }
+      if (best < 0) break;
+      hit(s_tr[bi], d[bj], t_us); live &= uint8_t(~(1u << bi)); matched |= uint8_t(1u << bi); dUsed |= uint16_t(1u << bj);
+    }
+    // Cible restante : écho secondaire d'un véhicule déjà apparié dans cette trame, ou nouvelle
+    // piste. Seules les pistes de matched ont une ligne dans c (pas celles ouvertes ici)
+    for (int j = 0; j < nd; j++) {
+      if (dUsed >> j & 1) continue;
+      bool echo = false;
+      for (int i = 0; i < MAX_TRACKS && !echo; i++) echo = (matched >> i & 1) && c[i][j] >= 0;
+      if (!echo) open(d[j], t_us);
+    }
+    return n;
+  }
+
+  void    setParams(const Params& p){ s_p = p; }
+  Params  params(){ return s_p; }
+  uint8_t active(){ uint8_t n = 0; for (auto& k: s_tr) if (k.used) n++; return n; }
+  void    reset(){ memset(s_tr, 0, sizeof(s_tr)); s_st = Stats(); }
+  Stats   stats(){ return s_st; }
+}
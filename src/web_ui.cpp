@@ -39,6 +39,10 @@ footer{padding:16px 20px;color:#9aa4b2}
       <div class="switch"><input id="opt_approach" type="checkbox"><label for="opt_approach">Approche seulement</label></div>
       <div class="switch"><label for="opt_minspd">Vitesse mini</label><input id="opt_minspd" type="number" min="0" max="120" step="1" value="0"> km/h</div>
       <div class="switch"><label for="opt_deb">Anti-doublons</label><input id="opt_deb" type="number" min="200" max="5000" step="100" value="1500"> ms</div>
+      <div class="switch"><label for="opt_spdmode">Correction vitesse</label><select id="opt_spdmode"><option value="0">aucune (radiale)</option><option value="1">angle</option><option value="2">géométrie</option></select></div>
+      <div class="switch"><label for="opt_spdh">Hauteur</label><input id="opt_spdh" type="number" min="0" max="25" step="0.1" value="0"> m
+        <label for="opt_spdoff">Déport</label><input id="opt_spdoff" type="number" min="0" max="100" step="0.1" value="0"> m
+        <label for="opt_spdyaw">Lacet</label><input id="opt_spdyaw" type="number" min="-60" max="60" step="1" value="0"> °</div>
       <div style="margin-top:10px">
         <button class="btn" onclick="saveOpts()">Enregistrer</button>
         <button class="btn secondary" onclick="clearPasses()">Effacer la liste</button>
@@ -50,6 +54,8 @@ footer{padding:16px 20px;color:#9aa4b2}
       <h2>Statistiques (live)</h2>
       <canvas id="chart_speed"></canvas><div style="height:12px"></div>
       <canvas id="chart_dir"></canvas>
+      <div style="margin-top:8px"><small id="v85"></small></div>
+      <div><small id="zst"></small></div>
     </div>
   </div>
 
@@ -57,7 +63,7 @@ footer{padding:16px 20px;color:#9aa4b2}
     <h2>Derniers passages</h2>
     <div style="overflow:auto;max-height:50vh">
       <table id="tbl"><thead><tr>
-        <th>Date/Heure</th><th>Direction</th><th>Vitesse</th><th>Distance</th><th>Angle</th><th>SNR</th>
+        <th>Date/Heure</th><th>Direction</th><th>Vitesse</th><th>Distance</th><th>Durée</th><th>Angle</th><th>SNR</th>
       </tr></thead><tbody></tbody></table>
     </div>
   </div>
@@ -69,25 +75,72 @@ async function getJSON(u){const r=await fetch(u); return r.json();}
 function badgeDir(d){return d?"<span class='badge approach'>approche</span>":"<span class='badge away'>éloign.</span>";}
 function fmtDate(s){return s||'-';}
 
-async function loadAll(){
-  const cfg=await getJSON('/api/options');
-  opt_approach.checked=!!cfg.approach; opt_minspd.value=cfg.minspd|0; opt_deb.value=cfg.debounce|0;
-
-  const data = await getJSON('/api/passes'); const tb=document.querySelector('#tbl tbody'); tb.innerHTML='';
-  for(const p of data){
+// Curseur /api/passes : un poll sans nouveau passage ne renvoie qu'une ligne fixe
+let rows=[], cur=null; const MAXROWS=200;
+function renderRows(){
+  const tb=document.querySelector('#tbl tbody'); tb.innerHTML='';
+  for(const p of rows){
     const tr=document.createElement('tr');
     tr.innerHTML = `<td>${fmtDate(p.datetime)}</td><td>${badgeDir(p.dir)}</td>
-      <td>${p.speed_kmh} km/h</td><td>${p.dist_m} m</td><td>${p.angle_deg}°</td><td>${p.snr}</td>`;
+      <td>${p.speed_kmh} km/h${p.speed_raw!=null&&p.speed_raw!=p.speed_kmh?` <small>(${p.speed_raw})</small>`:''}</td><td>${p.dist_m}→${p.dist_out??'-'} m</td><td>${p.dwell_s??'-'} s</td><td>${p.angle_deg}°</td><td>${p.snr}</td>`;
     tb.appendChild(tr);
   }
-  const st = await getJSON('/api/stats'); drawSpeedChart(st.speed_bins); drawDirChart(st.dir_counts);
+}
+async function loadOpts(){
+  const cfg=await getJSON('/api/options');
+  opt_approach.checked=!!cfg.approach; opt_minspd.value=cfg.minspd|0; opt_deb.value=cfg.debounce|0;
+  opt_spdmode.value=cfg.spdmode|0; opt_spdh.value=(cfg.spdh|0)/10; opt_spdoff.value=(cfg.spdoff|0)/10; opt_spdyaw.value=cfg.spdyaw|0;
+}
+let st=null;
+function drawStats(){ drawSpeedChart(st.speed_bins); drawDirChart(st.dir_counts); showZones(st.zones||[]); }
+function showZones(z){
+  zst.innerText = z.map(x=>`${x.name||('Zone '+x.id)} : ${x.count} (↗${x.approach} ↘${x.away})${x.count?` V85 ${x.speed.v85} km/h`:''}`).join(' • ');
+}
+function showSpeeds(q){
+  const f=(r)=>r.n?`V50 ${r.p50} / V85 ${r.p85} km/h (${r.n})`:'-';
+  v85.innerText = `Total : ${f(q.total.all)} • Aujourd’hui : ${f(q.day.all)} • Heure : ${f(q.hour.all)}`;
+}
+async function loadStats(){
+  st = await getJSON('/api/stats'); drawStats();
+  showSpeeds(await getJSON('/api/speeds'));
+}
+async function loadAll(){
+  const j = await getJSON(cur===null ? `/api/passes?limit=${MAXROWS}` : `/api/passes?since=${cur}&limit=${MAXROWS}`);
+  const init = cur===null, fresh = init ? j.passes : j.passes.reverse();
+  const stale = rows.length && rows[rows.length-1].seq < j.first;   // effacé ou évincé ailleurs
+  cur = j.next;
+  if (!init && !fresh.length && !stale) return;
+  rows = fresh.concat(rows).filter(p=>p.seq>=j.first).slice(0,MAXROWS); renderRows();
+  await loadStats();
 }
 async function saveOpts(){
   const a=opt_approach.checked?1:0, m=+opt_minspd.value||0, d=+opt_deb.value||1500;
-  await fetch(`/api/options?approach=${a}&minspd=${m}&debounce=${d}`); msg.innerText='Options OK'; setTimeout(()=>msg.innerText='',1200);
-  loadAll();
+  const g=`&spdmode=${opt_spdmode.value}&spdh=${Math.round(opt_spdh.value*10)}&spdoff=${Math.round(opt_spdoff.value*10)}&spdyaw=${+opt_spdyaw.value||0}`;
+  await fetch(`/api/options?approach=${a}&minspd=${m}&debounce=${d}${g}`); msg.innerText='Options OK'; setTimeout(()=>msg.innerText='',1200);
+  loadOpts();
+}
+// Delta stats poussé avec chaque passage (+1 nouveau, -1 évincé du ring)
+function bumpStats(v, dir, k){
+  if(!st) return; const b=st.speed_bins.find(b=>v>=b.min&&v<=b.max); if(b) b.count+=k;
+  st.dir_counts[dir?'approach':'away']+=k; st.count+=k;
 }
-async function clearPasses(){ if(!confirm('Effacer tous les passages ?')) return; await fetch('/api/clear'); loadAll(); }
+// Push SSE (port 81) ; poll 1,5 s seulement si EventSource indisponible ou coupé
+let poll=null;
+function startPoll(){ if(!poll) poll=setInterval(loadAll,1500); }
+function startPush(){
+  if(!window.EventSource) return startPoll();
+  const es=new EventSource(`http://${location.hostname}:81/events`);
+  es.onopen=()=>{ if(poll){ clearInterval(poll); poll=null; } loadAll(); };   // rattrapage par curseur
+  es.onerror=()=>startPoll();                                                 // EventSource se reconnecte seul
+  es.addEventListener('pass', e=>{
+    const p=JSON.parse(e.data); if(cur===null || p.seq<=cur) return; cur=p.seq;
+    rows.unshift(p); rows=rows.slice(0,MAXROWS); renderRows();
+    bumpStats(p.speed_kmh,p.dir,1); if(p.evict) bumpStats(p.evict.speed_kmh,p.evict.dir,-1); if(st) drawStats();
+  });
+  es.addEventListener('speeds', e=>showSpeeds(JSON.parse(e.data)));
+  es.addEventListener('clear', ()=>{ rows=[]; renderRows(); loadStats(); });
+}
+async function clearPasses(){ if(!confirm('Effacer tous les passages ?')) return; await fetch('/api/clear'); rows=[]; renderRows(); loadStats(); }
 
 function drawSpeedChart(bins){
   const c = chart_speed, g=c.getContext('2d'); const W=c.clientWidth,H=c.clientHeight; c.width=W;c.height=H; g.clearRect(0,0,W,H);
@@ -106,7 +159,7 @@ function drawDirChart(dc){
   g.fillStyle='#10b981'; g.fillRect(10,H-18,10,10); g.fillStyle='#e7eef9'; g.fillText('Approche',26,H-10);
   g.fillStyle='#4b5563'; g.fillRect(100,H-18,10,10); g.fillStyle='#e7eef9'; g.fillText('Éloign.',116,H-10);
 }
-loadAll(); setInterval(loadAll, 1500);
+loadOpts(); loadAll(); startPush();
 </script>
 </body></html>
 
@@ -175,6 +228,18 @@ input[type="number"]{width:110px}
     <div style="margin-top:10px"><small id="cfg_msg"></small></div>
   </div>
 
+  <div class="card">
+    <h2>Zones de détection</h2>
+    <p><small>Polygones dans le plan angle (°, négatif à gauche) / distance (m), 3 à 8 sommets « angle,distance » séparés par « ; ».
+      Si une zone « comptage » existe, seules les cibles dedans sont comptées ; les zones « ignorer » (trottoir...) sont toujours écartées.</small></p>
+    <div id="zones"></div>
+    <canvas id="zcv" width="480" height="240" style="width:100%;max-width:480px;background:#0b1220;border:1px solid #1f2937;border-radius:12px"></canvas>
+    <div style="margin-top:10px">
+      <button class="btn" onclick="zonesSave()">Enregistrer les zones</button>
+      <small id="zmsg" style="margin-left:10px"></small>
+    </div>
+  </div>
+
   <div class="card">
     <h2>BLE (économie d’énergie)</h2>
     <p><small>Le protocole série publié ne documente pas la désactivation BLE via UART. Le bouton ci-dessous retourne l’état de support.</small></p>
@@ -253,18 +318,55 @@ async function loadCfg(){
   if (meta.baudIdx) cfg_baud.value=meta.baudIdx;
   cfg_applyboot.checked = !!meta.applyBoot;
 }
-async function readCfg(){ setMsg('Lecture...'); const j=await getJSON('/api/cfg/read'); setMsg(j.ok?'Lu.':'Échec lecture'); await loadCfg(); }
+// Commandes radar asynchrones : {ok,job} puis suivi via /api/cfg/job
+async function runJob(u){
+  const j=await getJSON(u); if(!j.ok||!j.job) return j;
+  for(;;){ await new Promise(r=>setTimeout(r,150)); const s=await getJSON('/api/cfg/job?id='+j.job);
+    if(s.state==='done'||s.state==='failed') return Object.assign({},j,s); }
+}
+async function readCfg(){ setMsg('Lecture...'); const j=await runJob('/api/cfg/read'); setMsg(j.ok?'Lu.':'Échec lecture'); await loadCfg(); }
 async function applyCfg(){
   const q=`max=${+cfg_max.value}&dir=${+cfg_dir.value}&minspd=${+cfg_minspd.value}&delay=${+cfg_delay.value}&trig=${+cfg_trig.value}&snr=${+cfg_snr.value}&applyboot=${cfg_applyboot.checked?1:0}`;
-  setMsg('Application...'); const j=await getJSON('/api/cfg/set?'+q); setMsg(j.ok?'Appliqué.':'Échec appli.');
+  setMsg('Application...'); const j=await runJob('/api/cfg/set?'+q); setMsg(j.ok?'Appliqué.':'Échec appli.');
 }
-async function setBaud(){ const idx=+cfg_baud.value; setMsg('Changement de baud...'); const j=await getJSON('/api/cfg/baud?idx='+idx); setMsg(j.ok?('Baud='+j.baud):'Échec baud'); }
+async function setBaud(){ const idx=+cfg_baud.value; setMsg('Changement de baud...'); const j=await runJob('/api/cfg/baud?idx='+idx); setMsg(j.ok?('Baud='+j.baud):'Échec baud'); }
 async function reboot(){ setMsg('Reboot...'); await getJSON('/api/reboot'); setMsg('Demande envoyée.'); }
 async function factory(){ if(!confirm('Restaurer usine ?'))return; setMsg('Usine + reboot...'); await getJSON('/api/factory'); setMsg('Demande envoyée.'); }
-async function preset(n){ setMsg('Profil...'); const j=await getJSON('/api/cfg/preset?name='+encodeURIComponent(n)); setMsg(j.ok?'Profil OK':'Échec profil'); await loadCfg(); }
+async function preset(n){ setMsg('Profil...'); const j=await runJob('/api/cfg/preset?name='+encodeURIComponent(n)); setMsg(j.ok?'Profil OK':'Échec profil'); await loadCfg(); }
 async function ble(en){ ble_msg.innerText='Commande...'; const j=await getJSON('/api/cfg/ble?en='+en); ble_msg.innerText = j.supported? (j.ok?'OK':'Échec'): 'Non supporté par protocole'; }
 loadCfg();
 
+// Zones : une ligne par emplacement (nom, type, sommets) + aperçu angle/distance
+const ZCOL=['#22c55e','#3b82f6','#f59e0b','#ef4444'];
+function zonesForm(list){
+  zones.innerHTML = list.map(z=>`<div class="grid" style="grid-template-columns:60px 1fr 120px 2fr;align-items:center;margin-bottom:6px">
+    <span style="color:${ZCOL[(z.id-1)%4]}">Zone ${z.id}</span><input id="zn${z.id}" type="text" maxlength="15" value="${z.name}" placeholder="nom">
+    <select id="zk${z.id}"><option value="count">comptage</option><option value="ignore">ignorer</option></select>
+    <input id="zp${z.id}" type="text" value="${z.pts}" placeholder="-30,10;-5,10;-5,60;-30,60" oninput="zonesDraw()"></div>`).join('');
+  for(const z of list) document.getElementById('zk'+z.id).value=z.kind;
+  zonesDraw();
+}
+function zonesDraw(){
+  const c=zcv.getContext('2d'), W=zcv.width, H=zcv.height; c.clearRect(0,0,W,H);
+  const x=a=>(a+64)/128*W, y=d=>H-d/128*H;
+  c.strokeStyle='#1f2937'; c.beginPath(); c.moveTo(x(0),0); c.lineTo(x(0),H); c.stroke();
+  for(let i=1;i<=4;i++){ const e=document.getElementById('zp'+i); if(!e||!e.value.trim()) continue;
+    const p=e.value.split(';').map(s=>s.split(',').map(Number)).filter(v=>v.length==2&&!isNaN(v[0])&&!isNaN(v[1]));
+    if(p.length<3) continue;
+    c.beginPath(); p.forEach((v,k)=>k?c.lineTo(x(v[0]),y(v[1])):c.moveTo(x(v[0]),y(v[1]))); c.closePath();
+    c.globalAlpha=.25; c.fillStyle=ZCOL[i-1]; c.fill(); c.globalAlpha=1; c.strokeStyle=ZCOL[i-1]; c.stroke(); }
+}
+async function zonesLoad(){ const j=await getJSON('/api/zones'); zonesForm(j.zones); }
+async function zonesSave(){
+  zmsg.innerText='Enregistrement...'; let ok=true;
+  for(let i=1;i<=4;i++){
+    const q=`id=${i}&kind=${document.getElementById('zk'+i).value}&name=${encodeURIComponent(document.getElementById('zn'+i).value)}&pts=${encodeURIComponent(document.getElementById('zp'+i).value.replace(/\s/g,''))}`;
+    const r=await fetch('/api/zones?'+q); ok = ok && r.ok;
+  }
+  zmsg.innerText = ok?'Zones OK':'Sommets invalides (3 à 8 « angle,distance »)'; zonesLoad();
+}
+zonesLoad();
+
 async function wifiLoad(){
   try{
     const r = await fetch('/api/wifi/get'); 
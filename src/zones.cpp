@@ -0,0 +1,101 @@
+#include "zones.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+namespace Zones {
+  static Zone    s_z[MAX_ZONES];
+  static uint8_t s_grid[ROWS][COLS / 2];      // 2 cellules par octet
+  static uint8_t s_count = 0, s_ignore = 0;   // masques par type
+
+  // Balayage : pour chaque ligne de distance, intersections des arêtes avec son centre,
+  // puis remplissage des cellules dont le centre tombe entre deux intersections (pair-impair)
+  static void raster(uint8_t bit, const Zone& z){
+    for (int r = 0; r < ROWS; r++) {
+      const float dc = r + 0.5f; float xs[MAX_PTS]; uint8_t k = 0;
+      for (uint8_t j = 0; j < z.n; j++) {
+        const Pt& a = z.pts[j]; const Pt& b = z.pts[(j + 1) % z.n];
+        if ((a.dist_m <= dc) == (b.dist_m <= dc)) continue;
+        xs[k++] = a.angle + (dc - a.dist_m) * (b.angle - a.angle) / float(int(b.dist_m) - a.dist_m);
+      }
+      for (uint8_t i = 1; i < k; i++) for (uint8_t j = i; j && xs[j - 1] > xs[j]; j--) { float t = xs[j]; xs[j] = xs[j - 1]; xs[j - 1] = t; }
+      for (uint8_t m = 0; m + 1 < k; m += 2) {
+        // centre de la colonne c : ANG_MIN + c*ANG_STEP + ANG_STEP/2
+        int c0 = int(ceilf((xs[m] - ANG_MIN - ANG_STEP / 2.0f) / ANG_STEP)), c1 = int(floorf((xs[m + 1] - ANG_MIN - ANG_STEP / 2.0f) / ANG_STEP));
+        if (c0 < 0) c0 = 0;
+        if (c1 > COLS - 1) c1 = COLS - 1;
+        for (int c = c0; c <= c1; c++) s_grid[r][c >> 1] |= uint8_t(bit << ((c & 1) * 4));
+      }
+    }
+  }
+
+  static void build(){
+    memset(s_grid, 0, sizeof(s_grid)); s_count = s_ignore = 0;
+    for (uint8_t i = 0; i < MAX_ZONES; i++) {
+      if (!s_z[i].n) continue;
+      raster(uint8_t(1u << i), s_z[i]);
+      (s_z[i].kind == K_IGNORE ? s_ignore : s_count) |= uint8_t(1u << i);
+    }
+  }
+
+  bool set(uint8_t i, const Zone& z){
+    if (i >= MAX_ZONES || (z.n && z.n < 3) || z.n > MAX_PTS || z.kind >= K_COUNT_KINDS) return false;
+    s_z[i] = z; s_z[i].name[NAME_LEN - 1] = 0;
+    for (char* c = s_z[i].name; *c; c++) if (*c == '|' || *c == '"' || *c == '\\' || *c < ' ') *c = '_';   // config.txt / JSON
+    build();
+    return true;
+  }
+  const Zone& get(uint8_t i){ return s_z[i < MAX_ZONES ? i : 0]; }
+
+  uint8_t lookup(int8_t angle, uint8_t dist_m){
+    int c = (int(angle) - ANG_MIN) / ANG_STEP; if (c < 0) c = 0; else if (c > COLS - 1) c = COLS - 1;
+    const uint8_t r = dist_m < ROWS ? dist_m : ROWS - 1;
+    return (s_grid[r][c >> 1] >> ((c & 1) * 4)) & 0x0F;
+  }
+  bool    keep(uint8_t mask){ return !(mask & s_ignore) && (!s_count || (mask & s_count)); }
+  uint8_t countMask(){ return s_count; }
+  uint8_t active(){ return uint8_t(__builtin_popcount(s_count | s_ignore)); }
+
+  bool parsePts(const char* s, Zone& z){
+    z.n = 0;
+    while (s && *s) {
+      char* e; long a = strtol(s, &e, 10); if (e == s || *e != ',') return false;
+      s = e + 1; long d = strtol(s, &e, 10); if (e == s) return false;
+      if (z.n == MAX_PTS || a < -90 || a > 90 || d < 0 || d > 255) return false;
+      z.pts[z.n].angle = int8_t(a); z.pts[z.n].dist_m = uint8_t(d); z.n++;
+      s = e; while (*s == ';' || *s == ' ') s++;
+    }
+    return z.n == 0 || z.n >= 3;
+  }
+
+  bool parse(const char* s, Zone& z){
+    z = Zone();
+    const char* p1 = strchr(s, '|'); if (!p1) return false;
+    const char* p2 = strchr(p1 + 1, '|'); if (!p2) return false;
+    char kind[12]; size_t n = size_t(p1 - s); if (n >= sizeof(kind)) return false;
+    memcpy(kind, s, n); kind[n] = 0; z.kind = kindFromName(kind);
+    n = size_t(p2 - p1 - 1); if (n >= NAME_LEN) n = NAME_LEN - 1;
+    memcpy(z.name, p1 + 1, n); z.name[n] = 0;
+    return parsePts(p2 + 1, z);
+  }
+
+  size_t formatPts(const Zone& z, char* out, size_t cap){
+    size_t w = 0; if (cap) out[0] = 0;
+    for (uint8_t i = 0; i < z.n && w < cap; i++) {
+      int k = snprintf(out + w, cap - w, "%s%d,%u", i ? ";" : "", (int)z.pts[i].angle, (unsigned)z.pts[i].dist_m);
+      if (k < 0) break;
+      w += size_t(k);
+    }
+    return w < cap ? w : (cap ? cap - 1 : 0);
+  }
+
+  size_t format(const Zone& z, char* out, size_t cap){
+    int k = snprintf(out, cap, "%s|%s|", kindName(z.kind), z.name);
+    if (k < 0 || size_t(k) >= cap) return 0;
+    return size_t(k) + formatPts(z, out + k, cap - size_t(k));
+  }
+
+  const char* kindName(uint8_t k){ return k == K_IGNORE ? "ignore" : "count"; }
+  uint8_t kindFromName(const char* s){ return strcmp(s, "ignore") == 0 ? K_IGNORE : K_COUNT; }
+}
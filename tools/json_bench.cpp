@@ -0,0 +1,135 @@
+// Bench hôte de l'écriture JSON (src/json_out.cpp) : allocations et coût par payload,
+// avant (concaténation de chaînes, comme les String Arduino de main.cpp) / après (JsonOut).
+//
+// Build :  g++ -O2 -std=c++17 -Iinclude tools/json_bench.cpp src/json_out.cpp -o json_bench
+// Usage :  ./json_bench [--iter N]
+//
+// Les allocations sont comptées par surcharge globale de operator new. Le modèle
+// « avant » utilise std::string, dont la petite chaîne interne (15 o) évite déjà
+// des allocations que String fait sur l'ESP32 : c'est une borne basse.
+// Chaque payload « après » est comparé octet pour octet à sa version « avant ».
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <new>
+#include <string>
+#include "json_out.h"
+
+static uint64_t g_allocs = 0;
+void* operator new(size_t n){ g_allocs++; void* p = malloc(n ? n : 1); if (!p) throw std::bad_alloc(); return p; }
+void* operator new[](size_t n){ g_allocs++; void* p = malloc(n ? n : 1); if (!p) throw std::bad_alloc(); return p; }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+static uint64_t nowNs(){ timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts); return uint64_t(ts.tv_sec) * 1000000000ULL + ts.tv_nsec; }
+static std::string S(long v){ return std::to_string(v); }
+static std::string S(float v, int dec){ char b[24]; snprintf(b, sizeof(b), "%.*f", dec, v); return b; }
+
+// Données d'exemple (mêmes champs que main.cpp)
+struct Pass { const char* ts; uint8_t dir, speed_kmh, speed_raw, dist_m, dist_out, snr, zone; uint16_t dwell_ds; int8_t angle; };
+static const Pass P = { "2026-10-16 08:42:17", 1, 57, 52, 31, 4, 9, 2, 23, -12 };
+static const char* ID = "A4CF12F0";
+static const std::string BASE = std::string("radar/") + ID;
+
+// ---- /last (mqttPublishPass)
+static std::string lastBefore(){
+  return std::string("{\"ts\":\"") + P.ts + "\",\"dir\":" + (P.dir ? S(1) : S(0)) +
+         ",\"speed_kmh\":" + S(P.speed_kmh) + ",\"speed_raw\":" + S(P.speed_raw) + ",\"dist_m\":" + S(P.dist_m) + ",\"dist_out\":" + S(P.dist_out) +
+         ",\"dwell_s\":" + S(P.dwell_ds / 10.0f, 1) + ",\"angle\":" + S(P.angle) + ",\"snr\":" + S(P.snr) + ",\"zone\":" + S(P.zone) + "}";
+}
+static void lastAfter(JsonOut& j){
+  j.obj().key("ts").str(P.ts).key("dir").u(P.dir ? 1 : 0).key("speed_kmh").u(P.speed_kmh).key("speed_raw").u(P.speed_raw).key("dist_m").u(P.dist_m).key("dist_out").u(P.dist_out)
+   .key("dwell_s").fix(P.dwell_ds, 1).key("angle").i(P.angle).key("snr").u(P.snr).key("zone").u(P.zone).end();
+}
+
+// ---- découverte HA, capteur vitesse (publishHAConfig)
+static std::string topic(const std::string& leaf){ return BASE + "/" + leaf; }
+static std::string haBefore(){
+  std::string id = ID;
+  std::string device = std::string("{\"identifiers\":[\"RADAR-") + id + "\"],\"name\":\"LD2451 Radar " + id + "\",\"manufacturer\":\"DIY\",\"model\":\"HLK-LD2451\"}";
+  return std::string("{\"name\":\"Radar Speed\",\"uniq_id\":\"radar_") + id + std::string("_speed\",\"stat_t\":\"") + topic("last") + std::string("\",\"json_attr_t\":\"") + topic("last") +
+         std::string("\",\"unit_of_meas\":\"km/h\",\"val_tpl\":\"{{ value_json.speed_kmh }}\",\"avty_t\":\"") + topic("status") +
+         std::string("\",\"pl_avail\":\"online\",\"pl_not_avail\":\"offline\",\"device\":") + device + "}";
+}
+static char T_LAST[80], T_STATUS[80], CLIENT[20], UQ[48], DN[40];   // précalculés (mqttTopicsBuild)
+static void haAfter(JsonOut& j){
+  j.obj().key("name").str("Radar Speed").key("uniq_id").str(UQ).key("stat_t").str(T_LAST).key("json_attr_t").str(T_LAST)
+   .key("unit_of_meas").str("km/h").key("val_tpl").str("{{ value_json.speed_kmh }}")
+   .key("avty_t").str(T_STATUS).key("pl_avail").str("online").key("pl_not_avail").str("offline")
+   .key("device").obj().key("identifiers").arr().str(CLIENT).end().key("name").str(DN).key("manufacturer").str("DIY").key("model").str("HLK-LD2451").end()
+   .end();
+}
+
+// ---- /api/cfg/get (handleCfgGet)
+static std::string cfgBefore(){
+  std::string j = "{";
+  j += "\"det\":{\"max\":" + S(20) + ",\"dir\":" + S(2) + ",\"minspd\":" + S(0) + ",\"delay\":" + S(2) + "},";
+  j += "\"sens\":{\"trig\":" + S(1) + ",\"snr\":" + S(4) + "},";
+  j += "\"baudIdx\":" + S(5) + ",";
+  j += "\"applyBoot\":" + S(1) + "}";
+  return j;
+}
+static void cfgAfter(JsonOut& j){
+  j.obj().key("det").obj().key("max").u(20).key("dir").u(2).key("minspd").u(0).key("delay").u(2).end()
+   .key("sens").obj().key("trig").u(1).key("snr").u(4).end().key("baudIdx").i(5).key("applyBoot").u(1).end();
+}
+
+// ---- /api/power/diag (handlePowerDiag)
+static std::string diagBefore(){
+  return std::string("{\"cpu_cfg\":") + S(80) + ",\"cpu_cur\":" + S(80) + ",\"mdns_cfg\":" + std::string("true") + ",\"wifi_sleep_cfg\":" + std::string("true") +
+         ",\"wifi_sleep_rt\":" + std::string("true") + ",\"wifi_ps\":" + S(1) + ",\"ld2451_ok\":" + std::string("true") + ",\"gpio\":" + S(-1) +
+         ",\"gpio_lvl\":" + S(-1) + ",\"gpio_active\":" + std::string("false") + "}";
+}
+static void diagAfter(JsonOut& j){
+  j.obj().key("cpu_cfg").u(80).key("cpu_cur").u(80).key("mdns_cfg").b(true).key("wifi_sleep_cfg").b(true).key("wifi_sleep_rt").b(true)
+   .key("wifi_ps").i(1).key("ld2451_ok").b(true).key("gpio").i(-1).key("gpio_lvl").i(-1).key("gpio_active").b(false).end();
+}
+
+struct Case { const char* name; std::string (*before)(); void (*after)(JsonOut&); };
+static const Case CASES[] = {
+  { "mqtt last",      lastBefore, lastAfter },
+  { "ha discovery",   haBefore,   haAfter   },
+  { "api/cfg/get",    cfgBefore,  cfgAfter  },
+  { "api/power/diag", diagBefore, diagAfter },
+};
+
+int main(int argc, char** argv){
+  unsigned iter = 200000;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--iter") && i + 1 < argc) iter = unsigned(atoi(argv[++i]));
+    else { fprintf(stderr, "option inconnue %s\n", argv[i]); return 2; }
+  }
+  snprintf(T_LAST, sizeof(T_LAST), "%s/last", BASE.c_str()); snprintf(T_STATUS, sizeof(T_STATUS), "%s/status", BASE.c_str());
+  snprintf(CLIENT, sizeof(CLIENT), "RADAR-%s", ID); snprintf(UQ, sizeof(UQ), "radar_%s_speed", ID); snprintf(DN, sizeof(DN), "LD2451 Radar %s", ID);
+
+  int rc = 0; volatile size_t sink = 0;
+  printf("%-15s %6s %12s %12s %10s %10s\n", "payload", "octets", "alloc avant", "alloc apres", "ns avant", "ns apres");
+  for (const Case& c : CASES) {
+    char buf[640]; JsonOut j(buf, sizeof(buf)); c.after(j);
+    const std::string ref = c.before();
+    if (!j.ok() || ref != j.c_str()) { printf("%s : DIFFERENT\n  avant %s\n  apres %s\n", c.name, ref.c_str(), j.c_str()); rc = 1; continue; }
+
+    uint64_t a0 = g_allocs, t0 = nowNs();
+    for (unsigned k = 0; k < iter; k++) sink += c.before().size();
+    const uint64_t tb = nowNs() - t0, ab = g_allocs - a0;
+    a0 = g_allocs; t0 = nowNs();
+    for (unsigned k = 0; k < iter; k++) { JsonOut w(buf, sizeof(buf)); c.after(w); sink += w.size(); }
+    const uint64_t ta = nowNs() - t0, aa = g_allocs - a0;
+    printf("%-15s %6u %12.1f %12.1f %10.0f %10.0f\n", c.name, (unsigned)ref.size(), double(ab) / iter, double(aa) / iter, double(tb) / iter, double(ta) / iter);
+  }
+
+  // Flux : 2000 passages vers un sink (réponse chunkée /api/passes) avec un tampon de 1 Ko
+  struct Cnt { size_t bytes, chunks; } cnt = { 0, 0 };
+  char buf[1024];
+  const uint64_t a0 = g_allocs;
+  JsonOut j(buf, sizeof(buf), [](void* ctx, const char*, size_t n){ Cnt* k = (Cnt*)ctx; k->bytes += n; k->chunks++; }, &cnt);
+  j.obj().key("passes").arr();
+  for (uint32_t s = 1; s <= 2000; s++) lastAfter(j);
+  j.end().end(); j.flush();
+  printf("flux 2000 passages : %lu octets en %lu chunks, %lu allocation(s)\n", (unsigned long)cnt.bytes, (unsigned long)cnt.chunks, (unsigned long)(g_allocs - a0));
+  return rc;
+}
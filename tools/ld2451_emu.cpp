@@ -0,0 +1,278 @@
+// Émulateur HLK-LD2451 pour Linux (PTY) — rejeu, charge et injection de défauts.
+//
+// Build :  g++ -O2 -std=c++17 -Iinclude tools/ld2451_emu.cpp -o ld2451_emu
+// Usage :  ./ld2451_emu [options]        -> affiche le chemin /dev/pts/N à ouvrir
+//
+//   --rate HZ          trames DATA par seconde (défaut 10, 0 = aucune)
+//   --targets N        cibles par trame (défaut 1, max 100)
+//   --baud B           débit simulé : cadence l'émission au temps-fil réel (défaut 115200)
+//   --replay FILE      rejoue un CSV au format /passes.csv (epoch,...,direction,speed,dist,angle,snr)
+//   --speedup X        accélère le rejeu (défaut 1)
+//   --frames K         trames DATA émises par ligne rejouée (défaut 3)
+//   --echo             renvoie l'écho de chaque commande reçue avant l'ACK
+//   --bad-tail PCT     % de trames émises avec un tail corrompu
+//   --truncate PCT     % de trames tronquées (coupées au milieu)
+//   --garbage PCT      % de trames précédées d'octets aléatoires
+//   --ack-delay MS     retard avant chaque ACK
+//   --seed S           graine du générateur pseudo-aléatoire
+//   --bench MB         mesure hors-PTY du débit du parseur RadarRx::Ring puis quitte
+//
+// Statistiques (trames, commandes, latence ENABLE→END) sur stderr toutes les 5 s et à Ctrl-C.
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+#include <time.h>
+#include <vector>
+#include <deque>
+#include <string>
+#include "ld2451_proto.h"
+#include "radar_rx.h"
+
+static volatile sig_atomic_t g_stop = 0;
+static void onSig(int){ g_stop = 1; }
+
+static uint64_t nowUs(){ timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts); return uint64_t(ts.tv_sec)*1000000u + ts.tv_nsec/1000; }
+static uint32_t rnd(){ static uint32_t x = 2463534242u; x ^= x << 13; x ^= x >> 17; x ^= x << 5; return x; }
+static void seed(uint32_t s){ while (!s) s = 1; for (uint32_t i = 0; i < s % 97 + 1; i++) rnd(); }
+static bool chance(int pct){ return pct > 0 && int(rnd() % 100) < pct; }
+
+struct Opts {
+  double rate = 10; int targets = 1; uint32_t baud = 115200;
+  const char* replay = nullptr; double speedup = 1; int framesPerRow = 3;
+  bool echo = false; int badTail = 0, truncate = 0, garbage = 0; uint32_t ackDelayMs = 0;
+  uint32_t seed = 1; double benchMB = 0;
+};
+
+struct Target { int8_t angle; uint8_t dist, dir, speed, snr; };
+
+// ---------------------------------------------------------------- trames
+static std::vector<uint8_t> dataFrame(const std::vector<Target>& t){
+  std::vector<uint8_t> f(DAT_HDR, DAT_HDR + 4);
+  uint16_t L = uint16_t(2 + 5 * t.size());
+  f.push_back(uint8_t(L)); f.push_back(uint8_t(L >> 8));
+  f.push_back(uint8_t(t.size())); f.push_back(t.empty() ? 0 : 1);      // nb cibles, alarme
+  for (const auto& x : t){ f.push_back(uint8_t(int(x.angle) + 0x80)); f.push_back(x.dist); f.push_back(x.dir); f.push_back(x.speed); f.push_back(x.snr); }
+  f.insert(f.end(), DAT_TAIL, DAT_TAIL + 4);
+  return f;
+}
+static std::vector<uint8_t> ackFrame(uint16_t cmd, uint16_t status, const std::vector<uint8_t>& ret){
+  std::vector<uint8_t> f(CMD_HDR, CMD_HDR + 4);
+  uint16_t L = uint16_t(2 + 2 + ret.size());
+  uint16_t ac = uint16_t(cmd | 0x0100);
+  f.push_back(uint8_t(L)); f.push_back(uint8_t(L >> 8));
+  f.push_back(uint8_t(ac)); f.push_back(uint8_t(ac >> 8));
+  f.push_back(uint8_t(status)); f.push_back(uint8_t(status >> 8));
+  f.insert(f.end(), ret.begin(), ret.end());
+  f.insert(f.end(), CMD_TAIL, CMD_TAIL + 4);
+  return f;
+}
+// Applique les défauts demandés à une trame sortante.
+static std::vector<uint8_t> withFaults(std::vector<uint8_t> f, const Opts& o, uint32_t* nFaults){
+  if (chance(o.garbage)){ std::vector<uint8_t> g(1 + rnd() % 16); for (auto& b : g) b = uint8_t(rnd()); f.insert(f.begin(), g.begin(), g.end()); (*nFaults)++; }
+  if (chance(o.badTail)){ f.back() ^= 0xFF; (*nFaults)++; }
+  if (chance(o.truncate) && f.size() > 8){ f.resize(4 + rnd() % (f.size() - 4)); (*nFaults)++; }
+  return f;
+}
+
+// ---------------------------------------------------------------- état radar
+struct Radar {
+  uint8_t det[4]  = {20, 2, 0, 2};   // maxDist, dirMode, minSpeed, noTargetDelay
+  uint8_t sens[4] = {1, 4, 0, 0};    // trigCount, snrLevel, ext1, ext2
+  uint16_t baudIdx = 5;
+  bool cfg = false;
+};
+
+struct Stats {
+  uint64_t framesData = 0, bytesOut = 0, faults = 0, cmds = 0, echoes = 0, badCmd = 0;
+  uint64_t sessions = 0, sessionUsSum = 0, sessionUsMax = 0;
+  uint32_t perCmd[256] = {0};
+};
+
+// Répond à une commande ; status=1 hors session de configuration ou si invalide.
+static std::vector<uint8_t> handleCmd(Radar& r, uint16_t cmd, const uint8_t* v, size_t n){
+  auto ok  = [&](std::vector<uint8_t> ret = {}){ return ackFrame(cmd, 0, ret); };
+  auto bad = [&](){ return ackFrame(cmd, 1, {}); };
+  if (cmd != CMD_ENABLE_CFG && !r.cfg) return bad();
+  switch (cmd){
+    case CMD_ENABLE_CFG:   r.cfg = true;  return ok({0x01, 0x00, 0x40, 0x00});      // version protocole, taille buffer
+    case CMD_END_CFG:      r.cfg = false; return ok();
+    case CMD_GET_DET:      return ok(std::vector<uint8_t>(r.det, r.det + 4));
+    case CMD_GET_SENS:     return ok(std::vector<uint8_t>(r.sens, r.sens + 4));
+    case CMD_SET_DET:      if (n < 4) return bad(); memcpy(r.det, v, 4);  return ok();
+    case CMD_SET_SENS:     if (n < 4) return bad(); memcpy(r.sens, v, 4); return ok();
+    case CMD_READ_VERSION: return ok({0x51, 0x24, 0x01, 0x02, 0x25, 0x08, 0x27, 0x00});
+    case CMD_SET_BAUD:     if (n < 2 || v[0] < 1 || v[0] > 8) return bad(); r.baudIdx = v[0]; return ok();
+    case CMD_REBOOT:       r.cfg = false; return ok();
+    case CMD_FACTORY_RST:  { Radar d; memcpy(r.det, d.det, 4); memcpy(r.sens, d.sens, 4); r.baudIdx = d.baudIdx; return ok(); }
+    default:               return bad();
+  }
+}
+
+// ---------------------------------------------------------------- rejeu CSV
+static std::vector<std::pair<uint32_t, Target>> loadReplay(const char* path){
+  std::vector<std::pair<uint32_t, Target>> rows;
+  FILE* f = fopen(path, "r");
+  if (!f){ fprintf(stderr, "replay: cannot open %s: %s\n", path, strerror(errno)); exit(1); }
+  char line[256];
+  while (fgets(line, sizeof(line), f)){
+    long epoch; char dt[64], dir[16]; unsigned spd, dist, snr; int ang;
+    if (sscanf(line, "%ld,%63[^,],%15[^,],%u,%u,%d,%u", &epoch, dt, dir, &spd, &dist, &ang, &snr) != 7) continue;   // en-tête ou ligne invalide
+    Target t{ int8_t(ang), uint8_t(dist), uint8_t(strcmp(dir, "approach") == 0 ? 1 : 0), uint8_t(spd), uint8_t(snr) };
+    rows.push_back({ uint32_t(epoch), t });
+  }
+  fclose(f);
+  fprintf(stderr, "replay: %zu rows from %s\n", rows.size(), path);
+  return rows;
+}
+
+static Target randomTarget(){
+  return Target{ int8_t(int(rnd() % 61) - 30), uint8_t(2 + rnd() % 60), uint8_t(rnd() & 1), uint8_t(5 + rnd() % 90), uint8_t(100 + rnd() % 156) };
+}
+
+// ---------------------------------------------------------------- bench parseur
+static int bench(const Opts& o){
+  std::vector<uint8_t> stream; uint32_t nf = 0, frames = 0;
+  size_t want = size_t(o.benchMB * 1024 * 1024);
+  while (stream.size() < want){
+    std::vector<Target> t; for (int i = 0; i < o.targets; i++) t.push_back(randomTarget());
+    auto f = withFaults(dataFrame(t), o, &nf);
+    stream.insert(stream.end(), f.begin(), f.end()); frames++;
+  }
+  static RadarRx::Ring<4096> ring; RadarRx::Frame fr; uint64_t got = 0;
+  uint64_t t0 = nowUs();
+  for (size_t off = 0; off < stream.size(); off += 128){
+    size_t n = std::min<size_t>(128, stream.size() - off);
+    ring.push(stream.data() + off, n);
+    while (ring.next(fr)){ got++; ring.release(fr); }
+  }
+  uint64_t us = nowUs() - t0; const auto& s = ring.stats();
+  printf("bench: %zu bytes, %u frames sent (%u faulted), %llu parsed in %.1f ms -> %.1f MB/s, %.1f ns/byte\n",
+         stream.size(), frames, nf, (unsigned long long)got, us / 1000.0, stream.size() / (us ? double(us) : 1.0), us * 1000.0 / stream.size());
+  printf("bench: resync=%u bad_tail=%u bad_len=%u overflow=%u\n", s.resync_bytes, s.bad_tail, s.bad_len, s.overflow_drops);
+  return 0;
+}
+
+// ---------------------------------------------------------------- main
+static void usage(){ fprintf(stderr, "see header of tools/ld2451_emu.cpp for options\n"); exit(2); }
+
+int main(int argc, char** argv){
+  Opts o;
+  for (int i = 1; i < argc; i++){
+    std::string a = argv[i];
+    auto val = [&](){ if (i + 1 >= argc) usage(); return argv[++i]; };
+    if      (a == "--rate")      o.rate = atof(val());
+    else if (a == "--targets")   o.targets = std::max(0, std::min(100, atoi(val())));
+    else if (a == "--baud")      o.baud = uint32_t(atol(val()));
+    else if (a == "--replay")    o.replay = val();
+    else if (a == "--speedup")   o.speedup = std::max(0.001, atof(val()));
+    else if (a == "--frames")    o.framesPerRow = std::max(1, atoi(val()));
+    else if (a == "--echo")      o.echo = true;
+    else if (a == "--bad-tail")  o.badTail = atoi(val());
+    else if (a == "--truncate")  o.truncate = atoi(val());
+    else if (a == "--garbage")   o.garbage = atoi(val());
+    else if (a == "--ack-delay") o.ackDelayMs = uint32_t(atol(val()));
+    else if (a == "--seed")      o.seed = uint32_t(atol(val()));
+    else if (a == "--bench")     o.benchMB = atof(val());
+    else usage();
+  }
+  seed(o.seed);
+  if (o.benchMB > 0) return bench(o);
+
+  int m = posix_openpt(O_RDWR | O_NOCTTY);
+  if (m < 0 || grantpt(m) || unlockpt(m)){ perror("pty"); return 1; }
+  termios tio; tcgetattr(m, &tio); cfmakeraw(&tio); tcsetattr(m, TCSANOW, &tio);
+  fcntl(m, F_SETFL, fcntl(m, F_GETFL) | O_NONBLOCK);
+  printf("%s\n", ptsname(m)); fflush(stdout);
+  // Garde le côté esclave ouvert : pas de EIO tant qu'aucun client n'est connecté.
+  int keep = open(ptsname(m), O_RDWR | O_NOCTTY);
+  signal(SIGINT, onSig); signal(SIGTERM, onSig);
+
+  Radar radar; Stats st;
+  auto replay = o.replay ? loadReplay(o.replay) : std::vector<std::pair<uint32_t, Target>>{};
+  size_t replayIdx = 0; int replayLeft = 0; Target replayT{};
+  uint64_t replayBase = nowUs(), replayNext = replayBase;
+
+  static RadarRx::Ring<4096> in;                 // commandes reçues (même découpeur que le firmware)
+  std::deque<uint8_t> out;                       // octets en attente, cadencés au débit simulé
+  struct Pending { uint64_t due; std::vector<uint8_t> f; };
+  std::deque<Pending> acks;
+  double usPerByte = 10e6 / double(o.baud ? o.baud : 115200);      // 10 bits/octet (8N1)
+  uint64_t wireFreeAt = nowUs(), nextData = nowUs(), nextStat = nowUs() + 5000000, sessionT0 = 0;
+
+  auto queue = [&](const std::vector<uint8_t>& f){ out.insert(out.end(), f.begin(), f.end()); };
+
+  while (!g_stop){
+    uint64_t now = nowUs();
+
+    // 1) Trames DATA : charge synthétique ou rejeu
+    if (o.replay){
+      if (!replayLeft && replayIdx < replay.size()){
+        uint64_t at = replayBase + uint64_t((replay[replayIdx].first - replay[0].first) * 1e6 / o.speedup);
+        if (now >= at){ replayT = replay[replayIdx++].second; replayLeft = o.framesPerRow; replayNext = now; }
+      }
+      if (replayLeft && now >= replayNext){
+        uint32_t nf = 0; queue(withFaults(dataFrame({ replayT }), o, &nf)); st.faults += nf; st.framesData++; replayLeft--;
+        replayNext = now + uint64_t(1e6 / (o.rate > 0 ? o.rate : 10));
+      }
+      if (replayIdx >= replay.size() && !replayLeft && out.empty()){ fprintf(stderr, "replay: done\n"); break; }
+    } else if (o.rate > 0 && now >= nextData){
+      std::vector<Target> t; for (int i = 0; i < o.targets; i++) t.push_back(randomTarget());
+      uint32_t nf = 0; queue(withFaults(dataFrame(t), o, &nf)); st.faults += nf; st.framesData++;
+      nextData += uint64_t(1e6 / o.rate); if (nextData < now) nextData = now;
+    }
+
+    // 2) ACK différés arrivés à échéance
+    while (!acks.empty() && acks.front().due <= now){ queue(acks.front().f); acks.pop_front(); }
+
+    // 3) Émission cadencée au temps-fil
+    if (!out.empty() && now >= wireFreeAt){
+      size_t budget = std::max<size_t>(1, size_t((now - wireFreeAt) / usPerByte) + 1);
+      uint8_t buf[512]; size_t n = 0;
+      while (n < sizeof(buf) && n < budget && !out.empty()){ buf[n++] = out.front(); out.pop_front(); }
+      ssize_t w = write(m, buf, n);
+      if (w > 0){ st.bytesOut += w; wireFreeAt = now + uint64_t(w * usPerByte); }
+      if (w < ssize_t(n)) out.insert(out.begin(), buf + (w > 0 ? w : 0), buf + n);
+    }
+
+    // 4) Réception des commandes
+    pollfd pfd{ m, POLLIN, 0 };
+    poll(&pfd, 1, 1);
+    if (pfd.revents & POLLIN){
+      uint8_t buf[256]; ssize_t r = read(m, buf, sizeof(buf));
+      if (r > 0) in.push(buf, size_t(r));
+      RadarRx::Frame f; uint8_t scratch[4 + 2 + DAT_MAX_LEN + 4];
+      while (in.next(f)){
+        if (f.kind == RadarRx::ACK){
+          const uint8_t* p = f.raw.linear(scratch);
+          uint16_t cmd = uint16_t(p[6] | (p[7] << 8));
+          st.cmds++; st.perCmd[cmd & 0xFF]++;
+          if (o.echo){ queue(std::vector<uint8_t>(p, p + f.raw.size())); st.echoes++; }
+          if (cmd == CMD_ENABLE_CFG) sessionT0 = now;
+          if (cmd == CMD_END_CFG && sessionT0){ uint64_t d = now - sessionT0; st.sessions++; st.sessionUsSum += d; if (d > st.sessionUsMax) st.sessionUsMax = d; sessionT0 = 0; }
+          auto ack = handleCmd(radar, cmd, p + 8, f.len - 2);
+          uint32_t nf = 0; ack = withFaults(ack, o, &nf); st.faults += nf;
+          acks.push_back({ now + uint64_t(o.ackDelayMs) * 1000, ack });
+          fprintf(stderr, "[CMD] 0x%04X len=%u -> ack in %u ms\n", cmd, f.len, o.ackDelayMs);
+        } else st.badCmd++;
+        in.release(f);
+      }
+    }
+
+    if (now >= nextStat || g_stop){
+      nextStat = now + 5000000;
+      fprintf(stderr, "[STAT] data=%llu bytes=%llu faults=%llu cmds=%llu echoes=%llu cfg_sessions=%llu avg=%.1fms max=%.1fms rx_resync=%u\n",
+              (unsigned long long)st.framesData, (unsigned long long)st.bytesOut, (unsigned long long)st.faults,
+              (unsigned long long)st.cmds, (unsigned long long)st.echoes, (unsigned long long)st.sessions,
+              st.sessions ? st.sessionUsSum / 1000.0 / st.sessions : 0.0, st.sessionUsMax / 1000.0, in.stats().resync_bytes);
+    }
+  }
+  close(keep); close(m);
+  return 0;
+}
@@ -0,0 +1,365 @@
+// Banc MQTT sous Linux : broker minimal (remplaçant local) et simulation du côté
+// firmware (file d'envoi src/mqtt_outbox.cpp, payloads src/json_out.cpp et src/pass_pack.cpp).
+//
+// Build :  g++ -O2 -std=c++17 -pthread -Iinclude tools/mqtt_sim.cpp src/mqtt_outbox.cpp src/json_out.cpp src/pass_pack.cpp -o mqtt_sim
+//
+//   ./mqtt_sim broker [--port P] [--outage UP,DOWN] [--hang] [-v]
+//       MQTT 3.1.1 QoS 0 (CONNECT, PUBLISH, PINGREQ, DISCONNECT). Vérifie la suite des
+//       "seq" publiés sur */last, ou des lots */batch (bin ou json) en mode groupé : trous
+//       (passages perdus), doublons (rejeu après reboot), désordre.
+//       --outage : broker arrêté DOWN s toutes les UP s (sockets fermés ; avec --hang, le
+//       port reste ouvert mais plus rien n'est lu : TCP accepté, jamais de CONNACK, comme
+//       un broker figé ou un lien qui perd les paquets).
+//       Bilan toutes les 10 s et à l'arrêt (Ctrl-C). -v : chaque message.
+//
+//   ./mqtt_sim device [--host H] [--port P] [--vph N] [--seconds S] [--rate R] [--state F]
+//                     [--batch S] [--fmt json|bin] [--tail MS] [--sync]
+//       Passages simulés (Poisson, N/h) -> historique (RingStore 2000) -> MqttOutbox ->
+//       PUBLISH */last + */count comme main.cpp. --state F : historique et curseur
+//       persistés dans F et F.ack (relancer le device = reboot). --batch S : mode groupé
+//       (lots */batch de 32 max, fenêtre S s). Connexion dans un thread à part avec
+//       attente exponentielle + gigue (comme MqttLink) ; --sync : connexion bloquante dans
+//       la boucle toutes les 5 s (ancien mqttEnsureConnected()). Latence de boucle : max
+//       et nombre d'itérations > 20 ms.
+//       Temps radio estimé (modèle, pas une mesure) : par réveil (itération de vidage qui
+//       émet, ou PINGREQ) MS ms de queue radio (défaut 50, modem-sleep Wi-Fi), + 1 ms par
+//       paquet, + octets (trame + ~90 o TCP/IP/802.11 par paquet) à 6 Mb/s.
+//
+// Test de coupure :  ./mqtt_sim broker --outage 30,20 &  ./mqtt_sim device --vph 3600 --seconds 120
+//   -> le broker doit finir sans trou ni désordre ; le device affiche profondeur et débit de vidage.
+// Test de latence :  ./mqtt_sim broker --outage 20,20 --hang &  ./mqtt_sim device --seconds 120 [--sync]
+//   -> sans --sync, la boucle reste à quelques ms pendant les coupures.
+// Comparaison :      ./mqtt_sim device --vph 1200 --seconds 300 [--batch 60 --fmt bin]
+//   -> ms radio et octets par 100 passages.
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <thread>
+#include "passage.h"
+#include "ring_store.h"
+#include "mqtt_outbox.h"
+#include "json_out.h"
+#include "pass_pack.h"
+#include "backoff.h"
+
+static uint32_t nowMs(){ timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts); return uint32_t(ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000); }
+static volatile bool g_stop = false;
+static void onSig(int){ g_stop = true; }
+
+// ---- Trames MQTT
+static size_t putLen(uint8_t* p, size_t n){ size_t k = 0; do { uint8_t b = n & 0x7F; n >>= 7; p[k++] = uint8_t(b | (n ? 0x80 : 0)); } while (n); return k; }
+static size_t putStr(uint8_t* p, const char* s, size_t n){ p[0] = uint8_t(n >> 8); p[1] = uint8_t(n); memcpy(p + 2, s, n); return n + 2; }
+// Décode une trame complète en tête de buf : longueur totale, 0 si incomplète
+static size_t frame(const std::vector<uint8_t>& b, uint8_t& type, size_t& hdr, size_t& len){
+  if (b.size() < 2) return 0;
+  len = 0; size_t i = 1; uint32_t mul = 1;
+  for (;; i++) { if (i >= b.size() || i > 4) return 0; len += (b[i] & 0x7F) * mul; mul <<= 7; if (!(b[i] & 0x80)) break; }
+  hdr = i + 1; type = b[0] >> 4;
+  return b.size() >= hdr + len ? hdr + len : 0;
+}
+static bool sendAll(int fd, const uint8_t* p, size_t n){
+  while (n) { ssize_t k = send(fd, p, n, MSG_NOSIGNAL); if (k <= 0) return false; p += k; n -= size_t(k); }
+  return true;
+}
+
+// ================================ BROKER ================================
+struct Cli { int fd; std::vector<uint8_t> in; std::string id; };
+struct SeqCheck {
+  uint32_t last = 0, msgs = 0, pass = 0, gaps = 0, missing = 0, dups = 0;
+  void add(uint32_t s, uint32_t n){   // n passages consécutifs à partir de s
+    msgs++; pass += n;
+    if (last && s <= last) { dups++; if (s + n - 1 > last) last = s + n - 1; return; }
+    if (last && s > last + 1) { gaps++; missing += s - last - 1; printf("[broker] TROU %u..%u\n", last + 1, s - 1); }
+    last = s + n - 1;
+  }
+};
+
+static int listenOn(uint16_t port){
+  int fd = socket(AF_INET, SOCK_STREAM, 0); int one = 1; setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  sockaddr_in a{}; a.sin_family = AF_INET; a.sin_port = htons(port); a.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(fd, (sockaddr*)&a, sizeof(a)) || listen(fd, 8)) { perror("bind/listen"); close(fd); return -1; }
+  return fd;
+}
+static uint32_t seqOf(const uint8_t* p, size_t n){
+  std::string s((const char*)p, n); size_t k = s.find("\"seq\":");
+  return k == std::string::npos ? 0 : uint32_t(strtoul(s.c_str() + k + 6, nullptr, 10));
+}
+
+// Lot */batch : (seq0, n) ; false si illisible
+static bool batchOf(const uint8_t* p, size_t n, uint32_t& seq0, uint32_t& cnt){
+  if (n && p[0] == PassPack::MAGIC) {
+    static Passage tmp[MqttOutbox::MAX_BATCH]; PassPack::Header h;
+    if (!PassPack::decode(p, n, h, tmp, MqttOutbox::MAX_BATCH)) return false;
+    seq0 = h.seq0; cnt = h.n; return true;
+  }
+  std::string s((const char*)p, n); const size_t k = s.find("\"p\":[");
+  seq0 = seqOf(p, n); cnt = 0;
+  if (!seq0 || k == std::string::npos) return false;
+  for (size_t i = k + 5; i < s.size(); i++) if (s[i] == '[') cnt++;
+  return cnt != 0;
+}
+
+static int runBroker(uint16_t port, uint32_t up, uint32_t down, bool hang, bool verbose){
+  int lfd = listenOn(port); if (lfd < 0) return 1;
+  std::vector<Cli> cl; SeqCheck sc, sb; uint32_t pubs = 0, conns = 0, bytes = 0, bad = 0;
+  uint32_t t0 = nowMs(), rep = t0; bool isDown = false;
+  printf("[broker] port %u%s\n", port, up ? " (coupures programmées)" : "");
+  // En mode groupé, */last ne porte que la fin de chaque lot : le contrôle se fait sur */batch
+  auto report = [&](){ const SeqCheck& c = sb.msgs ? sb : sc;
+                       printf("[broker] conn=%u pub=%u octets=%u | %s: %u msg, %u passages, seq %u, trous %u (%u manquants), doublons/désordre %u%s\n",
+                              conns, pubs, bytes, sb.msgs ? "batch" : "last", c.msgs, c.pass, c.last, c.gaps, c.missing, c.dups, bad ? " [lots illisibles]" : ""); fflush(stdout); };
+  while (!g_stop) {
+    const uint32_t now = nowMs();
+    if (up) {   // cycle UP s en service / DOWN s arrêté
+      const bool d = (now - t0) % ((up + down) * 1000) >= up * 1000;
+      if (d && !isDown) { for (auto& c : cl) close(c.fd); cl.clear(); if (!hang) { close(lfd); lfd = -1; } isDown = true; printf("[broker] ARRET%s\n", hang ? " (figé)" : ""); fflush(stdout); }
+      if (!d && isDown) {
+        if (hang) close(lfd);   // connexions en attente dans le backlog : abandonnées
+        lfd = listenOn(port); isDown = false; printf("[broker] REPRISE\n"); fflush(stdout); if (lfd < 0) return 1;
+      }
+    }
+    if (isDown && hang) { usleep(100000); continue; }
+    std::vector<pollfd> pf;
+    if (lfd >= 0) pf.push_back({ lfd, POLLIN, 0 });
+    for (auto& c : cl) pf.push_back({ c.fd, POLLIN, 0 });
+    poll(pf.data(), pf.size(), 100);
+    size_t k = 0;
+    if (lfd >= 0) { if (pf[0].revents & POLLIN) { int fd = accept(lfd, nullptr, nullptr); if (fd >= 0) { cl.push_back({ fd, {}, "" }); conns++; } } k = 1; }
+    for (size_t i = 0; i < cl.size() && k < pf.size(); i++, k++) {
+      if (!(pf[k].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+      uint8_t b[2048]; ssize_t n = recv(cl[i].fd, b, sizeof(b), 0);
+      if (n <= 0) { close(cl[i].fd); cl[i].fd = -1; continue; }
+      cl[i].in.insert(cl[i].in.end(), b, b + n);
+      uint8_t type; size_t hdr, len, tot;
+      while ((tot = frame(cl[i].in, type, hdr, len))) {
+        const uint8_t* p = cl[i].in.data() + hdr;
+        if (type == 1) {   // CONNECT -> CONNACK accepté
+          size_t pl = 10; cl[i].id.assign((const char*)p + pl + 2, (p[pl] << 8) | p[pl + 1]);
+          const uint8_t ack[4] = { 0x20, 2, 0, 0 }; sendAll(cl[i].fd, ack, 4);
+          printf("[broker] CONNECT %s\n", cl[i].id.c_str());
+        } else if (type == 3) {   // PUBLISH QoS 0
+          const size_t tl = (p[0] << 8) | p[1]; std::string topic((const char*)p + 2, tl);
+          const uint8_t* pay = p + 2 + tl; const size_t pn = len - 2 - tl;
+          pubs++; bytes += uint32_t(tot);
+          const bool isBatch = topic.size() > 6 && topic.compare(topic.size() - 6, 6, "/batch") == 0;
+          if (topic.size() > 5 && topic.compare(topic.size() - 5, 5, "/last") == 0) { const uint32_t s = seqOf(pay, pn); if (s && !sb.msgs) sc.add(s, 1); }
+          uint32_t s0 = 0, bn = 0;
+          if (isBatch) { if (batchOf(pay, pn, s0, bn)) sb.add(s0, bn); else bad++; }
+          if (verbose && isBatch) printf("[broker] %s seq %u x%u (%zu o)\n", topic.c_str(), s0, bn, pn);
+          else if (verbose) printf("[broker] %s %.*s\n", topic.c_str(), int(pn), (const char*)pay);
+        } else if (type == 12) { const uint8_t r[2] = { 0xD0, 0 }; sendAll(cl[i].fd, r, 2); }
+        else if (type == 14) { close(cl[i].fd); cl[i].fd = -1; cl[i].in.clear(); break; }
+        cl[i].in.erase(cl[i].in.begin(), cl[i].in.begin() + long(tot));
+      }
+    }
+    for (size_t i = cl.size(); i-- > 0; ) if (cl[i].fd < 0) cl.erase(cl.begin() + long(i));
+    if (now - rep >= 10000) { rep = now; report(); }
+  }
+  report();
+  return (sb.msgs ? sb : sc).gaps || bad ? 3 : 0;
+}
+
+// ================================ DEVICE ================================
+static RingStore<Passage, 2000> g_passes;
+static Passage g_mem[2000];
+
+struct Mqtt {
+  int fd = -1; uint32_t lastTx = 0;
+  uint32_t pkts = 0, bytes = 0, wakes = 0;   // modèle radio (hors connexion)
+  bool connected(){
+    if (fd < 0) return false;
+    pollfd p{ fd, POLLIN, 0 };
+    if (poll(&p, 1, 0) > 0) { uint8_t b[64]; ssize_t n = recv(fd, b, sizeof(b), MSG_DONTWAIT); if (n == 0 || (n < 0 && errno != EAGAIN)) drop(); }
+    return fd >= 0;
+  }
+  void drop(){ if (fd >= 0) close(fd); fd = -1; }
+  // Connexion bloquante bornée (comme PubSubClient::connect())
+  bool connect(const char* host, uint16_t port, uint32_t timeoutMs){
+    addrinfo hint{}, *ai; hint.ai_family = AF_INET; hint.ai_socktype = SOCK_STREAM;
+    char ps[8]; snprintf(ps, sizeof(ps), "%u", port);
+    if (getaddrinfo(host, ps, &hint, &ai)) return false;
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    int r = ::connect(fd, ai->ai_addr, ai->ai_addrlen); freeaddrinfo(ai);
+    pollfd p{ fd, POLLOUT, 0 };
+    if (r && (errno != EINPROGRESS || poll(&p, 1, int(timeoutMs)) <= 0)) { drop(); return false; }
+    int err = 0; socklen_t el = sizeof(err); getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &el);
+    if (err) { drop(); return false; }
+    fcntl(fd, F_SETFL, 0); int one = 1; setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    uint8_t b[64], v[48]; size_t n = 0;
+    const uint8_t hdr[10] = { 0, 4, 'M', 'Q', 'T', 'T', 4, 0x02, 0, 30 };
+    memcpy(v, hdr, 10); n = 10 + putStr(v + 10, "RADAR-SIM", 9);
+    b[0] = 0x10; size_t k = 1 + putLen(b + 1, n); memcpy(b + k, v, n);
+    if (!sendAll(fd, b, k + n)) { drop(); return false; }
+    pollfd q{ fd, POLLIN, 0 }; uint8_t a[4];
+    if (poll(&q, 1, int(timeoutMs)) <= 0 || recv(fd, a, 4, MSG_WAITALL) != 4 || a[0] != 0x20 || a[3] != 0) { drop(); return false; }
+    lastTx = nowMs(); return true;
+  }
+  bool publish(const char* t, const char* p, size_t n, bool retain){
+    if (!connected()) return false;
+    std::vector<uint8_t> b(8 + strlen(t) + n); const size_t tl = strlen(t), rl = 2 + tl + n;
+    b[0] = uint8_t(0x30 | (retain ? 1 : 0)); size_t k = 1 + putLen(&b[1], rl); k += putStr(&b[k], t, tl); memcpy(&b[k], p, n);
+    if (!sendAll(fd, b.data(), k + n)) { drop(); return false; }
+    pkts++; bytes += uint32_t(k + n + 90); lastTx = nowMs(); return true;
+  }
+  void loop(){
+    if (fd < 0 || nowMs() - lastTx <= 15000) return;
+    const uint8_t pr[2] = { 0xC0, 0 }; if (!sendAll(fd, pr, 2)) drop();
+    wakes++; pkts += 2; bytes += 2 * (2 + 90); lastTx = nowMs();   // PINGREQ + PINGRESP
+  }
+};
+
+// Lot comme mqttPublishBatch() (main.cpp)
+static size_t batchPayload(uint8_t* out, size_t cap, bool bin, uint32_t from, uint8_t n){
+  uint32_t t0 = UINT32_MAX;
+  for (uint8_t i = 0; i < n; i++) { const uint32_t t = uint32_t(g_passes.bySeq(from + i)->ts); if (t < t0) t0 = t; }
+  if (bin) {
+    size_t k = PassPack::header(out, from, t0, n);
+    for (uint8_t i = 0; i < n; i++) k += PassPack::record(out + k, *g_passes.bySeq(from + i), t0);
+    return k;
+  }
+  JsonOut j((char*)out, cap);
+  j.obj().key("seq").u(from).key("t0").u(t0).key("p").arr();
+  for (uint8_t i = 0; i < n; i++) {
+    const Passage& p = *g_passes.bySeq(from + i);
+    j.arr().u(uint32_t(p.ts) - t0).u(p.dir ? 1 : 0).u(p.speed_kmh).u(p.speed_raw).u(p.dist_m).u(p.dist_out).u(p.dwell_ds).i(p.angle).u(p.snr).u(p.zone).u(p.ms & Passage::MS_MASK).end();
+  }
+  j.end().end();
+  return j.ok() ? j.size() : 0;
+}
+
+// Propriété du client comme MqttLink : WAIT/CONNECTING -> thread de connexion, UP -> boucle
+enum LinkState { L_WAIT, L_CONNECTING, L_UP };
+
+static int runDevice(const char* host, uint16_t port, double vph, uint32_t seconds, uint16_t rate, const char* state,
+                     uint16_t batch, bool bin, uint32_t tailMs, bool sync){
+  g_passes.attach(g_mem); MqttOutbox::setRate(rate); MqttOutbox::setBatch(batch, MqttOutbox::MAX_BATCH);
+  std::string ackPath = state ? std::string(state) + ".ack" : "";
+  if (state) {   // « reboot » : historique relu (PassLog), curseur relu (NVS)
+    FILE* f = fopen(state, "rb"); std::vector<std::pair<uint32_t, Passage>> h;
+    if (f) { std::pair<uint32_t, Passage> r; while (fread(&r, sizeof(r), 1, f) == 1) h.push_back(r); fclose(f); }
+    const size_t n = h.size() < g_passes.capacity() ? h.size() : g_passes.capacity();
+    if (n) { g_passes.resume(h[h.size() - n].first); for (size_t i = h.size() - n; i < h.size(); i++) g_passes.push(h[i].second); }
+    uint32_t ack = 0; f = fopen(ackPath.c_str(), "r"); if (f) { if (fscanf(f, "%u", &ack) != 1) ack = 0; fclose(f); }
+    printf("[device] reprise : %zu passage(s), curseur %u\n", n, ack);
+    MqttOutbox::begin(ack, g_passes.lastSeq());
+  } else MqttOutbox::begin(0, 0);
+  FILE* hist = state ? fopen(state, "ab") : nullptr;
+
+  Mqtt m; const char* T_LAST = "radar/SIM/last"; const char* T_COUNT = "radar/SIM/count"; const char* T_BATCH = "radar/SIM/batch";
+  const uint32_t t0 = nowMs(); uint32_t nextTry = 0, nextCar = t0, rep = t0, maxLoop = 0, cars = 0, slow = 0, allMax = 0;
+  srand(unsigned(time(nullptr)));
+  std::atomic<int> link(L_WAIT); std::atomic<uint32_t> retryAt(0); Backoff bo(1000, 60000);
+  std::thread conn;
+  if (!sync) conn = std::thread([&](){
+    while (!g_stop) {
+      if (link != L_WAIT || int32_t(nowMs() - retryAt) < 0) { usleep(50000); continue; }
+      link = L_CONNECTING;
+      const uint32_t a = nowMs(); const bool ok = m.connect(host, port, 3000);
+      if (ok) { bo.reset(); printf("[device] connecté (%u ms), file %u\n", nowMs() - a, g_passes.lastSeq() - MqttOutbox::acked()); link = L_UP; }
+      else { const uint32_t w = bo.next(uint32_t(rand())); printf("[device] échec connexion (%u ms), nouvel essai dans %u ms\n", nowMs() - a, w); retryAt = nowMs() + w; link = L_WAIT; }
+    }
+  });
+  while (!g_stop && nowMs() - t0 < seconds * 1000) {
+    const uint32_t ls = nowMs();
+    if (ls >= nextCar) {   // arrivée de Poisson
+      Passage p{}; p.ts = time(nullptr); p.dir = uint8_t(rand() & 1); p.speed_kmh = p.speed_raw = uint8_t(30 + rand() % 40); p.dist_m = 30; p.dwell_ds = 20;
+      const uint32_t s = g_passes.push(p); cars++;
+      if (hist) { std::pair<uint32_t, Passage> r(s, p); fwrite(&r, sizeof(r), 1, hist); fflush(hist); }
+      nextCar = ls + uint32_t(-log(1 - (rand() + 1.0) / (RAND_MAX + 2.0)) * 3600000.0 / vph);
+    }
+    if (sync && !m.connected() && ls >= nextTry) {
+      nextTry = ls + 5000;
+      if (m.connect(host, port, 3000)) printf("[device] connecté, file %u\n", g_passes.lastSeq() - MqttOutbox::acked());
+      else printf("[device] échec connexion (%u ms)\n", nowMs() - ls);
+    }
+    if (!sync && link == L_UP && !m.connected()) { retryAt = nowMs() + bo.next(uint32_t(rand())); link = L_WAIT; }   // MqttLink::service()
+    if ((sync || link == L_UP) && m.connected()) {   // mqttDrain()
+      uint32_t from, last = 0; uint8_t n;
+      auto pubLast = [&](uint32_t s){
+        char buf[256]; JsonOut j(buf, sizeof(buf)); const Passage& p = *g_passes.bySeq(s);
+        j.obj().key("seq").u(s).key("ts").u(uint32_t(p.ts)).key("dir").u(p.dir).key("speed_kmh").u(p.speed_kmh).end();
+        return m.publish(T_LAST, j.c_str(), j.size(), true);
+      };
+      while ((n = MqttOutbox::next(g_passes.firstSeq(), g_passes.lastSeq(), nowMs(), from)) != 0) {
+        bool ok;
+        if (batch) { uint8_t buf[1400]; const size_t k = batchPayload(buf, sizeof(buf), bin, from, n); ok = k && m.publish(T_BATCH, (const char*)buf, k, false); }
+        else ok = pubLast(from);
+        if (!ok) break;
+        last = from + n - 1; MqttOutbox::ack(last, nowMs());
+      }
+      if (last) {
+        m.wakes++;
+        if (batch) pubLast(last);
+        if (MqttOutbox::acked() == g_passes.lastSeq()) { char c[12]; int k = snprintf(c, sizeof(c), "%u", unsigned(g_passes.size())); m.publish(T_COUNT, c, size_t(k), true); }
+      }
+      m.loop();
+    }
+    if (state && MqttOutbox::saveDue(nowMs())) { FILE* f = fopen(ackPath.c_str(), "w"); if (f) { fprintf(f, "%u\n", MqttOutbox::acked()); fclose(f); } MqttOutbox::markSaved(nowMs()); }
+    const uint32_t dt = nowMs() - ls; if (dt > maxLoop) maxLoop = dt; if (dt > allMax) allMax = dt; if (dt > 20) slow++;
+    if (nowMs() - rep >= 10000) {
+      rep = nowMs(); const MqttOutbox::Stats st = MqttOutbox::stats(g_passes.lastSeq(), rep);
+      printf("[device] passages %u | file %u (max %u) envoyés %u en %u msg perdus %u débit %u.%u/s (max %u/s) | boucle max %u ms%s\n", cars, st.depth, st.max_depth,
+             st.sent, st.msgs, st.dropped, st.rate_x10 / 10, st.rate_x10 % 10, st.limit, maxLoop, m.connected() ? "" : " [déconnecté]");
+      fflush(stdout); maxLoop = 0;
+    }
+    usleep(5000);
+  }
+  g_stop = true; if (conn.joinable()) conn.join();
+  if (state) { FILE* f = fopen(ackPath.c_str(), "w"); if (f) { fprintf(f, "%u\n", MqttOutbox::acked()); fclose(f); } }
+  if (hist) fclose(hist);
+  const MqttOutbox::Stats st = MqttOutbox::stats(g_passes.lastSeq(), nowMs());
+  printf("[device] fin : %u passages, dernière seq %u, publiée %u, perdus %u | boucle max %u ms, %u itération(s) > 20 ms (connexion %s)\n",
+         cars, g_passes.lastSeq(), st.acked, st.dropped, allMax, slow, sync ? "bloquante" : "en thread");
+  const double radio = double(m.wakes) * tailMs + m.pkts + m.bytes * 8.0 / 6000.0;   // ms
+  const double per = st.sent ? 100.0 / st.sent : 0;
+  printf("[device] radio (modèle) : %s%s, %u réveils, %u paquets, %u octets, %.0f ms | par 100 passages : %.1f réveils, %.0f octets, %.0f ms\n",
+         batch ? "groupé " : "un message par passage", batch ? (bin ? "bin" : "json") : "", m.wakes, m.pkts, m.bytes, radio,
+         m.wakes * per, m.bytes * per, radio * per);
+  m.drop();
+  return 0;
+}
+
+int main(int argc, char** argv){
+  if (argc < 2 || (strcmp(argv[1], "broker") && strcmp(argv[1], "device"))) { fprintf(stderr, "usage: %s broker|device [options]\n", argv[0]); return 2; }
+  const bool broker = !strcmp(argv[1], "broker");
+  uint16_t port = 1883, rate = MqttOutbox::DEFAULT_RATE, batch = 0; uint32_t up = 0, down = 0, seconds = 120, tail = 50; double vph = 600;
+  bool verbose = false, bin = true, hang = false, sync = false;
+  const char* host = "127.0.0.1"; const char* state = nullptr;
+  for (int i = 2; i < argc; i++) {
+    const char* a = argv[i]; const char* v = i + 1 < argc ? argv[i + 1] : "0";
+    if      (!strcmp(a, "--port"))    { port = uint16_t(atoi(v)); i++; }
+    else if (!strcmp(a, "--outage"))  { if (sscanf(v, "%u,%u", &up, &down) != 2) up = down = 0; i++; }
+    else if (!strcmp(a, "--host"))    { host = v; i++; }
+    else if (!strcmp(a, "--vph"))     { vph = atof(v); i++; }
+    else if (!strcmp(a, "--seconds")) { seconds = uint32_t(atoi(v)); i++; }
+    else if (!strcmp(a, "--rate"))    { rate = uint16_t(atoi(v)); i++; }
+    else if (!strcmp(a, "--state"))   { state = v; i++; }
+    else if (!strcmp(a, "--batch"))   { batch = uint16_t(atoi(v)); i++; }
+    else if (!strcmp(a, "--fmt"))     { bin = strcmp(v, "json") != 0; i++; }
+    else if (!strcmp(a, "--tail"))    { tail = uint32_t(atoi(v)); i++; }
+    else if (!strcmp(a, "--hang"))    hang = true;
+    else if (!strcmp(a, "--sync"))    sync = true;
+    else if (!strcmp(a, "-v"))        verbose = true;
+    else { fprintf(stderr, "option inconnue %s\n", a); return 2; }
+  }
+  signal(SIGINT, onSig); signal(SIGTERM, onSig);
+  setvbuf(stdout, nullptr, _IOLBF, 0);
+  return broker ? runBroker(port, up, down, hang, verbose) : runDevice(host, port, vph, seconds, rate, state, batch, bin, tail, sync);
+}
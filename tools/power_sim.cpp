@@ -0,0 +1,143 @@
+// Banc hôte de la politique d'énergie (src/power_fsm.cpp), horloge virtuelle en ms.
+//
+// Build :  g++ -O2 -std=c++11 -Iinclude tools/power_sim.cpp src/power_fsm.cpp -o power_sim
+//
+//   ./power_sim [--vph N] [--http N] [--loop-ms L] [-v]
+//       1) Scénarios scriptés par mode (override GPIO, radar OK, activité USER/RADAR,
+//          échéances) : transitions attendues vérifiées, code de sortie 1 au premier écart.
+//       2) Journée simulée (mode 2 et 3) : passages Poisson N/h (cibles ~3 s), N requêtes
+//          HTTP/h, 2 fronts GPIO ; appels « matériel » (Wi-Fi PS, Wi-Fi on/off, CPU, lectures
+//          GPIO) comptés pour PowerFsm (sur transition et sur front) et pour l'ancienne
+//          politique (applyPowerPolicy() chaque seconde + lectures GPIO à chaque itération
+//          de loop(), une itération toutes les L ms hors light-sleep, défaut 5). Les tranches
+//          de light-sleep elles-mêmes ne sont pas comptées.
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "power_fsm.h"
+
+using namespace PowerFsm;
+
+static uint32_t g_now = 0;
+static bool     g_verbose = false;
+static int      g_fail = 0;
+
+static void step(uint32_t ms, State& cur){
+  const uint32_t end = g_now + ms;
+  for (; g_now <= end; g_now += 10) {
+    State f, t;
+    while (poll(g_now, f, t)) { if (g_verbose) printf("  %7u ms  %s -> %s\n", g_now, name(f), name(t)); cur = t; }
+  }
+  g_now = end;
+}
+static void expect(const char* what, State cur, State want){
+  if (cur == want) { if (g_verbose) printf("  ok   %s : %s\n", what, name(cur)); return; }
+  printf("  FAIL %s : %s, attendu %s\n", what, name(cur), name(want)); g_fail++;
+}
+static void start(const char* title, uint8_t mode, State& cur){
+  printf("[%s]\n", title);
+  g_now = 1000; Cfg c = { true, mode }; begin(c, g_now); setOverride(false); setRadarOk(false); cur = ACTIVE;
+}
+
+static void scenarios(){
+  State s;
+  start("mode 1 : modem-sleep", 1, s);
+  step(500, s);                          expect("radar muet", s, ACTIVE);
+  setRadarOk(true); step(20, s);         expect("radar OK", s, MODEM_SLEEP);
+  setOverride(true); step(20, s);        expect("override", s, ACTIVE);
+  setOverride(false); step(20, s);       expect("fin override", s, MODEM_SLEEP);
+  activity(USER, g_now); step(20, s);    expect("activité sans effet", s, MODEM_SLEEP);
+
+  start("mode 2 : light-sleep", 2, s);
+  setRadarOk(true); step(LIGHT_IDLE_MS - 100, s); expect("avant échéance", s, ACTIVE);
+  step(200, s);                          expect("inactif", s, LIGHT_SLEEP);
+  activity(RADAR, g_now); step(20, s);   expect("cible", s, ACTIVE);
+  for (int i = 0; i < 5; i++) { activity(RADAR, g_now); step(1000, s); }
+  expect("cibles continues", s, ACTIVE);
+  step(LIGHT_IDLE_MS, s);                expect("cibles parties", s, LIGHT_SLEEP);
+  activity(USER, g_now); step(20, s);    expect("HTTP", s, ACTIVE);
+  setOverride(true); step(LIGHT_IDLE_MS * 2, s); expect("override long", s, ACTIVE);
+  setOverride(false); step(20, s);       expect("fin override (inactif)", s, LIGHT_SLEEP);
+
+  start("mode 3 : Wi-Fi coupé", 3, s);
+  setRadarOk(true); step(RADIO_KEEP_MS - 100, s); expect("avant échéance", s, ACTIVE);
+  activity(USER, g_now); step(RADIO_KEEP_MS - 100, s); expect("échéance repoussée", s, ACTIVE);
+  step(200, s);                          expect("inactif", s, RADIO_OFF);
+  activity(RADAR, g_now); step(20, s);   expect("cible : radio reste coupée", s, RADIO_OFF);
+  activity(USER, g_now); step(20, s);    expect("activité USER", s, ACTIVE);
+  setOverride(true); step(RADIO_KEEP_MS * 2, s); expect("override long", s, ACTIVE);
+  setOverride(false); step(20, s);       expect("fin override (inactif)", s, RADIO_OFF);
+
+  start("veille désactivée", 2, s);
+  Cfg off = { false, 2 }; setCfg(off); setRadarOk(true); step(60000, s); expect("sleep off", s, ACTIVE);
+}
+
+// ---- Journée simulée ----
+static double expo(double mean){ return -mean * log((rand() + 1.0) / (RAND_MAX + 2.0)); }
+
+struct Day { uint64_t hwNew, hwOld, trans; uint32_t ms_in[STATES]; };
+
+static Day day(uint8_t mode, double vph, double http, uint32_t loopMs){
+  const uint32_t DAY = 86400000u;
+  Day d; memset(&d, 0, sizeof(d));
+  g_now = 0; Cfg c = { true, mode }; begin(c, 0); setOverride(false); setRadarOk(true);
+  d.hwNew = 3;                                   // CPU + Wi-Fi PS de base au boot
+  State s = ACTIVE;
+  double nextCar = expo(3600000.0 / vph), nextHttp = expo(3600000.0 / http);
+  uint32_t carEnd = 0;
+  const uint32_t gpioOn = DAY / 3, gpioOff = gpioOn + 1800000u;   // 30 min d'override
+  uint32_t prev = 0;
+  for (uint32_t t = 0; t < DAY; ) {
+    if (t >= nextCar) { carEnd = t + 3000; nextCar += expo(3600000.0 / vph); }
+    if (t < carEnd) activity(RADAR, t);          // une trame de cibles par pas de temps
+    if (t >= nextHttp) { activity(USER, t); nextHttp += expo(3600000.0 / http); }
+    if ((prev < gpioOn && t >= gpioOn) || (prev < gpioOff && t >= gpioOff)) {
+      setOverride(t < gpioOff); d.hwNew++;       // front : une lecture du niveau
+    }
+    prev = t;
+    State f, to;
+    if (poll(t, f, to)) {
+      s = to;
+      if (f == RADIO_OFF || to == RADIO_OFF) d.hwNew += 1; // Wi-Fi on / off
+      if (f == MODEM_SLEEP || to == MODEM_SLEEP) d.hwNew += 2; // setSleep + esp_wifi_set_ps
+    }
+    t += s == LIGHT_SLEEP ? 150 : loopMs;
+  }
+  // Ancienne politique : applyPowerPolicy() 1x/s (CPU, pinMode, digitalRead, setSleep, ps) ;
+  // à chaque itération, mode 3 et garde du light-sleep (pinMode + digitalRead chacun).
+  // Mode 2 : tranches de 150 ms en continu (pas de garde d'inactivité)
+  d.hwOld = uint64_t(DAY / 1000) * 5 + uint64_t(DAY / (mode == 2 ? 150 : loopMs)) * 4;
+  const Stats st = stats(DAY);
+  d.trans = st.transitions; memcpy(d.ms_in, st.ms_in, sizeof(d.ms_in));
+  return d;
+}
+
+int main(int argc, char** argv){
+  double vph = 60, http = 4; uint32_t loopMs = 5;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--vph") && i + 1 < argc) vph = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--http") && i + 1 < argc) http = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--loop-ms") && i + 1 < argc) loopMs = (uint32_t)atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-v")) g_verbose = true;
+    else { fprintf(stderr, "usage: %s [--vph N] [--http N] [--loop-ms L] [-v]\n", argv[0]); return 2; }
+  }
+  if (vph <= 0) vph = 0.001;
+  if (http <= 0) http = 0.001;
+  if (!loopMs) loopMs = 1;
+  scenarios();
+  if (g_fail) { printf("%d écart(s)\n", g_fail); return 1; }
+  printf("scénarios OK\n");
+
+  srand(1);
+  printf("\njournée : %.0f passages/h, %.0f requêtes HTTP/h, loop() toutes les %u ms\n", vph, http, (unsigned)loopMs);
+  for (uint8_t m = 2; m <= 3; m++) {
+    const Day d = day(m, vph, http, loopMs);
+    printf("mode %u : %llu transitions ; actif %.1f h, light %.1f h, radio off %.1f h\n", (unsigned)m,
+           (unsigned long long)d.trans, d.ms_in[ACTIVE] / 3.6e6, d.ms_in[LIGHT_SLEEP] / 3.6e6, d.ms_in[RADIO_OFF] / 3.6e6);
+    printf("         appels matériel : PowerFsm %llu, ancienne politique %llu\n",
+           (unsigned long long)d.hwNew, (unsigned long long)d.hwOld);
+  }
+  return 0;
+}
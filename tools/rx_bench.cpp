@@ -0,0 +1,118 @@
+// Contrôle hôte du découpeur de trames RadarRx::Ring (include/radar_rx.h) : coût linéaire
+// sur entrée hostile.
+//
+// Build :  g++ -O2 -std=c++17 -Iinclude tools/rx_bench.cpp -o rx_bench
+// Usage :  ./rx_bench [--max-mb M] [--ratio R]
+//
+// Flux générés (poussés par blocs de 64 o, comme la tâche radar) :
+//   noise      octets aléatoires
+//   hdr_flood  F4F3F2F1 répété (chaque position est un en-tête candidat, LEN hors bornes)
+//   bad_tail   en-têtes DATA/ACK à LEN maximal, corps rempli d'autres en-têtes, tail faux :
+//              chaque candidat attend sa trame complète puis est rejeté
+//   nested     faux en-tête LEN=512 suivi d'une vraie trame (qui doit être retrouvée)
+// Pour chaque flux, ns/octet est mesuré à 1/16, 1/4 et 1 fois M Mo (défaut 16, meilleur
+// de 3) ; échec (code 1) si le rapport max/min dépasse R (défaut 3) : un coût quadratique
+// le multiplierait par ~16 d'une taille à l'autre. Vérifie aussi le bilan des octets
+// (trames + resync + en attente = reçus) et, pour nested, que toutes les vraies trames sortent.
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include "ld2451_proto.h"
+#include "radar_rx.h"
+
+static uint64_t nowNs(){ timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts); return uint64_t(ts.tv_sec) * 1000000000ULL + ts.tv_nsec; }
+static uint32_t s_rnd = 12345;
+static uint8_t rnd8(){ s_rnd ^= s_rnd << 13; s_rnd ^= s_rnd >> 17; s_rnd ^= s_rnd << 5; return uint8_t(s_rnd); }
+
+typedef std::vector<uint8_t> Bytes;
+static void put(Bytes& b, const uint8_t* p, size_t n){ b.insert(b.end(), p, p + n); }
+static void putLen(Bytes& b, uint16_t L){ b.push_back(uint8_t(L)); b.push_back(uint8_t(L >> 8)); }
+
+// Trame DATA valide à une cible
+static void validFrame(Bytes& b){
+  put(b, DAT_HDR, 4); putLen(b, 7);
+  const uint8_t body[7] = { 1, 0, 0x80, 20, 1, 50, 200 };
+  put(b, body, 7); put(b, DAT_TAIL, 4);
+}
+
+enum Kind { NOISE, HDR_FLOOD, BAD_TAIL, NESTED, KINDS };
+static const char* kindName(int k){ static const char* n[] = { "noise", "hdr_flood", "bad_tail", "nested" }; return n[k]; }
+
+static uint32_t gen(int kind, size_t size, Bytes& b){
+  b.clear(); b.reserve(size + 1024); uint32_t real = 0;
+  while (b.size() < size) {
+    switch (kind) {
+      case NOISE:     b.push_back(rnd8()); break;
+      case HDR_FLOOD: put(b, DAT_HDR, 4); break;
+      case BAD_TAIL: {
+        const bool dat = rnd8() & 1; const uint16_t L = dat ? DAT_MAX_LEN : CMD_MAX_LEN;
+        put(b, dat ? DAT_HDR : CMD_HDR, 4); putLen(b, L);
+        for (size_t i = 0; i < L; i += 6) { put(b, dat ? DAT_HDR : CMD_HDR, 4); putLen(b, L); }
+        b.push_back(0); b.push_back(0); b.push_back(0); b.push_back(0);   // tail faux
+        break;
+      }
+      case NESTED:
+        put(b, DAT_HDR, 4); putLen(b, DAT_MAX_LEN);
+        validFrame(b); real++;
+        for (int i = 0; i < 8; i++) b.push_back(rnd8() & 0x7F);      // sans octet d'en-tête
+        break;
+    }
+  }
+  if (kind == NESTED) b.insert(b.end(), DAT_MAX_LEN + 10, 0);   // le dernier faux en-tête se résout
+  return real;
+}
+
+struct Run { double nsPerByte; uint64_t frames; bool balanced; };
+
+static Run parse(const Bytes& b){
+  static RadarRx::Ring<4096> ring; ring = RadarRx::Ring<4096>();
+  RadarRx::Frame fr; uint64_t frames = 0, frameBytes = 0;
+  const uint64_t t0 = nowNs();
+  for (size_t off = 0; off < b.size(); off += 64) {
+    const size_t n = b.size() - off < 64 ? b.size() - off : 64;
+    ring.push(b.data() + off, n);
+    while (ring.next(fr)) { frames++; frameBytes += fr.raw.size(); ring.release(fr); }
+  }
+  const uint64_t ns = nowNs() - t0;
+  const RadarRx::Stats& s = ring.stats();
+  Run r; r.nsPerByte = double(ns) / b.size(); r.frames = frames;
+  r.balanced = !s.overflow_drops && frameBytes + s.resync_bytes + ring.used() == s.bytes_in;
+  return r;
+}
+
+int main(int argc, char** argv){
+  double maxMb = 16, ratio = 3;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--max-mb") && i + 1 < argc) maxMb = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--ratio") && i + 1 < argc) ratio = atof(argv[++i]);
+    else { fprintf(stderr, "usage: %s [--max-mb M] [--ratio R]\n", argv[0]); return 2; }
+  }
+  if (maxMb < 1) maxMb = 1;
+  const size_t sizes[3] = { size_t(maxMb * 65536), size_t(maxMb * 262144), size_t(maxMb * 1048576) };
+  int fail = 0; Bytes b;
+  printf("%-10s %12s %12s %12s  %s\n", "flux", "ns/o 1/16", "ns/o 1/4", "ns/o 1", "max/min");
+  for (int k = 0; k < KINDS; k++) {
+    double ns[3], lo = 1e30, hi = 0;
+    for (int si = 0; si < 3; si++) {
+      const uint32_t real = gen(k, sizes[si], b);
+      double best = 1e30;
+      for (int rep = 0; rep < 3; rep++) {
+        const Run r = parse(b);
+        if (!r.balanced) { printf("  FAIL %s : bilan des octets faux\n", kindName(k)); fail++; }
+        if (k == NESTED && r.frames != real) { printf("  FAIL nested : %llu trames sur %u\n", (unsigned long long)r.frames, real); fail++; }
+        if (k != NESTED && k != NOISE && r.frames) { printf("  FAIL %s : %llu trames fantômes\n", kindName(k), (unsigned long long)r.frames); fail++; }
+        if (r.nsPerByte < best) best = r.nsPerByte;
+      }
+      ns[si] = best; if (best < lo) lo = best; if (best > hi) hi = best;
+    }
+    const double q = hi / lo;
+    printf("%-10s %12.2f %12.2f %12.2f  %.2f%s\n", kindName(k), ns[0], ns[1], ns[2], q, q > ratio ? "  FAIL" : "");
+    if (q > ratio) fail++;
+  }
+  if (fail) { printf("%d échec(s)\n", fail); return 1; }
+  printf("coût linéaire : OK\n");
+  return 0;
+}
@@ -0,0 +1,132 @@
+// Banc hôte : trames radar perdues pendant un blocage de loop(), avant / après la tâche
+// d'ingestion (src/radar_task.cpp). Horloge virtuelle (pas de 100 µs), découpage par le vrai
+// RadarRx::Ring (include/radar_rx.h), trames au format LD2451 (comme tools/ld2451_emu).
+//
+// Build :  g++ -O2 -std=c++17 -Iinclude tools/stall_sim.cpp -o stall_sim
+// Usage :  ./stall_sim [--rate HZ] [--targets N] [--baud B] [--stall MS] [--every S] [--seconds S]
+//
+// Le radar émet --rate trames/s au temps-fil de --baud. loop() tourne toutes les 2 ms et se
+// bloque --stall ms toutes les --every s (connexion MQTT, requête HTTP lente...).
+//   loop      : ancien modèle, loop() lit l'UART (tampon RX Arduino 256 o) ; pendant le blocage
+//               les octets au-delà du tampon sont perdus (overflow).
+//   task      : tâche radar à haute priorité, jamais bloquée : tampon driver 4096 o vidé en
+//               continu, trames décodées remises à loop() par une file de 64 (queue_drops si pleine).
+// Bilan : trames émises / reçues par loop(), octets perdus, trames perdues en file, latence max.
+// Code de sortie 1 si le modèle task perd une trame alors que le blocage tient dans la file.
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deque>
+#include <vector>
+#include "ld2451_proto.h"
+#include "radar_rx.h"
+
+static const uint32_t TICK_US     = 100;
+static const uint32_t LOOP_US     = 2000;
+static const size_t   ARDUINO_RX  = 256;    // HardwareSerial, ancien main.cpp
+static const size_t   DRV_RX_BUF  = 4096;   // comme src/radar_task.cpp
+static const size_t   FRAME_Q_LEN = 64;
+
+struct Opts { double rate = 10; int targets = 3; uint32_t baud = 115200; uint32_t stallMs = 3000, everyS = 10, seconds = 120; };
+
+// Trame DATA ; la 1re cible porte le numéro de trame (dist, speed) pour repérer trous et désordre
+static std::vector<uint8_t> dataFrame(uint32_t seq, int targets){
+  std::vector<uint8_t> f(DAT_HDR, DAT_HDR + 4);
+  const uint16_t L = uint16_t(2 + 5 * targets);
+  f.push_back(uint8_t(L)); f.push_back(uint8_t(L >> 8));
+  f.push_back(uint8_t(targets)); f.push_back(0);
+  for (int i = 0; i < targets; i++) {
+    const uint8_t t[5] = { 0x80, uint8_t(i ? 20 : seq & 0xFF), 1, uint8_t(i ? 50 : (seq >> 8) & 0x7F), 200 };
+    f.insert(f.end(), t, t + 5);
+  }
+  f.insert(f.end(), DAT_TAIL, DAT_TAIL + 4);
+  return f;
+}
+static uint32_t frameSeq(const RadarRx::Frame& fr){ return uint32_t(fr.raw[6 + 2 + 1]) | (uint32_t(fr.raw[6 + 2 + 3]) << 8); }
+
+struct Result { uint32_t sent = 0, got = 0, gaps = 0; uint64_t uartDrops = 0, queueDrops = 0; uint32_t latMaxUs = 0; };
+
+static Result run(const Opts& o, bool task){
+  Result r;
+  static RadarRx::Ring<4096> ring; ring = RadarRx::Ring<4096>();
+  std::deque<uint8_t> wire, rx;                        // à émettre / reçus pas encore lus
+  std::deque<uint32_t> q;                              // file vers loop() : numéros de trame
+  std::vector<uint64_t> sentAt;                        // fin d'émission (µs) par numéro de trame
+  const size_t rxCap = task ? DRV_RX_BUF : ARDUINO_RX;
+  const double bytesPerTick = o.baud / 10.0 * TICK_US / 1e6; double credit = 0;
+  const uint64_t end = uint64_t(o.seconds) * 1000000, period = uint64_t(1e6 / o.rate);
+  uint64_t nextFrame = 0, nextLoop = 0, stallEnd = 0, nextStall = uint64_t(o.everyS) * 1000000;
+  uint32_t expect = 0; RadarRx::Frame fr;
+
+  auto deliver = [&](uint32_t seq, uint64_t now){
+    const uint32_t full = expect + ((seq - expect) & 0x7FFF);   // numéro sur 15 bits -> complet
+    r.got++; if (full != expect) r.gaps++; expect = full + 1;
+    const uint32_t lat = uint32_t(now - sentAt[full]); if (lat > r.latMaxUs) r.latMaxUs = lat;
+  };
+  auto parse = [&](uint64_t now, bool toQueue){
+    while (!rx.empty()) { uint8_t b[256]; size_t n = 0; while (n < sizeof(b) && !rx.empty()) { b[n++] = rx.front(); rx.pop_front(); } ring.push(b, n); }
+    while (ring.next(fr)) {
+      const uint32_t seq = frameSeq(fr); ring.release(fr);
+      if (!toQueue) deliver(seq, now);
+      else if (q.size() < FRAME_Q_LEN) q.push_back(seq);
+      else r.queueDrops++;
+    }
+  };
+
+  for (uint64_t now = 0; now < end; now += TICK_US) {
+    if (now >= nextFrame) {
+      const std::vector<uint8_t> f = dataFrame(r.sent & 0x7FFF, o.targets);
+      wire.insert(wire.end(), f.begin(), f.end());
+      sentAt.push_back(now + uint64_t((wire.size()) * 10e6 / o.baud));
+      r.sent++; nextFrame += period;
+    }
+    credit += bytesPerTick;
+    while (credit >= 1 && !wire.empty()) {
+      credit -= 1;
+      if (rx.size() < rxCap) rx.push_back(wire.front()); else r.uartDrops++;
+      wire.pop_front();
+    }
+    if (wire.empty()) credit = 0;
+    if (task) parse(now, true);                        // tâche : réveillée à chaque silence de ligne
+    if (now >= nextStall) { stallEnd = now + uint64_t(o.stallMs) * 1000; nextStall += uint64_t(o.everyS) * 1000000; }
+    if (now < stallEnd || now < nextLoop) continue;
+    nextLoop = now + LOOP_US;
+    if (task) { while (!q.empty()) { deliver(q.front(), now); q.pop_front(); } }
+    else parse(now, false);
+  }
+  const RadarRx::Stats& s = ring.stats();
+  r.uartDrops += s.overflow_drops;
+  return r;
+}
+
+static void report(const char* name, const Result& r){
+  printf("%-5s : %u trames émises, %u reçues par loop() (%u perdues), %u trous de séquence ; overflow_drops=%llu o, queue_drops=%llu ; latence max %.1f ms\n",
+         name, r.sent, r.got, r.sent - r.got, r.gaps, (unsigned long long)r.uartDrops, (unsigned long long)r.queueDrops, r.latMaxUs / 1000.0);
+}
+
+int main(int argc, char** argv){
+  Opts o;
+  for (int i = 1; i < argc; i++) {
+    const char* a = argv[i]; const bool v = i + 1 < argc;
+    if      (!strcmp(a, "--rate") && v)    o.rate = atof(argv[++i]);
+    else if (!strcmp(a, "--targets") && v) o.targets = atoi(argv[++i]);
+    else if (!strcmp(a, "--baud") && v)    o.baud = uint32_t(atol(argv[++i]));
+    else if (!strcmp(a, "--stall") && v)   o.stallMs = uint32_t(atol(argv[++i]));
+    else if (!strcmp(a, "--every") && v)   o.everyS = uint32_t(atol(argv[++i]));
+    else if (!strcmp(a, "--seconds") && v) o.seconds = uint32_t(atol(argv[++i]));
+    else { fprintf(stderr, "see header of tools/stall_sim.cpp for options\n"); return 2; }
+  }
+  if (o.rate <= 0) o.rate = 1;
+  if (o.targets < 1) o.targets = 1;
+  if (o.targets > 16) o.targets = 16;
+  if (!o.baud) o.baud = 115200;
+  if (!o.everyS) o.everyS = 1;
+  printf("%.0f trames/s, %d cibles, %u bauds, blocage de loop() %u ms toutes les %u s, %u s\n",
+         o.rate, o.targets, (unsigned)o.baud, (unsigned)o.stallMs, (unsigned)o.everyS, (unsigned)o.seconds);
+  const Result old = run(o, false), neu = run(o, true);
+  report("loop", old); report("task", neu);
+  const bool fits = o.stallMs / 1000.0 * o.rate + 1 < FRAME_Q_LEN;
+  if (fits && neu.got != neu.sent) { printf("FAIL : le blocage tient dans la file, aucune trame ne devait être perdue\n"); return 1; }
+  return 0;
+}